@@ -0,0 +1,737 @@
+#include "config.h"
+
+#include "../lib/glibdictcapture.h"
+#include "../lib/glibdictclient.h"
+#include "../lib/glibdictprotocol.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_APP_SUMMARY "This program measures the parser of the library without network.\n\nResponses of every shape are generated in memory, or taken from sessions of a capture FILE recorded by DictClient, and read by a DictClient over an in-memory stream. The best of the repeats is reported."
+
+#define DEFAULT_RESPONSES 10000
+#define DEFAULT_REPEATS 5
+#define LINE_REPEATS 100
+
+#define DEFINITION_LINES 20
+#define MATCH_PAIRS 100
+#define DATABASE_PAIRS 50
+#define STRATEGY_PAIRS 12
+#define INFO_LINES 200
+
+/* every allocation of the process is counted, glibc lets the real allocator be called under another name */
+#if defined( __GLIBC__ )
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t number, size_t size );
+extern void *__libc_realloc( void *ptr, size_t size );
+
+static guint64 allocations = 0;
+#define ALLOCATIONS_COUNTED TRUE
+
+void*
+malloc(
+	size_t size )
+{
+	++allocations;
+	return __libc_malloc( size );
+}
+
+void*
+calloc(
+	size_t number,
+	size_t size )
+{
+	++allocations;
+	return __libc_calloc( number, size );
+}
+
+void*
+realloc(
+	void *ptr,
+	size_t size )
+{
+	++allocations;
+	return __libc_realloc( ptr, size );
+}
+#else
+static guint64 allocations = 0;
+#define ALLOCATIONS_COUNTED FALSE
+#endif
+
+typedef void (*BenchGenerateFunc)( GString *stream, guint index );
+typedef gboolean (*BenchRequestFunc)( DictClient *dc, guint index, GError **error );
+
+struct _BenchShape
+{
+	const gchar *name;
+	BenchGenerateFunc generate;
+	BenchRequestFunc request;
+};
+typedef struct _BenchShape BenchShape;
+
+struct _BenchResult
+{
+	guint responses;
+	gsize bytes;
+	gint64 time;
+	guint64 allocations;
+};
+typedef struct _BenchResult BenchResult;
+
+static void
+generate_definitions(
+	GString *stream,
+	guint index,
+	gboolean quoted )
+{
+	guint i, j;
+
+	g_string_append( stream, "150 2 definitions retrieved\r\n" );
+	for( i = 0; i < 2; ++i )
+	{
+		if( quoted )
+			g_string_append_printf( stream, "151 \"word %u\" \"db%u\" \"Database number %u\"\r\n", index, i, i );
+		else
+			g_string_append_printf( stream, "151 word%u db%u Database%u\r\n", index, i, i );
+
+		g_string_append_printf( stream, "word %u\r\n", index );
+		for( j = 0; j < DEFINITION_LINES; ++j )
+			g_string_append_printf( stream, "   %u. A sense of the word, see {word %u} and {other word %u} for more.\r\n", j + 1, index + j, index + j + 1 );
+		/* a dot-stuffed line */
+		g_string_append( stream, "..and so on\r\n.\r\n" );
+	}
+	g_string_append( stream, "250 ok [d/m/c = 2/0/20; 0.000r 0.000u 0.000s]\r\n" );
+}
+
+static void
+generate_definitions_quoted(
+	GString *stream,
+	guint index )
+{
+	generate_definitions( stream, index, TRUE );
+}
+
+static void
+generate_definitions_unquoted(
+	GString *stream,
+	guint index )
+{
+	generate_definitions( stream, index, FALSE );
+}
+
+static gboolean
+request_define(
+	DictClient *dc,
+	guint index,
+	GError **error )
+{
+	GStrv words, databases, descriptions, definitions;
+	gchar *word;
+	glong number;
+
+	word = g_strdup_printf( "word %u", index );
+	number = dict_client_define( dc, "*", word, &words, &databases, &descriptions, &definitions, error );
+	g_free( word );
+	if( number > 0 )
+	{
+		g_strfreev( words );
+		g_strfreev( databases );
+		g_strfreev( descriptions );
+		g_strfreev( definitions );
+	}
+
+	return number >= 0;
+}
+
+static void
+generate_pairs(
+	GString *stream,
+	guint code,
+	guint number,
+	const gchar *format,
+	guint index )
+{
+	guint i;
+
+	g_string_append_printf( stream, "%u %u items present\r\n", code, number );
+	for( i = 0; i < number; ++i )
+	{
+		g_string_append_printf( stream, format, i % 7, index + i );
+		g_string_append( stream, "\r\n" );
+	}
+	g_string_append( stream, ".\r\n250 ok\r\n" );
+}
+
+static void
+generate_matches(
+	GString *stream,
+	guint index )
+{
+	generate_pairs( stream, 152, MATCH_PAIRS, "db%u \"word %u\"", index );
+}
+
+static gboolean
+request_match(
+	DictClient *dc,
+	guint index,
+	GError **error )
+{
+	GStrv databases, words;
+	glong number;
+
+	number = dict_client_match( dc, "*", "prefix", "word", &databases, &words, error );
+	if( number > 0 )
+	{
+		g_strfreev( databases );
+		g_strfreev( words );
+	}
+
+	return number >= 0;
+}
+
+static void
+generate_databases(
+	GString *stream,
+	guint index )
+{
+	generate_pairs( stream, 110, DATABASE_PAIRS, "db%u%u \"A dictionary of some language\"", index );
+}
+
+static gboolean
+request_databases(
+	DictClient *dc,
+	guint index,
+	GError **error )
+{
+	GStrv databases, descriptions;
+	glong number;
+
+	number = dict_client_show_databases( dc, &databases, &descriptions, error );
+	if( number > 0 )
+	{
+		g_strfreev( databases );
+		g_strfreev( descriptions );
+	}
+
+	return number >= 0;
+}
+
+static void
+generate_strategies(
+	GString *stream,
+	guint index )
+{
+	generate_pairs( stream, 111, STRATEGY_PAIRS, "strat%u%u \"Match by some rule\"", index );
+}
+
+static gboolean
+request_strategies(
+	DictClient *dc,
+	guint index,
+	GError **error )
+{
+	GStrv strategies, descriptions;
+	glong number;
+
+	number = dict_client_show_strategies( dc, &strategies, &descriptions, error );
+	if( number > 0 )
+	{
+		g_strfreev( strategies );
+		g_strfreev( descriptions );
+	}
+
+	return number >= 0;
+}
+
+static void
+generate_info(
+	GString *stream,
+	guint index )
+{
+	guint i;
+
+	g_string_append( stream, "112 database information follows\r\n" );
+	for( i = 0; i < INFO_LINES; ++i )
+		g_string_append_printf( stream, "Line %u of a long description of the database, its authors and its license.\r\n", i );
+	g_string_append( stream, ".\r\n250 ok\r\n" );
+}
+
+static gboolean
+request_info(
+	DictClient *dc,
+	guint index,
+	GError **error )
+{
+	gchar *info;
+
+	info = dict_client_show_info( dc, "db0", error );
+	g_free( info );
+
+	return info != NULL;
+}
+
+static const BenchShape shapes[] =
+{
+	{ "define-quoted", generate_definitions_quoted, request_define },
+	{ "define-unquoted", generate_definitions_unquoted, request_define },
+	{ "match", generate_matches, request_match },
+	{ "databases", generate_databases, request_databases },
+	{ "strategies", generate_strategies, request_strategies },
+	{ "info", generate_info, request_info },
+	{ NULL }
+};
+
+/**
+\anchor bench_client_new
+\brief Creates a client reading the server's bytes from memory.
+
+Commands are written to a growing memory stream and dropped with the client. The cache is disabled, so every request is parsed.
+*/
+static DictClient*
+bench_client_new(
+	GBytes *server,
+	const gchar *client_message,
+	GError **error )
+{
+	DictClient *dc;
+	GInputStream *input;
+	GOutputStream *output;
+	GIOStream *stream;
+
+	input = g_memory_input_stream_new_from_bytes( server );
+	output = g_memory_output_stream_new_resizable();
+	stream = g_simple_io_stream_new( input, output );
+	g_object_unref( input );
+	g_object_unref( output );
+
+	dc = dict_client_new();
+	dict_client_set_cache_size( dc, 0 );
+	if( !dict_client_connect_stream( dc, stream, client_message, NULL, error ) )
+		g_clear_object( &dc );
+	g_object_unref( stream );
+
+	return dc;
+}
+
+static void
+print_result(
+	const gchar *name,
+	const BenchResult *result )
+{
+	gdouble seconds = result->time > 0 ? (gdouble)result->time / G_USEC_PER_SEC : 1e-9;
+
+	if( ALLOCATIONS_COUNTED )
+		g_print( "%-18s %10u %12" G_GSIZE_FORMAT " %10.1f %12.0f %10.1f\n",
+			name, result->responses, result->bytes,
+			result->bytes / seconds / 1e6, result->responses / seconds,
+			(gdouble)result->allocations / result->responses );
+	else
+		g_print( "%-18s %10u %12" G_GSIZE_FORMAT " %10.1f %12.0f %10s\n",
+			name, result->responses, result->bytes,
+			result->bytes / seconds / 1e6, result->responses / seconds,
+			"n/a" );
+}
+
+/**
+\anchor bench_shape
+\brief Measures the requests of one shape.
+
+\param[in] shape A shape of the responses.
+\param[in] responses A number of responses.
+\param[in] repeats A number of repeats, the best one is kept.
+\param[out] result Holds the best result.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+static gboolean
+bench_shape(
+	const BenchShape *shape,
+	guint responses,
+	guint repeats,
+	BenchResult *result,
+	GError **error )
+{
+	GString *stream;
+	GBytes *server;
+	DictClient *dc = NULL;
+	gint64 start, time;
+	guint64 start_allocations;
+	guint i, r;
+	gboolean ok = TRUE;
+
+	stream = g_string_new( "220 bench <auth.mime> <0@bench>\r\n" );
+	for( i = 0; i < responses; ++i )
+		shape->generate( stream, i );
+	result->responses = responses;
+	result->bytes = stream->len;
+	result->time = G_MAXINT64;
+	server = g_string_free_to_bytes( stream );
+
+	for( r = 0; ok && r < repeats; ++r )
+	{
+		dc = bench_client_new( server, NULL, error );
+		if( dc == NULL )
+			break;
+
+		start_allocations = allocations;
+		start = g_get_monotonic_time();
+		for( i = 0; ok && i < responses; ++i )
+			ok = shape->request( dc, i, error );
+		time = g_get_monotonic_time() - start;
+		if( time < result->time )
+		{
+			result->time = time;
+			result->allocations = allocations - start_allocations;
+		}
+
+		g_object_unref( dc );
+	}
+
+	g_bytes_unref( server );
+
+	return ok && dc != NULL;
+}
+
+/**
+\anchor bench_lines
+\brief Measures parsing of a status line alone.
+
+Status lines are parsed by <tt>parse_response()</tt>, so the numbers include <tt>unbracket_string()</tt> for every field of a 151 line.
+*/
+static void
+bench_lines(
+	const gchar *name,
+	const gchar *line,
+	guint responses,
+	guint repeats,
+	gboolean unbracket_only )
+{
+	DictResponse resp;
+	BenchResult result;
+	gchar *word, *database, *description, *end;
+	gint64 start, time;
+	guint64 start_allocations;
+	guint i, r, count;
+
+	count = responses * LINE_REPEATS;
+	result.responses = count;
+	result.bytes = (gsize)count * strlen( line );
+	result.time = G_MAXINT64;
+
+	for( r = 0; r < repeats; ++r )
+	{
+		start_allocations = allocations;
+		start = g_get_monotonic_time();
+		for( i = 0; i < count; ++i )
+		{
+			if( unbracket_only )
+			{
+				unbracket_string( (gchar*)line + 4, &word, &end );
+				g_free( word );
+				continue;
+			}
+
+			resp = (DictResponse){NULL,};
+			resp.word = &word;
+			resp.database = &database;
+			resp.description = &description;
+			parse_response( (gchar*)line, &resp, NULL );
+			g_free( word );
+			g_free( database );
+			g_free( description );
+		}
+		time = g_get_monotonic_time() - start;
+		if( time < result.time )
+		{
+			result.time = time;
+			result.allocations = allocations - start_allocations;
+		}
+	}
+
+	print_result( name, &result );
+}
+
+/**
+\anchor replay_command
+\brief Sends a recorded command through the matching function of the client.
+
+\return \c TRUE on success, \c FALSE on error or if the command has no function.
+*/
+static gboolean
+replay_command(
+	DictClient *dc,
+	const gchar *line,
+	GError **error )
+{
+	gchar **argv, *text;
+	gint argc;
+	glong number = 0;
+	GStrv a, b, c, d;
+
+	if( !g_shell_parse_argv( line, &argc, &argv, error ) )
+		return FALSE;
+
+	a = b = c = d = NULL;
+	if( g_ascii_strcasecmp( argv[0], "DEFINE" ) == 0 && argc == 3 )
+		number = dict_client_define( dc, argv[1], argv[2], &a, &b, &c, &d, error );
+	else if( g_ascii_strcasecmp( argv[0], "MATCH" ) == 0 && argc == 4 )
+		number = dict_client_match( dc, argv[1], argv[2], argv[3], &a, &b, error );
+	else if( g_ascii_strcasecmp( argv[0], "SHOW" ) == 0 && argc >= 2 && ( g_ascii_strcasecmp( argv[1], "DB" ) == 0 || g_ascii_strcasecmp( argv[1], "DATABASES" ) == 0 ) )
+		number = dict_client_show_databases( dc, &a, &b, error );
+	else if( g_ascii_strcasecmp( argv[0], "SHOW" ) == 0 && argc >= 2 && ( g_ascii_strcasecmp( argv[1], "STRAT" ) == 0 || g_ascii_strcasecmp( argv[1], "STRATEGIES" ) == 0 ) )
+		number = dict_client_show_strategies( dc, &a, &b, error );
+	else if( g_ascii_strcasecmp( argv[0], "SHOW" ) == 0 && argc == 3 && g_ascii_strcasecmp( argv[1], "INFO" ) == 0 )
+	{
+		text = dict_client_show_info( dc, argv[2], error );
+		number = text != NULL ? 0 : -1;
+		g_free( text );
+	}
+	else if( g_ascii_strcasecmp( argv[0], "SHOW" ) == 0 && argc == 2 && g_ascii_strcasecmp( argv[1], "SERVER" ) == 0 )
+	{
+		text = dict_client_show_server( dc, error );
+		number = text != NULL ? 0 : -1;
+		g_free( text );
+	}
+	else if( g_ascii_strcasecmp( argv[0], "STATUS" ) == 0 )
+	{
+		text = dict_client_status( dc, error );
+		number = text != NULL ? 0 : -1;
+		g_free( text );
+	}
+	else if( g_ascii_strcasecmp( argv[0], "QUIT" ) == 0 )
+		number = dict_client_disconnect( dc, NULL, error ) ? 0 : -1;
+	else
+	{
+		g_set_error( error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Recorded command %s is not supported", argv[0] );
+		number = -1;
+	}
+
+	g_strfreev( a );
+	g_strfreev( b );
+	g_strfreev( c );
+	g_strfreev( d );
+	g_strfreev( argv );
+
+	return number >= 0;
+}
+
+/**
+\anchor bench_capture
+\brief Measures the sessions of a capture file.
+
+The received bytes of a session are read by a client again while the recorded commands are repeated, prefetched commands are repeated in their order.
+
+\param[in] filename A path of the capture file.
+\param[in] repeats A number of repeats, the best one is kept.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+static gboolean
+bench_capture(
+	const gchar *filename,
+	guint repeats,
+	GError **error )
+{
+	GMappedFile *file;
+	GString *received = NULL, *sent = NULL;
+	GBytes *server;
+	GStrv commands;
+	DictClient *dc;
+	BenchResult result;
+	const gchar *data, *end;
+	gchar *name, *client_message;
+	guint64 start_allocations;
+	guint32 be_length;
+	gsize length;
+	gint64 start, time;
+	guint i, r, first, session = 0;
+	gboolean ok = TRUE;
+
+	file = g_mapped_file_new( filename, FALSE, error );
+	if( file == NULL )
+		return FALSE;
+
+	data = g_mapped_file_get_contents( file );
+	end = data + g_mapped_file_get_length( file );
+	while( ok )
+	{
+		/* a session is over at the next session record or at the end */
+		if( data >= end || data[0] == CAPTURE_RECORD_SESSION )
+		{
+			if( received != NULL && received->len > 0 )
+			{
+				commands = g_strsplit( sent->str, "\n", -1 );
+				for( i = 0; commands[i] != NULL; ++i )
+					g_strchomp( commands[i] );
+
+				/* a greeting is sent by the connection itself */
+				first = 0;
+				client_message = NULL;
+				if( g_ascii_strncasecmp( commands[0], "CLIENT ", strlen( "CLIENT " ) ) == 0 )
+				{
+					unbracket_string( commands[0] + strlen( "CLIENT " ), &client_message, NULL );
+					first = 1;
+				}
+
+				result.bytes = received->len;
+				result.responses = 0;
+				result.time = G_MAXINT64;
+				server = g_bytes_new( received->str, received->len );
+				for( r = 0; ok && r < repeats; ++r )
+				{
+					dc = bench_client_new( server, client_message, error );
+					if( dc == NULL )
+					{
+						ok = FALSE;
+						break;
+					}
+
+					start_allocations = allocations;
+					start = g_get_monotonic_time();
+					result.responses = 0;
+					for( i = first; ok && commands[i] != NULL; ++i )
+						if( *commands[i] != '\0' )
+						{
+							ok = replay_command( dc, commands[i], error );
+							++result.responses;
+						}
+					time = g_get_monotonic_time() - start;
+					if( time < result.time )
+					{
+						result.time = time;
+						result.allocations = allocations - start_allocations;
+					}
+
+					g_object_unref( dc );
+				}
+				g_bytes_unref( server );
+				g_free( client_message );
+				g_strfreev( commands );
+
+				if( ok && result.responses > 0 )
+				{
+					name = g_strdup_printf( "capture-%u", session );
+					print_result( name, &result );
+					g_free( name );
+				}
+				++session;
+			}
+
+			if( received != NULL )
+			{
+				g_string_free( received, TRUE );
+				g_string_free( sent, TRUE );
+				received = sent = NULL;
+			}
+			if( data >= end )
+				break;
+
+			received = g_string_new( NULL );
+			sent = g_string_new( NULL );
+		}
+
+		if( end - data < CAPTURE_HEADER_LEN )
+			break;
+		/* times are of no use here */
+		memcpy( &be_length, data + 1 + sizeof( guint64 ), sizeof( be_length ) );
+		length = GUINT32_FROM_BE( be_length );
+		if( (gsize)( end - data - CAPTURE_HEADER_LEN ) < length )
+			break;
+
+		if( data[0] == CAPTURE_RECORD_RECEIVED && received != NULL )
+			g_string_append_len( received, data + CAPTURE_HEADER_LEN, length );
+		else if( data[0] == CAPTURE_RECORD_SENT && sent != NULL )
+			g_string_append_len( sent, data + CAPTURE_HEADER_LEN, length );
+		data += CAPTURE_HEADER_LEN + length;
+	}
+
+	if( received != NULL )
+	{
+		g_string_free( received, TRUE );
+		g_string_free( sent, TRUE );
+	}
+	g_mapped_file_unref( file );
+
+	return ok;
+}
+
+int
+main(
+	int argc,
+	char *argv[] )
+{
+	gint responses = DEFAULT_RESPONSES;
+	gint repeats = DEFAULT_REPEATS;
+	gchar *capture = NULL;
+	const GOptionEntry option_entries[] =
+	{
+		{ "responses", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &responses, "A number of generated responses of every shape. Default is 10000.", "NUMBER" },
+		{ "repeats", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &repeats, "A number of repeats, the best one is reported. Default is 5.", "NUMBER" },
+		{ "capture", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &capture, "A capture file recorded by DictClient, its sessions are measured instead of the generated responses.", "FILE" },
+		{ NULL }
+	};
+
+	GOptionContext *option_context;
+	BenchResult result;
+	const BenchShape *shape;
+	gint ret = EXIT_SUCCESS;
+	GError *error = NULL;
+
+	setlocale( LC_ALL, "" );
+
+	option_context = g_option_context_new( NULL );
+	g_option_context_set_summary( option_context, BENCH_APP_SUMMARY );
+	g_option_context_set_help_enabled( option_context, TRUE );
+	g_option_context_add_main_entries( option_context, option_entries, NULL );
+
+	g_option_context_parse( option_context, &argc, &argv, &error );
+	g_option_context_free( option_context );
+	if( error == NULL && ( responses < 1 || repeats < 1 ) )
+		g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Numbers of responses and repeats must be positive" );
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_free( capture );
+		return EXIT_FAILURE;
+	}
+
+	g_print( "%-18s %10s %12s %10s %12s %10s\n", "shape", "responses", "bytes", "MB/s", "responses/s", "allocs" );
+
+	if( capture != NULL )
+		bench_capture( capture, repeats, &error );
+	else
+	{
+		for( shape = shapes; shape->name != NULL && error == NULL; ++shape )
+			if( bench_shape( shape, responses, repeats, &result, &error ) )
+				print_result( shape->name, &result );
+
+		if( error == NULL )
+		{
+			bench_lines( "line-151-quoted", "151 \"word one\" \"db0\" \"Database number 0\"", responses, repeats, FALSE );
+			bench_lines( "line-151-unquoted", "151 word db0 Database0", responses, repeats, FALSE );
+			bench_lines( "unbracket-quoted", "151 \"word one\" \"db0\" \"Database number 0\"", responses, repeats, TRUE );
+			bench_lines( "unbracket-unquoted", "151 word db0 Database0", responses, repeats, TRUE );
+		}
+	}
+
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		ret = EXIT_FAILURE;
+	}
+	g_free( capture );
+
+	return ret;
+}
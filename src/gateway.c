@@ -0,0 +1,695 @@
+#include "config.h"
+
+#include "lib/glibdictclient.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include <locale.h>
+#include <string.h>
+
+#define GATEWAY_APP_SUMMARY "This program serves a dict server over HTTP/1.1 as JSON.\n\nEndpoints:\n  GET /define?word=WORD[&database=DATABASE]\n  GET /match?word=WORD[&database=DATABASE][&strategy=STRATEGY]\n  GET /show/databases\n  GET /show/strategies\n  GET /show/info?database=DATABASE\n  GET /show/server"
+
+#define DEFAULT_LISTEN_PORT 8080
+#define DEFAULT_CONNECTIONS 4
+#define DEFAULT_THREADS 16
+#define DEFAULT_CACHE_SIZE 1024
+#define DEFAULT_CACHE_TTL 300
+#define DEFAULT_IDLE_TIMEOUT 30
+#define MAX_HEADERS 100
+
+struct _GatewayCacheEntry
+{
+	gchar *key;
+	GBytes *body;
+	gint64 expires;
+	GList link;
+};
+typedef struct _GatewayCacheEntry GatewayCacheEntry;
+
+/* responses shared by all connections, the least recently used ones are dropped first */
+struct _GatewayCache
+{
+	GMutex mutex;
+	GHashTable *entries;
+	GQueue order;
+	guint size;
+	gint64 ttl;
+};
+typedef struct _GatewayCache GatewayCache;
+
+struct _Gateway
+{
+	gchar *host;
+	guint16 port;
+
+	/* idle clients, a thread takes one for a request and gives it back */
+	GAsyncQueue *pool;
+
+	GatewayCache cache;
+};
+typedef struct _Gateway Gateway;
+
+static void
+cache_entry_free(
+	GatewayCacheEntry *entry )
+{
+	g_free( entry->key );
+	g_bytes_unref( entry->body );
+	g_free( entry );
+}
+
+static void
+cache_init(
+	GatewayCache *cache,
+	guint size,
+	guint ttl )
+{
+	g_mutex_init( &cache->mutex );
+	cache->entries = g_hash_table_new_full( g_str_hash, g_str_equal, NULL, (GDestroyNotify)cache_entry_free );
+	g_queue_init( &cache->order );
+	cache->size = size;
+	cache->ttl = (gint64)ttl * G_USEC_PER_SEC;
+}
+
+static void
+cache_clear(
+	GatewayCache *cache )
+{
+	g_hash_table_unref( cache->entries );
+	g_mutex_clear( &cache->mutex );
+}
+
+/* removes the entry from the order, then from the table, which frees it */
+static void
+cache_remove(
+	GatewayCache *cache,
+	GatewayCacheEntry *entry )
+{
+	g_queue_unlink( &cache->order, &entry->link );
+	g_hash_table_remove( cache->entries, entry->key );
+}
+
+static GBytes*
+cache_lookup(
+	GatewayCache *cache,
+	const gchar *key )
+{
+	GatewayCacheEntry *entry;
+	GBytes *body = NULL;
+
+	g_mutex_lock( &cache->mutex );
+
+	entry = g_hash_table_lookup( cache->entries, key );
+	if( entry != NULL && entry->expires < g_get_monotonic_time() )
+	{
+		cache_remove( cache, entry );
+		entry = NULL;
+	}
+	if( entry != NULL )
+	{
+		g_queue_unlink( &cache->order, &entry->link );
+		g_queue_push_tail_link( &cache->order, &entry->link );
+		body = g_bytes_ref( entry->body );
+	}
+
+	g_mutex_unlock( &cache->mutex );
+
+	return body;
+}
+
+static void
+cache_insert(
+	GatewayCache *cache,
+	const gchar *key,
+	GBytes *body )
+{
+	GatewayCacheEntry *entry;
+
+	if( cache->size == 0 )
+		return;
+
+	entry = g_new( GatewayCacheEntry, 1 );
+	entry->key = g_strdup( key );
+	entry->body = g_bytes_ref( body );
+	entry->expires = g_get_monotonic_time() + cache->ttl;
+	entry->link = (GList){ entry, NULL, NULL };
+
+	g_mutex_lock( &cache->mutex );
+
+	/* another thread may have answered the same request meanwhile */
+	if( g_hash_table_contains( cache->entries, key ) )
+		cache_remove( cache, g_hash_table_lookup( cache->entries, key ) );
+
+	g_hash_table_insert( cache->entries, entry->key, entry );
+	g_queue_push_tail_link( &cache->order, &entry->link );
+	while( g_queue_get_length( &cache->order ) > cache->size )
+		cache_remove( cache, g_queue_peek_head( &cache->order ) );
+
+	g_mutex_unlock( &cache->mutex );
+}
+
+static void
+json_append_string(
+	GString *body,
+	const gchar *string,
+	gsize length )
+{
+	const gchar *s, *end;
+
+	g_string_append_c( body, '"' );
+	for( s = string, end = string + length; s < end; ++s )
+	{
+		switch( *s )
+		{
+			case '"':
+				g_string_append( body, "\\\"" );
+				break;
+			case '\\':
+				g_string_append( body, "\\\\" );
+				break;
+			case '\n':
+				g_string_append( body, "\\n" );
+				break;
+			case '\r':
+				g_string_append( body, "\\r" );
+				break;
+			case '\t':
+				g_string_append( body, "\\t" );
+				break;
+			default:
+				if( (guchar)*s < 0x20 )
+					g_string_append_printf( body, "\\u%04x", (guint)(guchar)*s );
+				else
+					g_string_append_c( body, *s );
+				break;
+		}
+	}
+	g_string_append_c( body, '"' );
+}
+
+/* appends an object of n string members, a comma is put before it unless it is the first one in an array, a length of -1 means a NUL-terminated value */
+static void
+json_append_object(
+	GString *body,
+	guint n,
+	const gchar **names,
+	const gchar **values,
+	const gssize *lengths )
+{
+	guint i;
+
+	if( body->str[body->len - 1] != '[' )
+		g_string_append_c( body, ',' );
+
+	g_string_append_c( body, '{' );
+	for( i = 0; i < n; ++i )
+	{
+		if( i > 0 )
+			g_string_append_c( body, ',' );
+		json_append_string( body, names[i], strlen( names[i] ) );
+		g_string_append_c( body, ':' );
+		json_append_string( body, values[i], ( lengths == NULL || lengths[i] < 0 ) ? strlen( values[i] ) : (gsize)lengths[i] );
+	}
+	g_string_append_c( body, '}' );
+}
+
+static void
+json_append_pairs(
+	GString *body,
+	const gchar *name,
+	const gchar **names,
+	glong number,
+	GStrv first,
+	GStrv second )
+{
+	const gchar *values[2];
+	glong i;
+
+	g_string_append_printf( body, "{\"%s\":[", name );
+	for( i = 0; i < number; ++i )
+	{
+		values[0] = first[i];
+		values[1] = second[i];
+		json_append_object( body, 2, names, values, NULL );
+	}
+	g_string_append( body, "]}" );
+}
+
+static void
+on_definition(
+	DictClient *client,
+	const gchar *word,
+	const gchar *database,
+	const gchar *description,
+	const gchar *definition,
+	gsize length,
+	gpointer user_data )
+{
+	static const gchar *names[4] = { "word", "database", "description", "definition" };
+	const gchar *values[4] = { word, database, description, definition };
+	const gssize lengths[4] = { -1, -1, -1, (gssize)length };
+
+	json_append_object( user_data, 4, names, values, lengths );
+}
+
+static void
+on_match(
+	DictClient *client,
+	const gchar *database,
+	const gchar *word,
+	gpointer user_data )
+{
+	static const gchar *names[2] = { "database", "word" };
+	const gchar *values[2] = { database, word };
+
+	json_append_object( user_data, 2, names, values, NULL );
+}
+
+static const gchar*
+param_get(
+	GHashTable *params,
+	const gchar *name,
+	const gchar *fallback )
+{
+	const gchar *value;
+
+	value = params != NULL ? g_hash_table_lookup( params, name ) : NULL;
+
+	return value != NULL ? value : fallback;
+}
+
+/*
+Runs the query of the path through the client and writes the JSON body.
+Returns an HTTP status, errors of the client are returned in error.
+*/
+static guint
+gateway_query(
+	DictClient *dc,
+	const gchar *path,
+	GHashTable *params,
+	GString *body,
+	GError **error )
+{
+	static const gchar *database_names[2] = { "database", "description" };
+	static const gchar *strategy_names[2] = { "strategy", "description" };
+	const gchar *word, *database;
+	gchar *info = NULL;
+	GStrv data, descriptions;
+	glong num;
+	GError *loc_error = NULL;
+
+	word = param_get( params, "word", NULL );
+	database = param_get( params, "database", "*" );
+
+	if( g_strcmp0( path, "/define" ) == 0 || g_strcmp0( path, "/match" ) == 0 )
+	{
+		if( word == NULL )
+		{
+			g_string_assign( body, "{\"error\":\"No word\"}" );
+			return 400;
+		}
+
+		if( g_strcmp0( path, "/define" ) == 0 )
+		{
+			g_string_append( body, "{\"definitions\":[" );
+			dict_client_define_foreach( dc, database, word, on_definition, body, &loc_error );
+		}
+		else
+		{
+			g_string_append( body, "{\"matches\":[" );
+			dict_client_match_foreach( dc, database, param_get( params, "strategy", "prefix" ), word, on_match, body, &loc_error );
+		}
+		g_string_append( body, "]}" );
+	}
+	else if( g_strcmp0( path, "/show/databases" ) == 0 )
+	{
+		num = dict_client_show_databases( dc, &data, &descriptions, &loc_error );
+		if( loc_error == NULL )
+		{
+			json_append_pairs( body, "databases", database_names, num, data, descriptions );
+			g_strfreev( data );
+			g_strfreev( descriptions );
+		}
+	}
+	else if( g_strcmp0( path, "/show/strategies" ) == 0 )
+	{
+		num = dict_client_show_strategies( dc, &data, &descriptions, &loc_error );
+		if( loc_error == NULL )
+		{
+			json_append_pairs( body, "strategies", strategy_names, num, data, descriptions );
+			g_strfreev( data );
+			g_strfreev( descriptions );
+		}
+	}
+	else if( g_strcmp0( path, "/show/info" ) == 0 )
+		info = dict_client_show_info( dc, database, &loc_error );
+	else if( g_strcmp0( path, "/show/server" ) == 0 )
+		info = dict_client_show_server( dc, &loc_error );
+	else
+	{
+		g_string_assign( body, "{\"error\":\"Not found\"}" );
+		return 404;
+	}
+
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return 502;
+	}
+
+	if( info != NULL )
+	{
+		g_string_append( body, "{\"text\":" );
+		json_append_string( body, info, strlen( info ) );
+		g_string_append_c( body, '}' );
+		g_free( info );
+	}
+
+	return 200;
+}
+
+/* maps refusals of the dict server to HTTP statuses */
+static guint
+error_status(
+	const GError *error )
+{
+	if( error->domain != DICT_CLIENT_ERROR )
+		return 502;
+
+	switch( error->code )
+	{
+		case DICT_CLIENT_ERROR_SYNTAX_ERROR_ILLEGAL_PARAMETERS:
+		case DICT_CLIENT_ERROR_INVALID_DATABASE_USE_SHOW_DB_FOR_LIST_OF_DATABASES:
+		case DICT_CLIENT_ERROR_INVALID_STRATEGY_USE_SHOW_STRAT_FOR_A_LIST_OF_STRATEGIES:
+			return 400;
+
+		case DICT_CLIENT_ERROR_ACCESS_DENIED:
+		case DICT_CLIENT_ERROR_ACCESS_DENIED_USE_SHOW_INFO_FOR_SERVER_INFORMATION:
+		case DICT_CLIENT_ERROR_ACCESS_DENIED_UNKNOWN_MECHANISM:
+			return 403;
+
+		case DICT_CLIENT_ERROR_SERVER_TEMPORARY_UNAVAILABLE:
+		case DICT_CLIENT_ERROR_SERVER_SHUTTING_DOWN_AT_OPERATOR_REQUEST:
+			return 503;
+
+		default:
+			return 502;
+	}
+}
+
+/* answers a request target, the body is taken from the cache if possible */
+static guint
+gateway_handle(
+	Gateway *gateway,
+	const gchar *target,
+	GBytes **body )
+{
+	DictClient *dc;
+	GHashTable *params = NULL;
+	GString *buffer;
+	gchar *path;
+	const gchar *query;
+	guint status = 502, attempt;
+	GError *error = NULL;
+
+	*body = cache_lookup( &gateway->cache, target );
+	if( *body != NULL )
+		return 200;
+
+	buffer = g_string_new( NULL );
+	query = strchr( target, '?' );
+	path = query != NULL ? g_strndup( target, query - target ) : g_strdup( target );
+	if( query != NULL )
+		params = g_uri_parse_params( query + 1, -1, "&", G_URI_PARAMS_WWW_FORM, NULL );
+
+	if( query != NULL && params == NULL )
+	{
+		g_string_assign( buffer, "{\"error\":\"Invalid query\"}" );
+		status = 400;
+		goto out;
+	}
+
+	/* a pooled connection may have been closed by the server while idle, so a failed query is sent once more */
+	dc = g_async_queue_pop( gateway->pool );
+	for( attempt = 0; attempt < 2; ++attempt )
+	{
+		g_clear_error( &error );
+		g_string_truncate( buffer, 0 );
+
+		if( !dict_client_is_connected( dc ) && !dict_client_connect( dc, gateway->host, gateway->port, NULL, NULL, &error ) )
+			break;
+
+		status = gateway_query( dc, path, params, buffer, &error );
+		if( error == NULL || !dict_client_error_is_connection( error ) )
+			break;
+
+		if( dict_client_is_connected( dc ) )
+			dict_client_disconnect( dc, NULL, NULL );
+	}
+	g_async_queue_push( gateway->pool, dc );
+
+	if( error != NULL )
+	{
+		status = error_status( error );
+		g_string_assign( buffer, "{\"error\":" );
+		json_append_string( buffer, error->message, strlen( error->message ) );
+		g_string_append_c( buffer, '}' );
+		g_error_free( error );
+	}
+
+out:
+	*body = g_string_free_to_bytes( buffer );
+	if( status == 200 )
+		cache_insert( &gateway->cache, target, *body );
+
+	if( params != NULL )
+		g_hash_table_unref( params );
+	g_free( path );
+
+	return status;
+}
+
+static const gchar*
+status_reason(
+	guint status )
+{
+	switch( status )
+	{
+		case 200: return "OK";
+		case 400: return "Bad Request";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 503: return "Service Unavailable";
+		default: return "Bad Gateway";
+	}
+}
+
+/*
+Serves requests of one HTTP connection in its own thread.
+HTTP/1.1 connections are kept alive unless the client asks to close, HTTP/1.0 ones only if the client asks to keep them.
+*/
+static gboolean
+on_run(
+	GThreadedSocketService *service,
+	GSocketConnection *connection,
+	GObject *source_object,
+	gpointer user_data )
+{
+	Gateway *gateway = user_data;
+	GDataInputStream *input;
+	GOutputStream *output;
+	GString *header;
+	GBytes *body;
+	gchar *line, *value, **request;
+	gboolean keep_alive, head;
+	guint status, n_headers;
+	guint64 content_length;
+	GError *error = NULL;
+
+	/* idle keep-alive connections must not hold the threads forever */
+	g_socket_set_timeout( g_socket_connection_get_socket( connection ), DEFAULT_IDLE_TIMEOUT );
+
+	input = g_data_input_stream_new( g_io_stream_get_input_stream( G_IO_STREAM( connection ) ) );
+	g_data_input_stream_set_newline_type( input, G_DATA_STREAM_NEWLINE_TYPE_ANY );
+	output = g_io_stream_get_output_stream( G_IO_STREAM( connection ) );
+	header = g_string_new( NULL );
+
+	do
+	{
+		line = g_data_input_stream_read_line( input, NULL, NULL, NULL );
+		if( line == NULL )
+			break;
+
+		request = g_strsplit( line, " ", 3 );
+		g_free( line );
+		if( g_strv_length( request ) != 3 )
+		{
+			g_strfreev( request );
+			break;
+		}
+		keep_alive = g_strcmp0( request[2], "HTTP/1.1" ) == 0;
+		content_length = 0;
+
+		for( n_headers = 0; ( line = g_data_input_stream_read_line( input, NULL, NULL, NULL ) ) != NULL && *line != '\0' && n_headers < MAX_HEADERS; ++n_headers )
+		{
+			if( g_ascii_strncasecmp( line, "Connection:", strlen( "Connection:" ) ) == 0 )
+			{
+				value = g_strstrip( line + strlen( "Connection:" ) );
+				if( g_ascii_strcasecmp( value, "close" ) == 0 )
+					keep_alive = FALSE;
+				else if( g_ascii_strcasecmp( value, "keep-alive" ) == 0 )
+					keep_alive = TRUE;
+			}
+			else if( g_ascii_strncasecmp( line, "Content-Length:", strlen( "Content-Length:" ) ) == 0 )
+				content_length = g_ascii_strtoull( line + strlen( "Content-Length:" ), NULL, 10 );
+			g_free( line );
+		}
+		if( line == NULL || *line != '\0' )
+		{
+			g_free( line );
+			g_strfreev( request );
+			break;
+		}
+		g_free( line );
+
+		/* requests have no use for a body */
+		if( content_length > 0 && g_input_stream_skip( G_INPUT_STREAM( input ), content_length, NULL, NULL ) != (gssize)content_length )
+		{
+			g_strfreev( request );
+			break;
+		}
+
+		head = g_strcmp0( request[0], "HEAD" ) == 0;
+		if( head || g_strcmp0( request[0], "GET" ) == 0 )
+			status = gateway_handle( gateway, request[1], &body );
+		else
+		{
+			status = 405;
+			body = g_bytes_new_static( "{\"error\":\"Method not allowed\"}", strlen( "{\"error\":\"Method not allowed\"}" ) );
+		}
+		g_strfreev( request );
+
+		g_string_printf( header,
+			"HTTP/1.1 %u %s\r\n"
+			"Content-Type: application/json; charset=utf-8\r\n"
+			"Content-Length: %" G_GSIZE_FORMAT "\r\n"
+			"Connection: %s\r\n"
+			"\r\n",
+			status, status_reason( status ),
+			g_bytes_get_size( body ),
+			keep_alive ? "keep-alive" : "close" );
+
+		g_output_stream_write_all( output, header->str, header->len, NULL, NULL, &error );
+		if( error == NULL && !head )
+			g_output_stream_write_all( output, g_bytes_get_data( body, NULL ), g_bytes_get_size( body ), NULL, NULL, &error );
+		g_bytes_unref( body );
+	}
+	while( error == NULL && keep_alive );
+
+	g_clear_error( &error );
+	g_string_free( header, TRUE );
+	g_object_unref( input );
+
+	return TRUE;
+}
+
+int
+main(
+	int argc,
+	char *argv[] )
+{
+	gchar *host = NULL;
+	gint port = 2628;
+	gint listen_port = DEFAULT_LISTEN_PORT;
+	gint connections = DEFAULT_CONNECTIONS;
+	gint threads = DEFAULT_THREADS;
+	gint cache_size = DEFAULT_CACHE_SIZE;
+	gint cache_ttl = DEFAULT_CACHE_TTL;
+	const GOptionEntry option_entries[] =
+	{
+		{ "host", 'h', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &host, "A host address of the dict server. Default is localhost.", "HOST" },
+		{ "port", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &port, "A port number of the dict server. Default is 2628.", "PORT" },
+		{ "listen", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &listen_port, "A port number to serve HTTP on. Default is 8080.", "PORT" },
+		{ "connections", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &connections, "A number of connections to the dict server. Default is 4.", "NUMBER" },
+		{ "threads", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &threads, "A number of HTTP connections served at once. Default is 16.", "NUMBER" },
+		{ "cache-size", 'C', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &cache_size, "A number of responses kept in the cache, 0 disables it. Default is 1024.", "NUMBER" },
+		{ "cache-ttl", 'T', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &cache_ttl, "A time in seconds a cached response is valid. Default is 300.", "SECONDS" },
+		{ NULL }
+	};
+
+	GOptionContext *option_context;
+	GSocketService *service;
+	GMainLoop *loop;
+	Gateway gateway;
+	DictClient *dc;
+	gint i;
+	GError *error = NULL;
+
+	setlocale( LC_ALL, "" );
+
+	option_context = g_option_context_new( NULL );
+	g_option_context_set_summary( option_context, GATEWAY_APP_SUMMARY );
+	g_option_context_set_help_enabled( option_context, TRUE );
+	g_option_context_add_main_entries( option_context, option_entries, NULL );
+
+	g_option_context_parse( option_context, &argc, &argv, &error );
+	g_option_context_free( option_context );
+	if( error == NULL && ( connections < 1 || threads < 1 || cache_size < 0 || cache_ttl < 0 || listen_port < 1 || listen_port > G_MAXUINT16 ) )
+		g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Numbers of connections and threads must be positive, cache options must not be negative" );
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_free( host );
+		return EXIT_FAILURE;
+	}
+
+	/* if options are not set, set to deafults */
+	if( host == NULL )
+		host = g_strdup( "localhost" );
+
+	gateway.host = host;
+	gateway.port = port;
+	cache_init( &gateway.cache, cache_size, cache_ttl );
+
+	/* clients connect on the first request */
+	gateway.pool = g_async_queue_new_full( g_object_unref );
+	for( i = 0; i < connections; ++i )
+	{
+		dc = dict_client_new();
+		g_async_queue_push( gateway.pool, dc );
+	}
+
+	service = g_threaded_socket_service_new( threads );
+	if( !g_socket_listener_add_inet_port( G_SOCKET_LISTENER( service ), listen_port, NULL, &error ) )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_object_unref( service );
+		g_async_queue_unref( gateway.pool );
+		cache_clear( &gateway.cache );
+		g_free( host );
+		return EXIT_FAILURE;
+	}
+	g_signal_connect( service, "run", G_CALLBACK( on_run ), &gateway );
+	g_socket_service_start( service );
+
+	loop = g_main_loop_new( NULL, FALSE );
+	g_main_loop_run( loop );
+
+	g_main_loop_unref( loop );
+	g_socket_service_stop( service );
+	g_object_unref( service );
+	g_async_queue_unref( gateway.pool );
+	cache_clear( &gateway.cache );
+	g_free( host );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include "glibdictcapture.h"
+
+#define DEFAULT_CAPTURE_BUFFER_LEN 65536
+
+#define G_TYPE_DICT_CAPTURE_INPUT_STREAM ( dict_capture_input_stream_get_type() )
+G_DECLARE_FINAL_TYPE( DictCaptureInputStream, dict_capture_input_stream, DICT, CAPTURE_INPUT_STREAM, GFilterInputStream )
+
+#define G_TYPE_DICT_CAPTURE_OUTPUT_STREAM ( dict_capture_output_stream_get_type() )
+G_DECLARE_FINAL_TYPE( DictCaptureOutputStream, dict_capture_output_stream, DICT, CAPTURE_OUTPUT_STREAM, GFilterOutputStream )
+
+struct _DictCaptureInputStream
+{
+	GFilterInputStream parent_instance;
+
+	/* NULL after a write error, the connection goes on without capturing */
+	GOutputStream *capture;
+	gint64 start;
+};
+
+struct _DictCaptureOutputStream
+{
+	GFilterOutputStream parent_instance;
+
+	GOutputStream *capture;
+	gint64 start;
+};
+
+G_DEFINE_FINAL_TYPE( DictCaptureInputStream, dict_capture_input_stream, G_TYPE_FILTER_INPUT_STREAM )
+G_DEFINE_FINAL_TYPE( DictCaptureOutputStream, dict_capture_output_stream, G_TYPE_FILTER_OUTPUT_STREAM )
+
+/**
+\anchor capture_write_record
+\brief Appends a record to the capture.
+
+\param[in] capture A capture stream.
+\param[in] type A type of the record.
+\param[in] time A time of the record.
+\param[in] data Data of the record.
+\param[in] length A length of the \c data.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+static gboolean
+capture_write_record(
+	GOutputStream *capture,
+	gchar type,
+	gint64 time,
+	const void *data,
+	gsize length,
+	GError **error )
+{
+	guint8 header[CAPTURE_HEADER_LEN];
+	guint64 be_time;
+	guint32 be_length;
+
+	be_time = GUINT64_TO_BE( (guint64)time );
+	be_length = GUINT32_TO_BE( (guint32)length );
+	header[0] = (guint8)type;
+	memcpy( header + 1, &be_time, sizeof( be_time ) );
+	memcpy( header + 1 + sizeof( be_time ), &be_length, sizeof( be_length ) );
+
+	if( !g_output_stream_write_all( capture, header, CAPTURE_HEADER_LEN, NULL, NULL, error ) )
+		return FALSE;
+
+	return g_output_stream_write_all( capture, data, length, NULL, NULL, error );
+}
+
+/* a failed capture must not break the connection */
+static void
+capture_stop(
+	GOutputStream **capture,
+	GError *error )
+{
+	g_log_structured( LIBRARY_NAME, G_LOG_LEVEL_WARNING,
+		"MESSAGE", "Capture stopped: %s", error->message,
+		NULL );
+	g_error_free( error );
+	g_clear_object( capture );
+}
+
+static gssize
+dict_capture_input_stream_read(
+	GInputStream *stream,
+	void *buffer,
+	gsize count,
+	GCancellable *cancellable,
+	GError **error )
+{
+	DictCaptureInputStream *self = DICT_CAPTURE_INPUT_STREAM( stream );
+	GInputStream *base_stream = g_filter_input_stream_get_base_stream( G_FILTER_INPUT_STREAM( stream ) );
+	gssize read;
+	GError *loc_error = NULL;
+
+	read = g_input_stream_read( base_stream, buffer, count, cancellable, error );
+	if( read > 0 && self->capture != NULL )
+	{
+		if( !capture_write_record( self->capture, CAPTURE_RECORD_RECEIVED, g_get_monotonic_time() - self->start, buffer, read, &loc_error ) )
+			capture_stop( &self->capture, loc_error );
+	}
+
+	return read;
+}
+
+static void
+dict_capture_input_stream_dispose(
+	GObject *object )
+{
+	DictCaptureInputStream *self = DICT_CAPTURE_INPUT_STREAM( object );
+
+	g_clear_object( &self->capture );
+
+	G_OBJECT_CLASS( dict_capture_input_stream_parent_class )->dispose( object );
+}
+
+static void
+dict_capture_input_stream_init(
+	DictCaptureInputStream *self )
+{
+}
+
+static void
+dict_capture_input_stream_class_init(
+	DictCaptureInputStreamClass *klass )
+{
+	GObjectClass *object_class = G_OBJECT_CLASS( klass );
+	GInputStreamClass *input_stream_class = G_INPUT_STREAM_CLASS( klass );
+
+	object_class->dispose = dict_capture_input_stream_dispose;
+
+	/* DictClient never skips, so skipped bytes are not recorded */
+	input_stream_class->read_fn = dict_capture_input_stream_read;
+}
+
+static gssize
+dict_capture_output_stream_write(
+	GOutputStream *stream,
+	const void *buffer,
+	gsize count,
+	GCancellable *cancellable,
+	GError **error )
+{
+	DictCaptureOutputStream *self = DICT_CAPTURE_OUTPUT_STREAM( stream );
+	GOutputStream *base_stream = g_filter_output_stream_get_base_stream( G_FILTER_OUTPUT_STREAM( stream ) );
+	gssize written;
+	GError *loc_error = NULL;
+
+	written = g_output_stream_write( base_stream, buffer, count, cancellable, error );
+	if( written > 0 && self->capture != NULL )
+	{
+		/* a command is a good point to flush, at most the last response is not on disk yet */
+		if( !capture_write_record( self->capture, CAPTURE_RECORD_SENT, g_get_monotonic_time() - self->start, buffer, written, &loc_error ) ||
+			!g_output_stream_flush( self->capture, NULL, &loc_error ) )
+		{
+			capture_stop( &self->capture, loc_error );
+		}
+	}
+
+	return written;
+}
+
+static void
+dict_capture_output_stream_dispose(
+	GObject *object )
+{
+	DictCaptureOutputStream *self = DICT_CAPTURE_OUTPUT_STREAM( object );
+
+	g_clear_object( &self->capture );
+
+	G_OBJECT_CLASS( dict_capture_output_stream_parent_class )->dispose( object );
+}
+
+static void
+dict_capture_output_stream_init(
+	DictCaptureOutputStream *self )
+{
+}
+
+static void
+dict_capture_output_stream_class_init(
+	DictCaptureOutputStreamClass *klass )
+{
+	GObjectClass *object_class = G_OBJECT_CLASS( klass );
+	GOutputStreamClass *output_stream_class = G_OUTPUT_STREAM_CLASS( klass );
+
+	object_class->dispose = dict_capture_output_stream_dispose;
+
+	output_stream_class->write_fn = dict_capture_output_stream_write;
+}
+
+/**
+\anchor capture_open
+\brief Opens a capture file and starts a session in it.
+
+The file is created if it does not exist, otherwise the session is appended to it.
+
+\param[in] filename A path of the capture file.
+\param[in] host An address of the server.
+\param[in] port A port number of the server.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A new buffered stream of the file or NULL on error.
+*/
+GOutputStream*
+capture_open(
+	const gchar *filename,
+	const gchar *host,
+	guint16 port,
+	GError **error )
+{
+	GFile *file;
+	GFileOutputStream *file_output;
+	GOutputStream *capture;
+	gchar *address;
+	gboolean ok;
+
+	file = g_file_new_for_path( filename );
+	file_output = g_file_append_to( file, G_FILE_CREATE_NONE, NULL, error );
+	g_object_unref( file );
+	if( file_output == NULL )
+		return NULL;
+
+	capture = g_buffered_output_stream_new_sized( G_OUTPUT_STREAM( file_output ), DEFAULT_CAPTURE_BUFFER_LEN );
+	g_object_unref( file_output );
+
+	address = g_strdup_printf( "%s:%u", host, (guint)port );
+	ok = capture_write_record( capture, CAPTURE_RECORD_SESSION, g_get_real_time(), address, strlen( address ), error );
+	g_free( address );
+	if( !ok )
+	{
+		g_object_unref( capture );
+		return NULL;
+	}
+
+	return capture;
+}
+
+/**
+\anchor capture_input_stream_new
+\brief Creates a stream recording bytes read from \c base_stream.
+
+\param[in] base_stream A stream to read from, it is not closed with the new stream.
+\param[in] capture A stream returned by \ref capture_open "capture_open()".
+\param[in] start A monotonic time of the session start.
+
+\return A new input stream.
+*/
+GInputStream*
+capture_input_stream_new(
+	GInputStream *base_stream,
+	GOutputStream *capture,
+	gint64 start )
+{
+	DictCaptureInputStream *self;
+
+	self = g_object_new( G_TYPE_DICT_CAPTURE_INPUT_STREAM,
+		"base-stream", base_stream,
+		"close-base-stream", FALSE,
+		NULL );
+	self->capture = g_object_ref( capture );
+	self->start = start;
+
+	return G_INPUT_STREAM( self );
+}
+
+/**
+\anchor capture_output_stream_new
+\brief Creates a stream recording bytes written to \c base_stream.
+
+\param[in] base_stream A stream to write to, it is not closed with the new stream.
+\param[in] capture A stream returned by \ref capture_open "capture_open()".
+\param[in] start A monotonic time of the session start.
+
+\return A new output stream.
+*/
+GOutputStream*
+capture_output_stream_new(
+	GOutputStream *base_stream,
+	GOutputStream *capture,
+	gint64 start )
+{
+	DictCaptureOutputStream *self;
+
+	self = g_object_new( G_TYPE_DICT_CAPTURE_OUTPUT_STREAM,
+		"base-stream", base_stream,
+		"close-base-stream", FALSE,
+		NULL );
+	self->capture = g_object_ref( capture );
+	self->start = start;
+
+	return G_OUTPUT_STREAM( self );
+}
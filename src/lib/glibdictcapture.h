@@ -0,0 +1,26 @@
+/*
+Internal filter streams recording the traffic of DictClient to a capture file.
+
+A capture file is a sequence of records, every record is a type byte, a 64-bit time in microseconds and a 32-bit length of the following data, the numbers are big-endian. A session record starts every connection, its time is the wall clock time of the connection and its data is "host:port". Sent and received records follow it, their times are counted from the start of the session and their data are the bytes as they were written to or read from the socket.
+*/
+
+#ifndef GLIB_DICT_CAPTURE_H
+#define GLIB_DICT_CAPTURE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define CAPTURE_RECORD_SESSION 'S'
+#define CAPTURE_RECORD_SENT '>'
+#define CAPTURE_RECORD_RECEIVED '<'
+#define CAPTURE_HEADER_LEN 13
+
+G_GNUC_INTERNAL GOutputStream* capture_open( const gchar *filename, const gchar *host, guint16 port, GError **error );
+G_GNUC_INTERNAL GInputStream* capture_input_stream_new( GInputStream *base_stream, GOutputStream *capture, gint64 start );
+G_GNUC_INTERNAL GOutputStream* capture_output_stream_new( GOutputStream *base_stream, GOutputStream *capture, gint64 start );
+
+G_END_DECLS
+
+#endif
@@ -1,25 +1,141 @@
+#include "config.h"
+
 #include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 #include <gio/gio.h>
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+#include "glibdictcapture.h"
 #include "glibdictclient.h"
+#include "glibdictdefinition.h"
+#include "glibdictengine.h"
+#include "glibdictprobes.h"
+#include "glibdictprotocol.h"
 
 #define DEFAULT_RECEIVE_TEXT_LEN 6144
+#define DEFAULT_COMMAND_LEN 1024
+
+/* about 1% of false positives */
+#define DEFAULT_FILTER_BITS_PER_WORD 10
+#define DEFAULT_FILTER_HASHES 7
+/* a file asking for more hashes is damaged, every lookup would compute them all */
+#define MAX_FILTER_HASHES 32
+
+#define DEFAULT_RESOLVER_TTL 60
+#define DEFAULT_CONNECT_DELAY 250
+
+#define DEFAULT_CACHE_SIZE 0
+#define DEFAULT_PREFETCH_BUDGET 0
+#define DEFAULT_PREFETCH_DEPTH 1
+
+#define DEFAULT_SLOW_THRESHOLD 0
+#define DEFAULT_TEXT_LIMIT 0
+#define DEFAULT_LAZY_CONNECT FALSE
+#define DEFAULT_FAST_OPEN FALSE
+#define DEFAULT_FAN_OUT 0
+#define SPILL_TEMPLATE "glibdictclient-XXXXXX"
+#define TRACE_COMMAND_LEN 128
+
+#define FILTER_MAGIC "DCBF"
+#define FILTER_VERSION 1
+#define FILTER_HEADER_LEN 24
+
+struct _DictFilter
+{
+	guint64 n_bits;
+	guint32 n_hashes;
+	GBytes *bits;
+};
+typedef struct _DictFilter DictFilter;
+
+struct _DictResolverEntry
+{
+	GList *addresses;
+	gint64 resolved;
+};
+typedef struct _DictResolverEntry DictResolverEntry;
+
+struct _DictConnectRace
+{
+	GMainContext *context;
+	GPtrArray *attempts;
+	GSocket *winner;
+	GError *error;
+	gboolean delay_expired;
+	gboolean fast_open;
+};
+typedef struct _DictConnectRace DictConnectRace;
+
+struct _DictConnectAttempt
+{
+	DictConnectRace *race;
+	GSocket *socket;
+	GSource *source;
+};
+typedef struct _DictConnectAttempt DictConnectAttempt;
+
+struct _DictCacheEntry
+{
+	gchar *key;
+	glong number;
+	GStrv words;
+	GStrv databases;
+	GStrv descriptions;
+	GStrv definitions;
+
+	/* position in the order of use */
+	GList link;
+};
+typedef struct _DictCacheEntry DictCacheEntry;
+
+/* a DEFINE command sent ahead, its response is not read yet */
+struct _DictPrefetch
+{
+	DictClient *self;
+	gchar *database;
+	gchar *key;
+	guint depth;
+};
+typedef struct _DictPrefetch DictPrefetch;
+
+/* a result of DEFINE in one database of a fan-out */
+struct _DictFanResult
+{
+	glong number;
+	GStrv words;
+	GStrv databases;
+	GStrv descriptions;
+	GStrv definitions;
+	gboolean failed;
+	guint *remaining;
+};
+typedef struct _DictFanResult DictFanResult;
 
-#define pstrnullv( pstrv ) do { if( ( pstrv ) != NULL ) *( pstrv ) = NULL; } while( FALSE )
-#define pstrallocv_number( pstrv, number ) do { if( ( pstrv ) != NULL ) *( pstrv ) = g_new( gchar*, (number) ); } while( FALSE )
-#define pstrnullv_index( pstrv, index ) do { if( ( pstrv ) != NULL ) (*( pstrv ))[(index)] = NULL; } while( FALSE )
-#define pstrfreev( pstrv ) do { if( ( pstrv ) != NULL ) g_strfreev( *( pstrv ) ); } while( FALSE )
+struct _DictTraceHeader
+{
+	gint64 time;
+	gchar *database;
+};
+typedef struct _DictTraceHeader DictTraceHeader;
 
-struct _DictResponse
+/* phases of the current request, times are monotonic microseconds */
+struct _DictTrace
 {
-	glong *code;
-	glong *number;
-	gchar **message;
-	gchar **word;
-	gchar **database;
-	gchar **description;
+	gint64 threshold;
+
+	guint id;
+	gchar command[TRACE_COMMAND_LEN];
+	gint64 start;
+	gint64 sent;
+	gint64 first_status;
+	GArray *headers;
+	gsize bytes_sent;
+	gsize bytes_received;
 };
-typedef struct _DictResponse DictResponse;
+typedef struct _DictTrace DictTrace;
 
 struct _DictClient
 {
@@ -27,11 +143,56 @@ struct _DictClient
 
 	gchar *host;
 	guint16 port;
+	guint resolver_ttl;
+	guint connect_delay;
 
-	GSocketClient *socket;
 	GIOStream *iostream;
 	GDataInputStream *data_input;
-	GDataOutputStream *data_output;
+	GOutputStream *output;
+	GString *command;
+
+	GHashTable *filters;
+
+	/* definitions by database and casefolded word, the least recently used at the head */
+	guint cache_size;
+	GHashTable *cache;
+	GQueue cache_order;
+
+	guint prefetch_budget;
+	guint prefetch_depth;
+	guint prefetch_remaining;
+	GQueue prefetch;
+	DictEngine *prefetch_engine;
+
+	/* NULL unless slow requests are logged */
+	DictTrace *trace;
+
+	/* NULL unless the traffic is recorded */
+	gchar *capture_file;
+
+	/* 0 means no limit */
+	guint text_limit;
+
+	/* a connection deferred until the first command, host is NULL until it is made */
+	gboolean lazy_connect;
+	gchar *lazy_host;
+	guint16 lazy_port;
+	GSocketAddress *lazy_address;
+	gchar *lazy_message;
+
+	gboolean fast_open;
+
+	/* "*" lookups split by database, the engine and the databases are made on the first one */
+	guint fan_out;
+	DictEngine *fan_engine;
+	GStrv fan_databases;
+
+	/* a MATCH sent right behind every DEFINE, NULL disables it; the suggestions are kept only if nothing was found */
+	gchar *suggest_strategy;
+	gboolean suggest_pending;
+	glong suggest_number;
+	GStrv suggest_databases;
+	GStrv suggest_words;
 };
 typedef struct _DictClient DictClient;
 
@@ -41,6 +202,18 @@ enum _DictClientPropertyID
 
 	PROP_HOST,
 	PROP_PORT,
+	PROP_RESOLVER_TTL,
+	PROP_CONNECT_DELAY,
+	PROP_CACHE_SIZE,
+	PROP_PREFETCH_BUDGET,
+	PROP_PREFETCH_DEPTH,
+	PROP_SLOW_THRESHOLD,
+	PROP_CAPTURE_FILE,
+	PROP_TEXT_LIMIT,
+	PROP_LAZY_CONNECT,
+	PROP_FAST_OPEN,
+	PROP_FAN_OUT,
+	PROP_SUGGEST_STRATEGY,
 
 	N_PROPS
 };
@@ -48,6 +221,368 @@ typedef enum _DictClientPropertyID DictClientPropertyID;
 
 static GParamSpec *object_props[N_PROPS] = { NULL, };
 
+/* request IDs are unique among all instances */
+static gint trace_counter = 0;
+
+/* resolved addresses are shared by all instances */
+static GHashTable *resolver_cache = NULL;
+G_LOCK_DEFINE_STATIC( resolver_cache );
+
+static void
+filter_free(
+	DictFilter *filter )
+{
+	g_bytes_unref( filter->bits );
+	g_free( filter );
+}
+
+/* the server compares headwords case-insensitively and ignores punctuation, so does the filter */
+static gchar*
+filter_normalize_word(
+	const gchar *word,
+	gssize length )
+{
+	GString *key;
+	gchar *folded, *s;
+	gunichar c;
+	gboolean space = FALSE;
+
+	folded = g_utf8_casefold( word, length );
+	key = g_string_sized_new( strlen( folded ) );
+	for( s = folded; *s != '\0'; s = g_utf8_next_char( s ) )
+	{
+		c = g_utf8_get_char( s );
+		if( g_unichar_isspace( c ) )
+		{
+			space = key->len > 0;
+			continue;
+		}
+		if( !g_unichar_isalnum( c ) )
+			continue;
+
+		if( space )
+			g_string_append_c( key, ' ' );
+		g_string_append_unichar( key, c );
+		space = FALSE;
+	}
+	g_free( folded );
+
+	return g_string_free( key, FALSE );
+}
+
+/* 64-bit FNV-1a, must be stable as filters are stored in files */
+static guint64
+filter_hash(
+	const gchar *key )
+{
+	guint64 hash = 14695981039346656037ULL;
+
+	for( ; *key != '\0'; key++ )
+	{
+		hash ^= (guint8)*key;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static void
+filter_add(
+	guint8 *bits,
+	guint64 n_bits,
+	guint32 n_hashes,
+	const gchar *word,
+	gssize length )
+{
+	gchar *key;
+	guint64 hash, h1, h2, bit;
+	guint32 i;
+
+	key = filter_normalize_word( word, length );
+	hash = filter_hash( key );
+	g_free( key );
+
+	/* double hashing: i-th bit is h1 + i * h2 */
+	h1 = hash & G_MAXUINT32;
+	h2 = ( hash >> 32 ) | 1;
+	for( i = 0; i < n_hashes; ++i )
+	{
+		bit = ( h1 + i * h2 ) % n_bits;
+		bits[bit >> 3] |= (guint8)( 1 << ( bit & 7 ) );
+	}
+}
+
+static gboolean
+filter_contains(
+	DictFilter *filter,
+	const gchar *word )
+{
+	const guint8 *bits;
+	gchar *key;
+	guint64 hash, h1, h2, bit;
+	guint32 i;
+
+	key = filter_normalize_word( word, -1 );
+	hash = filter_hash( key );
+	g_free( key );
+
+	bits = g_bytes_get_data( filter->bits, NULL );
+	h1 = hash & G_MAXUINT32;
+	h2 = ( hash >> 32 ) | 1;
+	for( i = 0; i < filter->n_hashes; ++i )
+	{
+		bit = ( h1 + i * h2 ) % filter->n_bits;
+		if( ( bits[bit >> 3] & ( 1 << ( bit & 7 ) ) ) == 0 )
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static DictFilter*
+filter_new(
+	guint64 number,
+	guint8 **bits )
+{
+	DictFilter *filter;
+
+	filter = g_new( DictFilter, 1 );
+	filter->n_bits = MAX( number, 1 ) * DEFAULT_FILTER_BITS_PER_WORD;
+	filter->n_hashes = DEFAULT_FILTER_HASHES;
+
+	*bits = g_malloc0( ( filter->n_bits + 7 ) / 8 );
+	filter->bits = g_bytes_new_take( *bits, ( filter->n_bits + 7 ) / 8 );
+
+	return filter;
+}
+
+static gboolean
+filter_check_database(
+	const gchar *database,
+	GError **error )
+{
+	/* virtual databases hold no headwords of their own */
+	if( g_strcmp0( database, "*" ) == 0 || g_strcmp0( database, "!" ) == 0 )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_INVALID_FILTER,
+			"Can not use a filter for database %s",
+			database );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+cache_entry_free(
+	DictCacheEntry *entry )
+{
+	g_free( entry->key );
+	g_strfreev( entry->words );
+	g_strfreev( entry->databases );
+	g_strfreev( entry->descriptions );
+	g_strfreev( entry->definitions );
+	g_free( entry );
+}
+
+static void
+cache_trim(
+	DictClient *self,
+	guint size )
+{
+	GList *link;
+
+	while( self->cache_order.length > size )
+	{
+		link = g_queue_pop_head_link( &self->cache_order );
+		g_hash_table_remove( self->cache, ( (DictCacheEntry*)link->data )->key );
+	}
+}
+
+/* servers look up words regardless of case */
+static gchar*
+cache_key(
+	const gchar *database,
+	const gchar *word )
+{
+	gchar *folded, *key;
+
+	folded = g_utf8_casefold( word, -1 );
+	key = g_strconcat( database, "\n", folded, NULL );
+	g_free( folded );
+
+	return key;
+}
+
+static void
+prefetch_free(
+	DictPrefetch *prefetch )
+{
+	g_free( prefetch->database );
+	g_free( prefetch->key );
+	g_free( prefetch );
+}
+
+static void
+trace_header_clear(
+	DictTraceHeader *header )
+{
+	g_free( header->database );
+}
+
+static DictTrace*
+trace_new(
+	guint threshold )
+{
+	DictTrace *trace;
+
+	trace = g_new0( DictTrace, 1 );
+	trace->threshold = (gint64)threshold * 1000;
+	trace->headers = g_array_new( FALSE, FALSE, sizeof( DictTraceHeader ) );
+	g_array_set_clear_func( trace->headers, (GDestroyNotify)trace_header_clear );
+
+	return trace;
+}
+
+static void
+trace_free(
+	DictTrace *trace )
+{
+	g_array_unref( trace->headers );
+	g_free( trace );
+}
+
+/* starts a request at the send of its command, the first line of the command is kept */
+static void
+trace_begin(
+	DictTrace *trace,
+	const GString *command )
+{
+	gsize length;
+
+	if( trace == NULL )
+		return;
+
+	trace->id = (guint)g_atomic_int_add( &trace_counter, 1 ) + 1;
+	trace->start = g_get_monotonic_time();
+	trace->sent = 0;
+	trace->first_status = 0;
+	g_array_set_size( trace->headers, 0 );
+	trace->bytes_sent = command->len;
+	trace->bytes_received = 0;
+
+	for( length = 0; length < command->len && length < TRACE_COMMAND_LEN - 1 && command->str[length] != '\r' && command->str[length] != '\n'; ++length );
+	memcpy( trace->command, command->str, length );
+	trace->command[length] = '\0';
+}
+
+static void
+trace_sent(
+	DictTrace *trace )
+{
+	if( trace != NULL && trace->start != 0 )
+		trace->sent = g_get_monotonic_time();
+}
+
+/* the request is over, it is logged if it took longer than the threshold */
+static void
+trace_end(
+	DictTrace *trace,
+	glong code,
+	const GError *error )
+{
+	DictTraceHeader *header;
+	GString *headers;
+	gint64 now, elapsed;
+	gchar id[16], code_str[16], bytes_sent[24], bytes_received[24], sent[24], first_status[24], done[24];
+	guint i;
+
+	if( trace == NULL || trace->start == 0 )
+		return;
+
+	now = g_get_monotonic_time();
+	elapsed = now - trace->start;
+	trace->start = 0;
+	if( elapsed < trace->threshold )
+		return;
+
+	/* offsets from the start, -1 if the phase was not reached */
+	headers = g_string_new( NULL );
+	for( i = 0; i < trace->headers->len; ++i )
+	{
+		header = &g_array_index( trace->headers, DictTraceHeader, i );
+		g_string_append_printf( headers, "%s%s:%" G_GINT64_FORMAT, i > 0 ? " " : "", header->database != NULL ? header->database : "", header->time - ( now - elapsed ) );
+	}
+	g_snprintf( id, sizeof( id ), "%u", trace->id );
+	g_snprintf( code_str, sizeof( code_str ), "%ld", code );
+	g_snprintf( bytes_sent, sizeof( bytes_sent ), "%" G_GSIZE_FORMAT, trace->bytes_sent );
+	g_snprintf( bytes_received, sizeof( bytes_received ), "%" G_GSIZE_FORMAT, trace->bytes_received );
+	g_snprintf( sent, sizeof( sent ), "%" G_GINT64_FORMAT, trace->sent != 0 ? trace->sent - ( now - elapsed ) : -1 );
+	g_snprintf( first_status, sizeof( first_status ), "%" G_GINT64_FORMAT, trace->first_status != 0 ? trace->first_status - ( now - elapsed ) : -1 );
+	g_snprintf( done, sizeof( done ), "%" G_GINT64_FORMAT, elapsed );
+
+	g_log_structured( LIBRARY_NAME, G_LOG_LEVEL_MESSAGE,
+		"MESSAGE", "Slow request %u took %.3f ms: %s", trace->id, elapsed / 1000.0, trace->command,
+		"DICT_REQUEST_ID", id,
+		"DICT_COMMAND", trace->command,
+		"DICT_CODE", code_str,
+		"DICT_ERROR", error != NULL ? error->message : "",
+		"DICT_BYTES_SENT", bytes_sent,
+		"DICT_BYTES_RECEIVED", bytes_received,
+		"DICT_SENT_USEC", sent,
+		"DICT_FIRST_STATUS_USEC", first_status,
+		"DICT_HEADERS_USEC", headers->str,
+		"DICT_DONE_USEC", done,
+		NULL );
+
+	g_string_free( headers, TRUE );
+}
+
+/* records a status line, a final one ends the request */
+static void
+trace_status(
+	DictTrace *trace,
+	glong code,
+	const gchar *database,
+	gsize length,
+	const GError *error )
+{
+	DictTraceHeader header;
+
+	if( trace == NULL || trace->start == 0 )
+		return;
+
+	header.time = g_get_monotonic_time();
+	trace->bytes_received += length;
+	if( trace->first_status == 0 )
+		trace->first_status = header.time;
+
+	if( code == 151 )
+	{
+		header.database = g_strdup( database );
+		g_array_append_val( trace->headers, header );
+	}
+	else if( code >= 200 || error != NULL )
+		trace_end( trace, code, error );
+}
+
+static void
+trace_text(
+	DictTrace *trace,
+	gsize length,
+	const GError *error )
+{
+	if( trace == NULL || trace->start == 0 )
+		return;
+
+	trace->bytes_received += length;
+	if( error != NULL )
+		trace_end( trace, 0, error );
+}
+
 G_DEFINE_QUARK( g-dict-client-error-quark, dict_client_error )
 
 G_DEFINE_FINAL_TYPE( DictClient, dict_client, G_TYPE_OBJECT )
@@ -63,6 +598,66 @@ dict_client_init(
 
 	value = g_param_spec_get_default_value( object_props[PROP_PORT] );
 	self->port = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_RESOLVER_TTL] );
+	self->resolver_ttl = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_CONNECT_DELAY] );
+	self->connect_delay = g_value_get_uint( value );
+
+	/* commands are built here and sent by flush_commands() */
+	self->command = g_string_sized_new( DEFAULT_COMMAND_LEN );
+
+	self->filters = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, (GDestroyNotify)filter_free );
+
+	value = g_param_spec_get_default_value( object_props[PROP_CACHE_SIZE] );
+	self->cache_size = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_PREFETCH_BUDGET] );
+	self->prefetch_budget = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_PREFETCH_DEPTH] );
+	self->prefetch_depth = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_SLOW_THRESHOLD] );
+	if( g_value_get_uint( value ) > 0 )
+		self->trace = trace_new( g_value_get_uint( value ) );
+
+	value = g_param_spec_get_default_value( object_props[PROP_TEXT_LIMIT] );
+	self->text_limit = g_value_get_uint( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_LAZY_CONNECT] );
+	self->lazy_connect = g_value_get_boolean( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_FAST_OPEN] );
+	self->fast_open = g_value_get_boolean( value );
+
+	value = g_param_spec_get_default_value( object_props[PROP_FAN_OUT] );
+	self->fan_out = g_value_get_uint( value );
+
+	self->suggest_number = -1;
+
+	/* keys are owned by entries */
+	self->cache = g_hash_table_new_full( g_str_hash, g_str_equal, NULL, (GDestroyNotify)cache_entry_free );
+	g_queue_init( &self->cache_order );
+	g_queue_init( &self->prefetch );
+}
+
+static void
+fan_out_clear(
+	DictClient *self )
+{
+	g_clear_object( &self->fan_engine );
+	g_clear_pointer( &self->fan_databases, g_strfreev );
+}
+
+static void
+suggest_clear(
+	DictClient *self )
+{
+	self->suggest_number = -1;
+	g_clear_pointer( &self->suggest_databases, g_strfreev );
+	g_clear_pointer( &self->suggest_words, g_strfreev );
 }
 
 static void
@@ -72,13 +667,23 @@ dict_client_dispose(
 	DictClient *self = DICT_CLIENT( object );
 
 	g_clear_object( &self->data_input );
-	g_clear_object( &self->data_output );
+	g_clear_object( &self->output );
 	g_clear_object( &self->iostream );
-	g_clear_object( &self->socket );
+	g_clear_object( &self->prefetch_engine );
+	fan_out_clear( self );
 
 	G_OBJECT_CLASS( dict_client_parent_class )->dispose( object );
 }
 
+static void
+lazy_clear(
+	DictClient *self )
+{
+	g_clear_pointer( &self->lazy_host, g_free );
+	g_clear_object( &self->lazy_address );
+	g_clear_pointer( &self->lazy_message, g_free );
+}
+
 static void
 dict_client_finalize(
 	GObject *object )
@@ -86,6 +691,15 @@ dict_client_finalize(
 	DictClient *self = DICT_CLIENT( object );
 
 	g_clear_pointer( &self->host, g_free );
+	g_clear_pointer( &self->filters, g_hash_table_unref );
+	g_clear_pointer( &self->cache, g_hash_table_unref );
+	g_queue_clear_full( &self->prefetch, (GDestroyNotify)prefetch_free );
+	g_clear_pointer( &self->trace, trace_free );
+	g_clear_pointer( &self->capture_file, g_free );
+	g_clear_pointer( &self->suggest_strategy, g_free );
+	suggest_clear( self );
+	lazy_clear( self );
+	g_string_free( self->command, TRUE );
 
 	G_OBJECT_CLASS( dict_client_parent_class )->finalize( object );
 }
@@ -107,6 +721,104 @@ dict_client_get_property(
 		case PROP_PORT:
 			g_value_set_uint( value, self->port );
 			break;
+		case PROP_RESOLVER_TTL:
+			g_value_set_uint( value, self->resolver_ttl );
+			break;
+		case PROP_CONNECT_DELAY:
+			g_value_set_uint( value, self->connect_delay );
+			break;
+		case PROP_CACHE_SIZE:
+			g_value_set_uint( value, self->cache_size );
+			break;
+		case PROP_PREFETCH_BUDGET:
+			g_value_set_uint( value, self->prefetch_budget );
+			break;
+		case PROP_PREFETCH_DEPTH:
+			g_value_set_uint( value, self->prefetch_depth );
+			break;
+		case PROP_SLOW_THRESHOLD:
+			g_value_set_uint( value, dict_client_get_slow_threshold( self ) );
+			break;
+		case PROP_CAPTURE_FILE:
+			g_value_set_string( value, self->capture_file );
+			break;
+		case PROP_TEXT_LIMIT:
+			g_value_set_uint( value, self->text_limit );
+			break;
+		case PROP_LAZY_CONNECT:
+			g_value_set_boolean( value, self->lazy_connect );
+			break;
+		case PROP_FAST_OPEN:
+			g_value_set_boolean( value, self->fast_open );
+			break;
+		case PROP_FAN_OUT:
+			g_value_set_uint( value, self->fan_out );
+			break;
+		case PROP_SUGGEST_STRATEGY:
+			g_value_set_string( value, self->suggest_strategy );
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID( object, prop_id, pspec );
+			break;
+	}
+}
+
+static void
+dict_client_set_property(
+	GObject *object,
+	guint prop_id,
+	const GValue *value,
+	GParamSpec *pspec )
+{
+	DictClient *self = DICT_CLIENT( object );
+
+	switch( (DictClientPropertyID)prop_id )
+	{
+		case PROP_RESOLVER_TTL:
+			self->resolver_ttl = g_value_get_uint( value );
+			break;
+		case PROP_CONNECT_DELAY:
+			self->connect_delay = g_value_get_uint( value );
+			break;
+		case PROP_CACHE_SIZE:
+			self->cache_size = g_value_get_uint( value );
+			cache_trim( self, self->cache_size );
+			break;
+		case PROP_PREFETCH_BUDGET:
+			self->prefetch_budget = g_value_get_uint( value );
+			break;
+		case PROP_PREFETCH_DEPTH:
+			self->prefetch_depth = g_value_get_uint( value );
+			break;
+		case PROP_SLOW_THRESHOLD:
+			if( g_value_get_uint( value ) == 0 )
+				g_clear_pointer( &self->trace, trace_free );
+			else if( self->trace == NULL )
+				self->trace = trace_new( g_value_get_uint( value ) );
+			else
+				self->trace->threshold = (gint64)g_value_get_uint( value ) * 1000;
+			break;
+		case PROP_CAPTURE_FILE:
+			g_free( self->capture_file );
+			self->capture_file = g_value_dup_string( value );
+			break;
+		case PROP_TEXT_LIMIT:
+			self->text_limit = g_value_get_uint( value );
+			break;
+		case PROP_LAZY_CONNECT:
+			self->lazy_connect = g_value_get_boolean( value );
+			break;
+		case PROP_FAST_OPEN:
+			self->fast_open = g_value_get_boolean( value );
+			break;
+		case PROP_FAN_OUT:
+			self->fan_out = g_value_get_uint( value );
+			g_clear_object( &self->fan_engine );
+			break;
+		case PROP_SUGGEST_STRATEGY:
+			g_free( self->suggest_strategy );
+			self->suggest_strategy = g_value_dup_string( value );
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID( object, prop_id, pspec );
 			break;
@@ -120,6 +832,7 @@ dict_client_class_init(
 	GObjectClass *object_class = G_OBJECT_CLASS( klass );
 
 	object_class->get_property = dict_client_get_property;
+	object_class->set_property = dict_client_set_property;
 	object_class->dispose = dict_client_dispose;
 	object_class->finalize = dict_client_finalize;
 
@@ -137,380 +850,377 @@ dict_client_class_init(
 		G_MAXUINT16,
 		2628,
 		G_PARAM_READABLE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_RESOLVER_TTL] = g_param_spec_uint(
+		"resolver-ttl",
+		"Resolver TTL",
+		"Number of seconds resolved host addresses are cached, 0 disables the cache",
+		0,
+		G_MAXUINT,
+		DEFAULT_RESOLVER_TTL,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_CONNECT_DELAY] = g_param_spec_uint(
+		"connect-delay",
+		"Connect delay",
+		"Number of milliseconds to wait for a connection before trying the next host address in parallel",
+		0,
+		G_MAXUINT,
+		DEFAULT_CONNECT_DELAY,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_CACHE_SIZE] = g_param_spec_uint(
+		"cache-size",
+		"Cache size",
+		"Number of looked up words whose definitions are kept, 0 disables the cache",
+		0,
+		G_MAXUINT,
+		DEFAULT_CACHE_SIZE,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_PREFETCH_BUDGET] = g_param_spec_uint(
+		"prefetch-budget",
+		"Prefetch budget",
+		"Number of cross-referenced words prefetched after a lookup, 0 disables prefetching",
+		0,
+		G_MAXUINT,
+		DEFAULT_PREFETCH_BUDGET,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_PREFETCH_DEPTH] = g_param_spec_uint(
+		"prefetch-depth",
+		"Prefetch depth",
+		"Number of cross-reference levels followed by prefetching",
+		1,
+		G_MAXUINT,
+		DEFAULT_PREFETCH_DEPTH,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_SLOW_THRESHOLD] = g_param_spec_uint(
+		"slow-threshold",
+		"Slow request threshold",
+		"Number of milliseconds a request may take before it is logged with its phases, 0 disables logging",
+		0,
+		G_MAXUINT,
+		DEFAULT_SLOW_THRESHOLD,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_CAPTURE_FILE] = g_param_spec_string(
+		"capture-file",
+		"Capture file",
+		"Path of a file every byte sent and received is recorded to, NULL disables recording",
+		NULL,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_TEXT_LIMIT] = g_param_spec_uint(
+		"text-limit",
+		"Text limit",
+		"Number of bytes a text of a response may take in memory, 0 disables the limit",
+		0,
+		G_MAXUINT,
+		DEFAULT_TEXT_LIMIT,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_LAZY_CONNECT] = g_param_spec_boolean(
+		"lazy-connect",
+		"Lazy connect",
+		"Whether the connection is deferred until the first command",
+		DEFAULT_LAZY_CONNECT,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_FAST_OPEN] = g_param_spec_boolean(
+		"fast-open",
+		"TCP Fast Open",
+		"Whether the client message is sent with the connection request by TCP Fast Open",
+		DEFAULT_FAST_OPEN,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_FAN_OUT] = g_param_spec_uint(
+		"fan-out",
+		"Fan-out connections",
+		"Number of extra connections a lookup in all databases is split over by database, 0 disables splitting",
+		0,
+		G_MAXUINT,
+		DEFAULT_FAN_OUT,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_SUGGEST_STRATEGY] = g_param_spec_string(
+		"suggest-strategy",
+		"Suggestion strategy",
+		"Strategy of a MATCH sent with every DEFINE for suggestions if the word is not found, NULL disables suggestions",
+		NULL,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
 	g_object_class_install_properties( object_class, N_PROPS, object_props );
 }
 
-/**
-\anchor unbracket_string
-\brief Finds a bracketed substring.
-
-Scans \c line for pair of double or single brackets (<tt>\"\"</tt> or <tt>''</tt>). Ignores leading and trailing whitespace characters ( <tt>\*space\*</tt>, <tt>\\t</tt>, <tt>\\r</tt>, <tt>\\n</tt> ), ignores back-slashed brackets (<tt>\\\"</tt>, <tt>\'</tt>). If no brackets found, returns a substring not including whitespace characters. Returns NULL, if \c line includes only whilespace characters or no bracket pair found (just one bracket).
-
-For example,
-\code
-gchar *retstr, *endstr, *s;
-s = unbracket_string( "\t one two three ", &retstr, &endstr );
-\endcode
-will set variables as
-\code
-s == "one two three "
-retstr == "one"
-endstr == " two three "
-\endcode
-and
-\code
-gchar *retstr, *endstr, *s;
-s = unbracket_string( "\t \"one \\'two\\'\" three ", &retstr, &endstr );
-\endcode
-will set variables as
-\code
-s == "one \\'two\\'\" three "
-retstr == "one \\'two\\'"
-endstr == "\" three "
-\endcode
-
-\param[in] line Input string, will not be modified.
-\param[out] retstr If not NULL, will hold a newly allocated copy of the found substring.
-\param[out] endstr If not NULL, will hold a pointer to the second bracket or a whitespace character (if there is no the first bracket).
-
-\return A pointer to the begining of the found substring inside the \c line or NULL.
+/*
+A status line longer than the buffer makes GDataInputStream grow it, one such line must not leave the connection holding the memory.
+The buffer is shrunk as soon as the bytes left in it fit the default size.
 */
-static gchar*
-unbracket_string(
-	gchar *line,
-	gchar **retstr,
-	gchar **endstr )
+static void
+buffer_shrink(
+	GDataInputStream *data_input )
 {
-	gchar *s, *end;
-
-	/* ignore whitespace characters */
-	for( s = line; strchr( " \t\r\n", (int)s[0] ) != NULL; s++ )
-		if( (int)s[0] == (int)'\0' )
-			goto failed;
+	GBufferedInputStream *buffered = G_BUFFERED_INPUT_STREAM( data_input );
+	gsize size;
 
-	/* scan for bracket pair */
-	switch( (int)s[0] )
+	size = g_buffered_input_stream_get_buffer_size( buffered );
+	if( size > DEFAULT_RECEIVE_TEXT_LEN + 1 && g_buffered_input_stream_get_available( buffered ) <= DEFAULT_RECEIVE_TEXT_LEN + 1 )
 	{
-		case (int)'"':
-		case (int)'\'':
-			end = s;
-			do
-				end = strchr( ++end, (int)s[0] );
-			while( end != NULL && end[-1] == (int)'\\' );
-			s++;
-			break;
-
-		default:
-			for( end = s; strchr( " \t\r\n\0", (int)end[0] ) == NULL; end++ );
-			break;
+		DICT_PROBE2( buffer__shrink, (size_t)size, (size_t)( DEFAULT_RECEIVE_TEXT_LEN + 1 ) );
+		g_buffered_input_stream_set_buffer_size( buffered, DEFAULT_RECEIVE_TEXT_LEN + 1 );
 	}
-	if( end == NULL )
-		goto failed;
-
-	if( endstr != NULL )
-		*endstr = end;
-
-	if( retstr != NULL )
-		*retstr = g_strndup( s, (gsize)end - (gsize)s );
-
-	return s;
-
-failed:
-	if( retstr != NULL )
-		*retstr = NULL;
-
-	if( endstr != NULL )
-		*endstr = NULL;
-
-	return NULL;
 }
 
 static glong
 receive_response(
 	GDataInputStream *data_input,
 	DictResponse *resp,
+	DictTrace *trace,
 	GError **error )
 {
-	gchar *line, *message;
+	gchar *line;
+	gsize length;
 	glong code;
 	GError *loc_error = NULL;
 
 	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE );
 
-	line = g_data_input_stream_read_line( data_input, NULL, NULL, &loc_error );
+	DICT_PROBE( status__receive__start );
+	line = g_data_input_stream_read_line( data_input, &length, NULL, &loc_error );
 	if( loc_error != NULL )
 	{
+		DICT_PROBE2( status__receive__done, (long)DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE, (size_t)0 );
+		trace_status( trace, 0, NULL, 0, loc_error );
 		g_propagate_error( error, loc_error );
 		return DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE;
 	}
 
-	code = strtol( line, &message, 10 );
-	message++;
-	if( resp != NULL && resp->code != NULL )
-		*(resp->code) = code;
-
-	switch( code )
-	{
-		/* simple response */
-		case 112:
-		case 113:
-		case 114:
-		case 130:
-		case 210:
-		case 220:
-		case 221:
-		case 230:
-		case 250:
-		case 330:
-		case 552:
-		case 554:
-		case 555:
-			if( resp != NULL && resp->message != NULL )
-				*(resp->message) = g_strdup( message );
-			break;
+	/* the stream is over */
+	if( line == NULL )
+	{
+		DICT_PROBE2( status__receive__done, (long)DICT_CLIENT_ERROR_NO_CONNECTION, (size_t)0 );
+		g_set_error(
+			&loc_error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_NO_CONNECTION,
+			"Connection closed by server" );
+		trace_status( trace, 0, NULL, 0, loc_error );
+		g_propagate_error( error, loc_error );
+		return DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE;
+	}
 
-		/* one numerical argument */
-		case 110:
-		case 111:
-		case 150:
-		case 152:
-			if( resp != NULL && resp->number != NULL )
-			{
-				*(resp->number) = strtol( message, &message, 10 );
-				message++;
-			}
-			else
-				message = strchr( message, (int)' ' ) + 1;
+	code = parse_response( line, resp, &loc_error );
+	DICT_PROBE2( status__receive__done, (long)code, (size_t)length );
+	buffer_shrink( data_input );
+	trace_status( trace, code, ( resp != NULL && resp->database != NULL ) ? *resp->database : NULL, length + 2, loc_error );
+	if( loc_error != NULL )
+		g_propagate_error( error, loc_error );
 
-			if( resp != NULL && resp->message != NULL )
-				*(resp->message) = g_strdup( message );
-			break;
-
-		/* three textual arguments */
-		case 151:
-			if( resp != NULL )
-			{
-				unbracket_string( message, resp->word, &message );
-				unbracket_string( ++message, resp->database, &message );
-				unbracket_string( ++message, resp->description, NULL );
-
-				/* this case has no additional message */
-				if( resp->message != NULL )
-					*(resp->message) = NULL;
-			}
-			break;
-
-		/* error treatment */
-		case 420:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_SERVER_TEMPORARY_UNAVAILABLE,
-				"Server temporary_unavailable" );
-			break;
-
-		case 421:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_SERVER_SHUTTING_DOWN_AT_OPERATOR_REQUEST,
-				"Server shutting down at operator request" );
-			break;
+	g_free( line );
 
-		case 500:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_SYNTAX_ERROR_COMMAND_NOT_RECOGNIZED,
-				"Syntax error command not recognized" );
-			break;
+	return code;
+}
 
-		case 501:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_SYNTAX_ERROR_ILLEGAL_PARAMETERS,
-				"Syntax error illegal parameters" );
-			break;
+/*
+Sends all commands built since the last flush with one write.
+The buffer keeps its memory, so building the next commands allocates nothing.
+*/
+static void
+flush_commands(
+	GOutputStream *output,
+	GString *command,
+	DictTrace *trace,
+	GError **error )
+{
+	GError *loc_error = NULL;
 
-		case 502:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_COMMAND_NOT_IMPLEMENTED,
-				"Command not implemented" );
-			break;
+	g_return_if_fail( G_IS_OUTPUT_STREAM( output ) );
+	g_return_if_fail( command != NULL );
 
-		case 503:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_COMMAND_PARAMETER_NOT_IMPLEMENTED,
-				"Command parameter not implemented" );
-			break;
+	DICT_PROBE2( command__send__start, command->str, (size_t)command->len );
+	trace_begin( trace, command );
+	g_output_stream_write_all( output, command->str, command->len, NULL, NULL, &loc_error );
+	DICT_PROBE2( command__send__done, (size_t)command->len, loc_error == NULL );
+	trace_sent( trace );
+	g_string_truncate( command, 0 );
+	if( loc_error != NULL )
+	{
+		trace_end( trace, 0, loc_error );
+		g_propagate_error( error, loc_error );
+	}
+}
 
-		case 530:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_ACCESS_DENIED,
-				"Access denied" );
-			break;
+/* a destination of the text over the limit, a temporary file is created on the first write if there is no stream */
+struct _DictSpill
+{
+	GOutputStream *stream;
+	GFile *file;
+	GFileIOStream *file_stream;
+	gsize length;
+};
+typedef struct _DictSpill DictSpill;
 
-		case 531:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_ACCESS_DENIED_USE_SHOW_INFO_FOR_SERVER_INFORMATION,
-				"Access denied, use \"SHOW INFO\" for server information" );
-			break;
+static gboolean
+spill_write(
+	DictSpill *spill,
+	const gchar *data,
+	gsize length,
+	GError **error )
+{
+	if( spill->stream == NULL )
+	{
+		spill->file = g_file_new_tmp( SPILL_TEMPLATE, &spill->file_stream, error );
+		if( spill->file == NULL )
+			return FALSE;
+		spill->stream = g_io_stream_get_output_stream( G_IO_STREAM( spill->file_stream ) );
+	}
 
-		case 532:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_ACCESS_DENIED_UNKNOWN_MECHANISM,
-				"Access denied, unknown mechanism" );
-			break;
+	if( !g_output_stream_write_all( spill->stream, data, length, NULL, NULL, error ) )
+		return FALSE;
+	spill->length += length;
 
-		case 550:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_INVALID_DATABASE_USE_SHOW_DB_FOR_LIST_OF_DATABASES,
-				"Invalid database use, \"SHOW DB\" for list of databases" );
-			break;
+	return TRUE;
+}
 
-		case 551:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_INVALID_STRATEGY_USE_SHOW_STRAT_FOR_A_LIST_OF_STRATEGIES,
-				"Invalid strategy, use \"SHOW STRAT\" for a list of strategies" );
-			break;
+/* maps the temporary file, it is terminated by a zero byte like a string */
+static GMappedFile*
+spill_map(
+	DictSpill *spill,
+	GError **error )
+{
+	g_return_val_if_fail( spill->file != NULL, NULL );
 
-		default:
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE,
-				"Unknown response code %ld",
-				code );
-			break;
+	if( !g_output_stream_write_all( spill->stream, "", 1, NULL, NULL, error ) ||
+		!g_io_stream_close( G_IO_STREAM( spill->file_stream ), NULL, error ) )
+	{
+		return NULL;
 	}
 
-	g_free( line );
-
-	return code;
+	return g_mapped_file_new( g_file_peek_path( spill->file ), FALSE, error );
 }
 
+/* removes the temporary file, a mapping of it stays valid */
 static void
-send_command(
-	GDataOutputStream *data_output,
-	const gchar *command,
+spill_clear(
+	DictSpill *spill )
+{
+	if( spill->file == NULL )
+		return;
+
+	g_clear_object( &spill->file_stream );
+	g_file_delete( spill->file, NULL, NULL );
+	g_clear_object( &spill->file );
+	spill->stream = NULL;
+	spill->length = 0;
+}
+
+/*
+Moves the scanned text over the limit to the spill, the last line breaker is kept for the scanner to remove it at the end of the text.
+Without a spill the text is refused.
+*/
+static gboolean
+text_spill(
+	DictTextScanner *scanner,
+	DictSpill *spill,
+	gboolean last,
 	GError **error )
 {
-	GError *loc_error = NULL;
+	gsize length;
 
-	g_return_if_fail( G_IS_DATA_OUTPUT_STREAM( data_output ) );
-	g_return_if_fail( command != NULL );
+	if( spill == NULL )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_TEXT_TOO_LONG,
+			"Text is too long" );
+		return FALSE;
+	}
 
-	g_data_output_stream_put_string( data_output, command, NULL, &loc_error );
-	if( loc_error != NULL )
-		g_propagate_error( error, loc_error );
+	length = last ? scanner->text->len : scanner->text->len - MIN( scanner->text->len, 2 );
+	if( !spill_write( spill, scanner->text->str, length, error ) )
+		return FALSE;
+	g_string_erase( scanner->text, 0, length );
+
+	return TRUE;
 }
 
+/*
+Receives a text block, at most limit bytes of it are held in memory, 0 means no limit.
+The rest goes to the spill, then NULL is returned without an error and the spill holds the whole text.
+*/
 static gchar*
 receive_text(
 	GDataInputStream *data_input,
 	gsize *length,
+	gsize limit,
+	DictSpill *spill,
+	DictTrace *trace,
 	GError **error )
 {
-	const gchar textend[] = "\r\n.\r\n";
-	gchar *text, *buf, *end;
-	gsize len, offset;
+	DictTextScanner scanner;
+	gchar *text, *buf;
+	gsize len, received = 0;
+	gboolean done;
 	GError *loc_error = NULL;
 
 	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), NULL );
 
-	len = 0;
-	offset = 0;
+	/* the text is unstuffed and validated while the end is searched, every byte is scanned once */
+	DICT_PROBE( text__receive__start );
+	text_scanner_init( &scanner );
 	while( TRUE )
 	{
 		buf = (gchar*)g_buffered_input_stream_peek_buffer( G_BUFFERED_INPUT_STREAM( data_input ), &len );
-		end = g_strstr_len( buf + offset, len - offset, textend );
+		done = text_scanner_scan( &scanner, buf, len );
 
-		if( end == NULL )
-		{
-			/* if buffer is full, increase the buffer size */
-			if( g_buffered_input_stream_get_available( G_BUFFERED_INPUT_STREAM( data_input ) ) == g_buffered_input_stream_get_buffer_size( G_BUFFERED_INPUT_STREAM( data_input ) ) )
-			{
-				g_buffered_input_stream_set_buffer_size( G_BUFFERED_INPUT_STREAM( data_input), g_buffered_input_stream_get_buffer_size( G_BUFFERED_INPUT_STREAM( data_input ) ) + DEFAULT_RECEIVE_TEXT_LEN );
+		/* a server must not make the client hold more than the limit */
+		if( limit > 0 && scanner.text->len > limit )
+			text_spill( &scanner, spill, FALSE, &loc_error );
+		if( done || loc_error != NULL )
+			break;
 
-				if( len > sizeof( textend ) - 1 )
-					offset = len - ( sizeof( textend ) - 1 );
-			}
+		/* scanned bytes are copied to the text already, so the buffer never holds more than a fill */
+		if( scanner.offset > 0 )
+		{
+			g_input_stream_skip( G_INPUT_STREAM( data_input ), scanner.offset, NULL, NULL );
+			received += scanner.offset;
+			scanner.offset = 0;
+		}
 
-			/* if there is no data in the stream, set error */
-			if( g_buffered_input_stream_fill( G_BUFFERED_INPUT_STREAM( data_input ), -1, NULL, &loc_error ) == 0 )
-			{
+		/* if there is no data in the stream, set error */
+		if( g_buffered_input_stream_fill( G_BUFFERED_INPUT_STREAM( data_input ), -1, NULL, &loc_error ) <= 0 )
+		{
+			if( loc_error == NULL )
 				g_set_error(
-					error,
+					&loc_error,
 					DICT_CLIENT_ERROR,
 					DICT_CLIENT_ERROR_CAN_NOT_RECOGNIZE_TEXT,
 					"Can not recognize text" );
-				return NULL;
-			}
-			else
-			{
-				if( loc_error != NULL )
-				{
-					g_propagate_error( error, loc_error );
-					return NULL;
-				}
-
-				continue;
-			}
-
-			/* if text breaker is not found, set error */
-			g_set_error(
-				error,
-				DICT_CLIENT_ERROR,
-				DICT_CLIENT_ERROR_CAN_NOT_RECOGNIZE_TEXT,
-				"Can not recognize text" );
-			return NULL;
+			break;
 		}
-
-		break;
 	}
 
-	/* allocate memory for output text */
-	len = (gsize)end - (gsize)buf;
-	text = g_new( gchar, len + 1 );
+	/* skip the rest of the text and the text breaker */
+	if( loc_error == NULL )
+		g_input_stream_skip( G_INPUT_STREAM( data_input ), scanner.offset, NULL, &loc_error );
+	received += scanner.offset;
+
+	/* the end of a spilled text follows the rest */
+	if( loc_error == NULL && spill != NULL && spill->length > 0 )
+		text_spill( &scanner, spill, TRUE, &loc_error );
 
-	/* copy found text */
-	g_input_stream_read( G_INPUT_STREAM( data_input ), text, len, NULL, &loc_error );
+	DICT_PROBE2( text__receive__done, (size_t)received, loc_error == NULL );
+	trace_text( trace, loc_error == NULL ? received : 0, loc_error );
 	if( loc_error != NULL )
 	{
-		g_free( text );
+		/* the rest of the response is not read, so the connection is out of step, see session_drop_broken() */
+		g_input_stream_close( G_INPUT_STREAM( data_input ), NULL, NULL );
+		text_scanner_clear( &scanner );
 		g_propagate_error( error, loc_error );
 		return NULL;
 	}
-	text[len] = '\0';
-
-	/* if necessary, return text length */
-	if( length != NULL )
-		*length = len;
 
-	/* skip text breaker */
-	g_input_stream_skip( G_INPUT_STREAM( data_input ), sizeof( textend ) - 1, NULL, &loc_error );
-	if( loc_error != NULL )
+	if( spill != NULL && spill->length > 0 )
 	{
-		g_free( text );
-		g_propagate_error( error, loc_error );
+		text_scanner_clear( &scanner );
+		if( length != NULL )
+			*length = spill->length;
 		return NULL;
 	}
-	
+
+	/* if necessary, return text length */
+	text = text_scanner_finish( &scanner, length );
+
 	return text;
 }
 
@@ -519,11 +1229,13 @@ receive_arrays(
 	GDataInputStream *data_input,
 	GStrv *data,
 	GStrv *desc,
+	gsize limit,
+	DictTrace *trace,
 	GError **error )
 {
 	DictResponse resp;
-	glong i, number;
-	gchar *text, *s;
+	glong number;
+	gchar *text;
 	GError *loc_error = NULL;
 
 	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), -1 );
@@ -532,7 +1244,7 @@ receive_arrays(
 	number = 0;
 	resp = (DictResponse){NULL,};
 	resp.number = &number;
-	receive_response( data_input, &resp, &loc_error );
+	receive_response( data_input, &resp, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
@@ -549,36 +1261,15 @@ receive_arrays(
 	}
 
 	/* receive a text holding the list */
-	text = receive_text( data_input, NULL, &loc_error );
+	text = receive_text( data_input, NULL, limit, NULL, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
 		return -1;
 	}
 
-	/* allocate arrays */
-	pstrallocv_number( data, number + 1 );
-	pstrallocv_number( desc, number + 1 );
-
 	/* fill up the arrays */
-	if( data != NULL || desc != NULL )
-	{
-		s = text - 1;
-		for( i = 0; i < number; ++i )
-		{
-			if( data != NULL )
-				unbracket_string( ++s, &((*data)[i]), &s );
-			else
-				unbracket_string( ++s, NULL, &s );
-
-			if( desc != NULL )
-				unbracket_string( ++s, &((*desc)[i]), &s );
-			else
-				unbracket_string( ++s, NULL, &s );
-		}
-		pstrnullv_index( data, number );
-		pstrnullv_index( desc, number );
-	}
+	split_pairs( text, number, data, desc );
 	g_free( text );
 
 	return number;
@@ -586,19 +1277,21 @@ receive_arrays(
 
 static gchar*
 send_receive_information(
-	GDataOutputStream *data_output,
+	GOutputStream *output,
 	GDataInputStream *data_input,
-	const gchar *command,
+	GString *command,
+	gsize limit,
+	DictTrace *trace,
 	GError **error )
 {
 	gchar *text;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( G_IS_DATA_OUTPUT_STREAM( data_output ), NULL );
+	g_return_val_if_fail( G_IS_OUTPUT_STREAM( output ), NULL );
 	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), NULL );
 	g_return_val_if_fail( command != NULL, NULL );
 
-	send_command( data_output, command, &loc_error );
+	flush_commands( output, command, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
@@ -606,7 +1299,7 @@ send_receive_information(
 	}
 
 	/* receive confirmation */
-	receive_response( data_input, NULL, &loc_error );
+	receive_response( data_input, NULL, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
@@ -614,7 +1307,7 @@ send_receive_information(
 	}
 
 	/* receive information text */
-	text = receive_text( data_input, NULL, &loc_error );
+	text = receive_text( data_input, NULL, limit, NULL, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
@@ -622,7 +1315,7 @@ send_receive_information(
 	}
 
 	/* receive OK status */
-	receive_response( data_input, NULL, &loc_error );
+	receive_response( data_input, NULL, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_free( text );
@@ -633,30 +1326,20 @@ send_receive_information(
 	return text;
 }
 
+/* receives the arrays and the OK status after them */
 static glong
-send_receive_arrays(
-	GDataOutputStream *data_output,
+receive_listing(
 	GDataInputStream *data_input,
-	const gchar *command,
 	GStrv *data,
 	GStrv *desc,
+	gsize limit,
+	DictTrace *trace,
 	GError **error )
 {
 	glong number;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( G_IS_DATA_OUTPUT_STREAM( data_output ), -1 );
-	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), -1 );
-	g_return_val_if_fail( command != NULL, -1 );
-
-	send_command( data_output, command, &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return -1;
-	}
-
-	number = receive_arrays( data_input, data, desc, &loc_error );
+	number = receive_arrays( data_input, data, desc, limit, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		g_propagate_error( error, loc_error );
@@ -670,7 +1353,7 @@ send_receive_arrays(
 	}
 
 	/* receive OK status */
-	receive_response( data_input, NULL, &loc_error );
+	receive_response( data_input, NULL, trace, &loc_error );
 	if( loc_error != NULL )
 	{
 		pstrfreev( data );
@@ -682,710 +1365,3141 @@ send_receive_arrays(
 	return number;
 }
 
-/**
-\anchor dict_client_new
-\brief Creates a new DictClient instance.
+static glong
+send_receive_arrays(
+	GOutputStream *output,
+	GDataInputStream *data_input,
+	GString *command,
+	GStrv *data,
+	GStrv *desc,
+	gsize limit,
+	DictTrace *trace,
+	GError **error )
+{
+	GError *loc_error = NULL;
 
-Use <tt>g_object_unref()</tt> to decrease the reference count of the new instance to 0 and destroys the instance. There is no need to call \ref dict_client_disconnect "dict_client_disconnect()" before.
+	g_return_val_if_fail( G_IS_OUTPUT_STREAM( output ), -1 );
+	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), -1 );
+	g_return_val_if_fail( command != NULL, -1 );
 
-\return New DictClient instance.
-*/
-DictClient*
-dict_client_new(
-	void )
+	flush_commands( output, command, trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return receive_listing( data_input, data, desc, limit, trace, error );
+}
+
+static DictCacheEntry*
+cache_lookup(
+	DictClient *self,
+	const gchar *key )
 {
-	return DICT_CLIENT( g_object_new( G_TYPE_DICT_CLIENT, NULL ) );
+	DictCacheEntry *entry;
+
+	entry = g_hash_table_lookup( self->cache, key );
+	if( entry != NULL )
+	{
+		g_queue_unlink( &self->cache_order, &entry->link );
+		g_queue_push_tail_link( &self->cache_order, &entry->link );
+	}
+
+	return entry;
 }
 
-/**
-\anchor dict_client_is_connected
-\brief Check whether there was a connection to the server.
+/* takes the key and the arrays, returns NULL and leaves the arrays to the caller if the cache is disabled */
+static DictCacheEntry*
+cache_insert(
+	DictClient *self,
+	gchar *key,
+	glong number,
+	GStrv words,
+	GStrv databases,
+	GStrv descriptions,
+	GStrv definitions )
+{
+	DictCacheEntry *entry, *old;
 
-This function always returns \c TRUE after successfull call of "dict_client_connect()", and \c FALSE otherwise or after call "dict_client_disconnect()".
+	if( self->cache_size == 0 )
+	{
+		g_free( key );
+		return NULL;
+	}
 
-\param[in] self A DictClient instance.
+	entry = g_new( DictCacheEntry, 1 );
+	entry->key = key;
+	entry->number = number;
+	entry->words = words;
+	entry->databases = databases;
+	entry->descriptions = descriptions;
+	entry->definitions = definitions;
+	entry->link = (GList){ entry, NULL, NULL };
+
+	/* the entry being replaced must leave the order first */
+	old = g_hash_table_lookup( self->cache, key );
+	if( old != NULL )
+	{
+		g_queue_unlink( &self->cache_order, &old->link );
+		g_hash_table_remove( self->cache, key );
+	}
 
-\return \c TRUE if there was the successfull connection or \c FALSE otherwise.
-*/
-gboolean
-dict_client_is_connected(
+	g_hash_table_insert( self->cache, entry->key, entry );
+	g_queue_push_tail_link( &self->cache_order, &entry->link );
+	cache_trim( self, self->cache_size );
+
+	return entry;
+}
+
+static void
+cache_clear(
 	DictClient *self )
 {
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
-	
-	return self->host != NULL;
+	g_queue_init( &self->cache_order );
+	g_hash_table_remove_all( self->cache );
 }
 
-/**
-\anchor dict_client_connect
-\brief Connects to the server.
+/* takes ownership of one received definition, unless it is mapped, then the definition points into the mapped file */
+typedef void (*DefinitionSink)( gchar *word, gchar *database, gchar *description, gchar *definition, gsize length, GMappedFile *mapped, gpointer user_data );
 
-Use \ref dict_client_disconnect "dict_client_disconnect()" to disconnect the client from the server or decrease the reference count of the instance to 0 by <tt>g_object_unref()</tt>, that will destroy the instance.
+struct _DefinitionArrays
+{
+	GPtrArray *words;
+	GPtrArray *databases;
+	GPtrArray *descriptions;
+	GPtrArray *definitions;
+};
+typedef struct _DefinitionArrays DefinitionArrays;
 
-\param[in] self A DictClient instance.
-\param[in] host Address of the server (IPv4, IPv6 or resolveable name).
-\param[in] port A port number to connect.
-\param[in] client_message If not NULL, this message will be sent to the server as a greeting.
-\param[out] server_response If not NULL, holds a greeting message from the server.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+struct _DefinitionForeach
+{
+	DictClient *self;
+	DictClientDefinitionFunc func;
+	gpointer user_data;
+	DefinitionArrays *arrays;
+};
+typedef struct _DefinitionForeach DefinitionForeach;
 
-\return \c TRUE on success or \c FALSE on error.
-*/
-gboolean
-dict_client_connect(
-	DictClient *self,
-	const gchar *host,
-	const guint16 port,
-	const gchar *client_message,
-	gchar **server_response,
+/* receives the response to DEFINE, each definition is passed to the sink as soon as its text is read, definitions over the limit are mapped if spill is TRUE */
+static glong
+receive_definitions_with(
+	GDataInputStream *data_input,
+	gsize limit,
+	gboolean spill,
+	DefinitionSink sink,
+	gpointer user_data,
+	DictTrace *trace,
 	GError **error )
 {
 	DictResponse resp;
-	gchar *command, *message;
+	DictSpill spill_file = {NULL,};
+	GMappedFile *mapped;
+	gchar *word, *database, *description, *text;
+	gsize length;
+	glong i, number;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
-	g_return_val_if_fail( host != NULL, FALSE );
-
-	/* check if there is a connection */
-	if( dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS,
-			"A connection already exists" );
-		return FALSE;
-	}
+	g_return_val_if_fail( G_IS_DATA_INPUT_STREAM( data_input ), -1 );
 
-	/* connect to server */
-	self->socket = g_socket_client_new();
-	self->iostream = G_IO_STREAM( g_socket_client_connect_to_host( self->socket, host, port, NULL, &loc_error ) );
+	/* receive number of definitions */
+	number = 0;
+	resp = (DictResponse){NULL,};
+	resp.number = &number;
+	receive_response( data_input, &resp, trace, &loc_error );
 	if( loc_error != NULL )
 	{
-		g_clear_object( &( self->socket ) );
 		g_propagate_error( error, loc_error );
-		return FALSE;
+		return -1;
 	}
 
-	/* make streams */
-	self->data_input = g_data_input_stream_new( g_io_stream_get_input_stream( self->iostream ) );
-	self->data_output = g_data_output_stream_new( g_io_stream_get_output_stream( self->iostream ) );
-
-	/* \r\n is used for newline */
-	g_data_input_stream_set_newline_type( self->data_input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF );
-	/* maximum length of a received text is known from the protocol reference */
-	g_buffered_input_stream_set_buffer_size( G_BUFFERED_INPUT_STREAM( self->data_input ), DEFAULT_RECEIVE_TEXT_LEN + 1 );
-
-	/* receive response after successful connection */
-	resp = (DictResponse){NULL,};
-	resp.message = &message;
-	receive_response( self->data_input, &resp, &loc_error );
-	if( loc_error!= NULL )
-	{
-		g_propagate_error( error, loc_error );
-		goto failed;
-	}
+	/* number will not change if there is no data */
+	if( number == 0 )
+		return 0;
 
-	/* introduce client to server */
-	if( client_message != NULL )
+	/* receive word, database, description and definitions */
+	for( i = 0; i < number; ++i )
 	{
-		command = g_strdup_printf( "CLIENT \"%s\"\r\n", client_message );
-		send_command( self->data_output, command, &loc_error );
-		g_free( command );
-		if( loc_error!= NULL )
+		word = database = description = NULL;
+		resp = (DictResponse){NULL,};
+		resp.word = &word;
+		resp.database = &database;
+		resp.description = &description;
+
+		text = NULL;
+		mapped = NULL;
+		receive_response( data_input, &resp, trace, &loc_error );
+		if( loc_error == NULL )
+			text = receive_text( data_input, &length, limit, spill ? &spill_file : NULL, trace, &loc_error );
+		if( loc_error == NULL && text == NULL )
 		{
+			mapped = spill_map( &spill_file, &loc_error );
+			spill_clear( &spill_file );
+		}
+		if( loc_error != NULL )
+		{
+			spill_clear( &spill_file );
+			g_free( word );
+			g_free( database );
+			g_free( description );
 			g_propagate_error( error, loc_error );
-			goto failed;
+			return -1;
 		}
 
-		/* receive response after introducing */
-		receive_response( self->data_input, NULL, &loc_error );
-		if( loc_error!= NULL )
+		if( mapped != NULL )
 		{
-			g_propagate_error( error, loc_error );
-			goto failed;
+			sink( word, database, description, g_mapped_file_get_contents( mapped ), length, mapped, user_data );
+			g_mapped_file_unref( mapped );
 		}
+		else
+			sink( word, database, description, text, length, NULL, user_data );
 	}
 
-	/* if needed, receive server response text */
-	if( server_response != NULL )
-		*server_response = message;
-	else
-		g_free( message );
+	/* receive OK status */
+	receive_response( data_input, NULL, trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
 
-	/* save successfuly connected host and port */
-	self->host = g_strdup( host );
-	self->port = port;
+	return number;
+}
 
-	return TRUE;
+static void
+definition_arrays_init(
+	DefinitionArrays *arrays )
+{
+	arrays->words = g_ptr_array_new_with_free_func( g_free );
+	arrays->databases = g_ptr_array_new_with_free_func( g_free );
+	arrays->descriptions = g_ptr_array_new_with_free_func( g_free );
+	arrays->definitions = g_ptr_array_new_with_free_func( g_free );
+}
 
-failed:
-	g_clear_object( &self->data_input );
-	g_clear_object( &self->data_output );
-	g_clear_object( &self->iostream );
-	g_clear_object( &self->socket );
-	g_free( message );
+static void
+definition_arrays_add(
+	gchar *word,
+	gchar *database,
+	gchar *description,
+	gchar *definition,
+	gsize length,
+	GMappedFile *mapped,
+	gpointer user_data )
+{
+	DefinitionArrays *arrays = user_data;
 
-	return FALSE;
+	g_ptr_array_add( arrays->words, word );
+	g_ptr_array_add( arrays->databases, database );
+	g_ptr_array_add( arrays->descriptions, description );
+	g_ptr_array_add( arrays->definitions, definition );
 }
 
-/**
-\anchor dict_client_disconnect
-\brief Breaks a connection to the server.
+/* hands the arrays over as NULL-terminated, an array is freed if its pointer is NULL, empty arrays become NULL */
+static void
+definition_arrays_steal(
+	DefinitionArrays *arrays,
+	GStrv *words,
+	GStrv *databases,
+	GStrv *descriptions,
+	GStrv *definitions )
+{
+	GPtrArray **array[4] = { &arrays->words, &arrays->databases, &arrays->descriptions, &arrays->definitions };
+	GStrv *ret[4] = { words, databases, descriptions, definitions };
+	guint i;
 
-Any operation with disconnected DictClient will lead to error.
+	for( i = 0; i < 4; ++i )
+	{
+		if( ret[i] != NULL && (*array[i])->len > 0 )
+		{
+			g_ptr_array_add( *array[i], NULL );
+			*ret[i] = (GStrv)g_ptr_array_free( *array[i], FALSE );
+		}
+		else
+		{
+			pstrnullv( ret[i] );
+			g_ptr_array_unref( *array[i] );
+		}
+		*array[i] = NULL;
+	}
+}
 
-\param[in] self A DictClient instance.
-\param[out] server_response If not NULL, holds a farewell message from the server.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+static void
+definition_arrays_clear(
+	DefinitionArrays *arrays )
+{
+	definition_arrays_steal( arrays, NULL, NULL, NULL, NULL );
+}
 
-\return \c TRUE on success or \c FALSE on error.
-*/
-gboolean
-dict_client_disconnect(
-	DictClient *self,
-	gchar **server_response,
+/* receives the response to DEFINE, any array may be NULL */
+static glong
+receive_definitions(
+	GDataInputStream *data_input,
+	GStrv *words,
+	GStrv *databases,
+	GStrv *descriptions,
+	GStrv *definitions,
+	gsize limit,
+	DictTrace *trace,
 	GError **error )
 {
-	DictResponse resp;
-	gboolean ret = TRUE;
+	DefinitionArrays arrays;
+	glong number;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
-
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return FALSE;
-	}
-
-	/* send goodbye command to server */
-	send_command( self->data_output, "QUIT\r\n", &loc_error );
+	definition_arrays_init( &arrays );
+	number = receive_definitions_with( data_input, limit, FALSE, definition_arrays_add, &arrays, trace, &loc_error );
 	if( loc_error != NULL )
 	{
+		definition_arrays_clear( &arrays );
 		g_propagate_error( error, loc_error );
-		ret = FALSE;
-		goto out;
+		return -1;
 	}
 
-	/* receive farewell response */
-	resp = (DictResponse){NULL,};
-	resp.message = server_response;
-	receive_response( self->data_input, &resp, &loc_error );
-	if( loc_error != NULL )
+	definition_arrays_steal( &arrays, words, databases, descriptions, definitions );
+
+	return number;
+}
+
+/* passes a received definition to the caller and keeps it for the cache, if there is one */
+static void
+definition_foreach_add(
+	gchar *word,
+	gchar *database,
+	gchar *description,
+	gchar *definition,
+	gsize length,
+	GMappedFile *mapped,
+	gpointer user_data )
+{
+	DefinitionForeach *foreach = user_data;
+
+	foreach->func( foreach->self, word, database, description, definition, length, foreach->user_data );
+
+	/* a mapped definition is too long for the cache, the whole response is not cached then */
+	if( mapped != NULL && foreach->arrays != NULL )
 	{
-		g_propagate_error( error, loc_error );
-		ret = FALSE;
+		definition_arrays_clear( foreach->arrays );
+		foreach->arrays = NULL;
 	}
 
-out:
-	g_clear_object( &self->data_input );
-	g_clear_object( &self->data_output );
-	g_clear_object( &self->iostream );
-	g_clear_object( &self->socket );
-	g_clear_pointer( &self->host, g_free );
+	if( foreach->arrays != NULL )
+	{
+		definition_arrays_add( word, database, description, definition, length, NULL, foreach->arrays );
+		return;
+	}
 
-	return ret;
+	g_free( word );
+	g_free( database );
+	g_free( description );
+	if( mapped == NULL )
+		g_free( definition );
 }
 
-/**
-anchor dict_client_define
-\brief Looks up the \c word in the \c database of the server.
-
-If \c database is <tt>!</tt> , then all databases of the server will be scanned until the first match. If \c database is <tt>*</tt> , then all databases of the server will be scaned for all matches. The \c database is searched in the same order as that got by \ref dict_client_show_databases "dict_client_show_databases()". Sizes of \c words, \c databases, \c descriptions and \c definitions are the same.
-
-\param[in] self A \c DictClient instance.
-\param[in] database A database to search in, must not be NULL.
-\param[in] word A word to search, must not be NULL.
-\param[out] words If not NULL, holds an array of words found in the \c databases.
-\param[out] databases If not NULL, holds an array of the databases holding the \c words.
-\param[out] descriptions If not NULL, holds an array of the descriptions about the \c databases.
-\param[out] definitions If not NULL, holds an array of the definitions of the \c words.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+/* queues a MATCH for suggestions behind the DEFINE of the word, it is sent with the DEFINE */
+static void
+suggest_queue(
+	DictClient *self,
+	const gchar *database,
+	const gchar *word )
+{
+	if( self->suggest_strategy == NULL )
+		return;
+
+	command_begin( self->command, "MATCH" );
+	command_append_string( self->command, database );
+	command_append_string( self->command, self->suggest_strategy );
+	command_append_string( self->command, word );
+	command_end( self->command );
+	self->suggest_pending = TRUE;
+}
 
-\return A number of the found definitions or -1 on error.
+/*
+Reads the response to the MATCH queued by suggest_queue(), NULL arrays discard it.
+A refused MATCH gives no suggestions, -1 is returned only if the connection is broken.
 */
-glong
-dict_client_define(
+static glong
+suggest_receive(
 	DictClient *self,
-	const gchar *database,
-	const gchar *word,
-	GStrv *words,
 	GStrv *databases,
-	GStrv *descriptions,
-	GStrv *definitions,
+	GStrv *words,
 	GError **error )
 {
-	DictResponse resp;
-	gchar *command, *text;
-	glong i, number;
+	glong number;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
-	g_return_val_if_fail( database != NULL, -1 );
-	g_return_val_if_fail( word != NULL , -1 );
-
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return -1;
-	}
+	if( !self->suggest_pending )
+		return 0;
+	self->suggest_pending = FALSE;
 
-	command = g_strdup_printf( "DEFINE \"%s\" \"%s\"\r\n", database, word );
-	send_command( self->data_output, command, &loc_error );
-	g_free( command );
+	number = receive_listing( self->data_input, databases, words, self->text_limit, NULL, &loc_error );
 	if( loc_error != NULL )
 	{
-		g_propagate_error( error, loc_error );
-		return -1;
-	}
+		if( loc_error->domain == DICT_CLIENT_ERROR && loc_error->code < DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS )
+		{
+			g_error_free( loc_error );
+			pstrnullv( databases );
+			pstrnullv( words );
+			return 0;
+		}
 
-	/* receive number of definitions */
-	number = 0;
-	resp = (DictResponse){NULL,};
-	resp.number = &number;
-	receive_response( self->data_input, &resp, &loc_error );
-	if( loc_error != NULL )
-	{
 		g_propagate_error( error, loc_error );
 		return -1;
 	}
 
-	/* number will not change if there is no data */
-	/* return empty arrays */
-	if( number == 0 )
-	{
-		pstrnullv( words );
-		pstrnullv( databases );
-		pstrnullv( descriptions );
-		pstrnullv( definitions );
+	return number;
+}
 
-		return 0;
-	}
+static gboolean
+prefetch_contains(
+	DictClient *self,
+	const gchar *key )
+{
+	GList *l;
 
-	/* allocate arrays */
-	pstrallocv_number( words, number + 1 );
-	pstrallocv_number( databases, number + 1 );
-	pstrallocv_number( descriptions, number + 1 );
-	pstrallocv_number( definitions, number + 1 );
+	for( l = self->prefetch.head; l != NULL; l = l->next )
+		if( g_strcmp0( ( (DictPrefetch*)l->data )->key, key ) == 0 )
+			return TRUE;
 
-	/* initialize to NULL */
-	for( i = 0; i < number + 1; ++i )
-	{
-		pstrnullv_index( words, i );
-		pstrnullv_index( databases, i );
-		pstrnullv_index( descriptions, i );
-		pstrnullv_index( definitions, i );
-	}
+	return FALSE;
+}
 
-	/* receive word, database, description and definitions */
-	for( i = 0; i < number; ++i )
-	{
-		resp = (DictResponse){NULL,};
-		if( words != NULL )
-			resp.word = &((*words)[i]);
-		if( databases != NULL )
-			resp.database = &((*databases)[i]);
-		if( descriptions != NULL )
-			resp.description = &((*descriptions)[i]);
-
-		receive_response( self->data_input, &resp, &loc_error );
-		if( loc_error != NULL )
-		{
-			pstrfreev( words );
-			pstrfreev( databases );
-			pstrfreev( descriptions );
-			pstrfreev( definitions );
-			g_propagate_error( error, loc_error );
-			return -1;
-		}
+static void prefetch_references( DictClient *self, const gchar *database, GStrv definitions, guint depth );
 
-		text = receive_text( self->data_input, NULL, &loc_error );
-		if( loc_error != NULL )
-		{
-			pstrfreev( words );
-			pstrfreev( databases );
-			pstrfreev( descriptions );
-			pstrfreev( definitions );
-			g_propagate_error( error, loc_error );
-			return -1;
-		}
-		if( definitions != NULL )
-			(*definitions)[i] = text;
-		else
-			g_free( text );
-	}
+/* puts a prefetched definition into the cache and follows its references */
+static void
+prefetch_received(
+	DictEngine *engine,
+	glong number,
+	GStrv words,
+	GStrv databases,
+	GStrv descriptions,
+	GStrv definitions,
+	const GError *error,
+	gpointer user_data )
+{
+	DictPrefetch *prefetch = user_data;
+	DictClient *self = prefetch->self;
+	DictCacheEntry *entry = NULL;
 
-	/* receive OK status */
-	receive_response( self->data_input, NULL, &loc_error );
-	if( loc_error != NULL )
+	g_queue_remove( &self->prefetch, prefetch );
+
+	/* a refused word is simply not kept */
+	if( error == NULL )
+		entry = cache_insert( self, g_steal_pointer( &prefetch->key ), number, words, databases, descriptions, definitions );
+	if( entry != NULL )
+		prefetch_references( self, prefetch->database, entry->definitions, prefetch->depth + 1 );
+	else
 	{
-		pstrfreev( words );
-		pstrfreev( databases );
-		pstrfreev( descriptions );
-		pstrfreev( definitions );
-		g_propagate_error( error, loc_error );
-		return -1;
+		g_strfreev( words );
+		g_strfreev( databases );
+		g_strfreev( descriptions );
+		g_strfreev( definitions );
 	}
-
-	return number;
+	prefetch_free( prefetch );
 }
 
-/**
-\anchor dict_client_match
-\brief Trys to match the word in the database with the selected strategy.
-
-This function scans an index of the \c database and returns the \c words array holding words those were found using the \c strategy. Not all databases support all strategies, but all databases must support \c prefix and \c exact. Sizes of returned \c databases and \c words are the same. Use items of \c databases and \c words as pairs.
-
-\param[in] self A \c DictClient instance.
-\param[in] database A database to search in, must not be NULL.
-\param[in] strategy A strategy to search with, must not be NULL.
-\param[in] word A word to search, must not be NULL.
-\param[out] databases If not NULL, holds an array of the databases holding the \c words. May be NUll, if no \c word in \c database with \c strategy.
-\param[out] words If not NULL, holds an array of words found in the \c databases. May be NUll, if no \c word in \c database with \c strategy.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
-
-\return A number of the found database-word pairs or -1 on error.
+/*
+Queues DEFINE commands for words cross-referenced by the definitions, while the budget lasts.
+They go through a connection of their own at the low priority, prefetch_poll() sends them and puts the responses which have come into the cache.
 */
-glong
-dict_client_match(
+static void
+prefetch_references(
 	DictClient *self,
 	const gchar *database,
-	const gchar *strategy,
-	const gchar *word,
-	GStrv *databases,
-	GStrv *words,
-	GError **error )
+	GStrv definitions,
+	guint depth )
 {
-	gchar *command;
-	glong number;
+	DictDefinition *definition;
+	DictPrefetch *prefetch;
+	DictFilter *filter;
+	GStrv references;
+	gchar *key;
+	guint i, j;
 	GError *loc_error = NULL;
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
-	g_return_val_if_fail( database != NULL, -1 );
-	g_return_val_if_fail( strategy != NULL, -1 );
-	g_return_val_if_fail( word != NULL , -1 );
+	/* the engine connects by host and port, other transports are not prefetched */
+	if( definitions == NULL || depth > self->prefetch_depth || self->cache_size == 0 || self->port == 0 )
+		return;
 
-	if( !dict_client_is_connected( self ) )
+	filter = g_hash_table_lookup( self->filters, database );
+	for( i = 0; definitions[i] != NULL && self->prefetch_remaining > 0; ++i )
 	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return -1;
-	}
+		definition = dict_definition_new_borrow( definitions[i], -1, NULL, NULL );
+		references = dict_definition_dup_references( definition );
+		g_object_unref( G_OBJECT( definition ) );
+		if( references == NULL )
+			continue;
 
-	command = g_strdup_printf( "MATCH \"%s\" \"%s\" \"%s\"\r\n", database, strategy,  word );
-	number = send_receive_arrays( self->data_output, self->data_input, command, databases, words, &loc_error );
-	g_free( command );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return -1;
-	}
+		for( j = 0; references[j] != NULL && self->prefetch_remaining > 0; ++j )
+		{
+			if( filter != NULL && !filter_contains( filter, references[j] ) )
+				continue;
+
+			key = cache_key( database, references[j] );
+			if( g_hash_table_contains( self->cache, key ) || prefetch_contains( self, key ) )
+			{
+				g_free( key );
+				continue;
+			}
+
+			if( self->prefetch_engine == NULL )
+			{
+				self->prefetch_engine = dict_engine_new();
+				dict_engine_set_probe_interval( self->prefetch_engine, 0 );
+				if( !dict_engine_add_server( self->prefetch_engine, self->host, self->port, 1, &loc_error ) )
+				{
+					g_clear_error( &loc_error );
+					g_clear_object( &self->prefetch_engine );
+					g_free( key );
+					g_strfreev( references );
+					return;
+				}
+			}
+
+			prefetch = g_new( DictPrefetch, 1 );
+			prefetch->self = self;
+			prefetch->database = g_strdup( database );
+			prefetch->key = key;
+			prefetch->depth = depth;
+			g_queue_push_tail( &self->prefetch, prefetch );
+			dict_engine_define_full( self->prefetch_engine, database, references[j], DICT_ENGINE_PRIORITY_LOW, prefetch_received, prefetch );
+			--self->prefetch_remaining;
+		}
+		g_strfreev( references );
+	}
+}
+
+/* sends queued prefetches and takes the responses which have come without waiting for the others */
+static void
+prefetch_poll(
+	DictClient *self )
+{
+	if( self->prefetch_engine != NULL )
+		dict_engine_iterate( self->prefetch_engine, 0 );
+}
+
+static void
+prefetch_clear(
+	DictClient *self )
+{
+	/* the engine drops its requests without calling back */
+	g_clear_object( &self->prefetch_engine );
+	g_queue_clear_full( &self->prefetch, (GDestroyNotify)prefetch_free );
+}
+
+/* skips the response to suggestions for a found word, so the connection is ready for the next command */
+static gboolean
+suggest_drain(
+	DictClient *self,
+	GError **error )
+{
+	return suggest_receive( self, NULL, NULL, error ) >= 0;
+}
+
+static void
+fan_out_received(
+	DictEngine *engine,
+	glong number,
+	GStrv words,
+	GStrv databases,
+	GStrv descriptions,
+	GStrv definitions,
+	const GError *error,
+	gpointer user_data )
+{
+	DictFanResult *result = user_data;
+
+	result->failed = error != NULL;
+	result->number = MAX( number, 0 );
+	result->words = words;
+	result->databases = databases;
+	result->descriptions = descriptions;
+	result->definitions = definitions;
+	( *result->remaining )--;
+}
+
+/*
+Looks the word up in every database at once, one DEFINE per database over the connections of the fan-out engine.
+Definitions are merged in the order of SHOW DB, the order the server searches "*" in, so the result is the same as of one DEFINE.
+Returns -1 if the lookup can not be split or a part of it failed, then "*" is to be asked as usual.
+*/
+static glong
+fan_out_define(
+	DictClient *self,
+	const gchar *word,
+	GStrv *words,
+	GStrv *databases,
+	GStrv *descriptions,
+	GStrv *definitions )
+{
+	DefinitionArrays arrays;
+	DictFanResult *results;
+	guint i, n, remaining;
+	glong j, number = 0;
+	gboolean failed;
+	GError *loc_error = NULL;
+
+	/* the engine connects by host and port, other transports are not split */
+	if( self->port == 0 )
+		return -1;
+
+	if( self->fan_databases == NULL )
+	{
+		command_begin( self->command, "SHOW DB" );
+		command_end( self->command );
+		if( send_receive_arrays( self->output, self->data_input, self->command, &self->fan_databases, NULL, self->text_limit, self->trace, &loc_error ) <= 0 )
+		{
+			g_clear_error( &loc_error );
+			return -1;
+		}
+	}
+
+	if( self->fan_engine == NULL )
+	{
+		self->fan_engine = dict_engine_new();
+		dict_engine_set_probe_interval( self->fan_engine, 0 );
+		if( !dict_engine_add_server( self->fan_engine, self->host, self->port, self->fan_out, &loc_error ) )
+		{
+			g_clear_error( &loc_error );
+			fan_out_clear( self );
+			return -1;
+		}
+	}
+
+	n = g_strv_length( self->fan_databases );
+	results = g_new0( DictFanResult, n );
+	remaining = n;
+	for( i = 0; i < n; ++i )
+	{
+		results[i].remaining = &remaining;
+		dict_engine_define( self->fan_engine, self->fan_databases[i], word, fan_out_received, &results[i] );
+	}
+
+	/* the engine fails requests of dead connections, so every callback comes */
+	while( remaining > 0 && dict_engine_iterate( self->fan_engine, -1 ) );
+
+	/* a connection may have been closed by the server or a database may have gone, both are made again next time */
+	failed = remaining > 0;
+	for( i = 0; i < n; ++i )
+		failed = failed || results[i].failed;
+	if( failed )
+		fan_out_clear( self );
+
+	/* the strings are moved to the arrays, only the vectors are freed */
+	definition_arrays_init( &arrays );
+	for( i = 0; i < n; ++i )
+	{
+		if( failed )
+		{
+			g_strfreev( results[i].words );
+			g_strfreev( results[i].databases );
+			g_strfreev( results[i].descriptions );
+			g_strfreev( results[i].definitions );
+			continue;
+		}
+
+		for( j = 0; j < results[i].number; ++j )
+			definition_arrays_add( results[i].words[j], results[i].databases[j], results[i].descriptions[j], results[i].definitions[j], 0, NULL, &arrays );
+		number += results[i].number;
+		g_free( results[i].words );
+		g_free( results[i].databases );
+		g_free( results[i].descriptions );
+		g_free( results[i].definitions );
+	}
+	g_free( results );
+
+	if( failed )
+	{
+		definition_arrays_clear( &arrays );
+		return -1;
+	}
+
+	definition_arrays_steal( &arrays, words, databases, descriptions, definitions );
+
+	return number;
+}
+
+static void
+resolver_entry_free(
+	DictResolverEntry *entry )
+{
+	g_resolver_free_addresses( entry->addresses );
+	g_free( entry );
+}
+
+static GList*
+resolve_host(
+	const gchar *host,
+	guint ttl,
+	GError **error )
+{
+	DictResolverEntry *entry;
+	GInetAddress *address;
+	GList *addresses;
+	gint64 now;
+	GError *loc_error = NULL;
+
+	/* IP literals need no resolving */
+	address = g_inet_address_new_from_string( host );
+	if( address != NULL )
+		return g_list_append( NULL, address );
+
+	now = g_get_monotonic_time();
+	if( ttl > 0 )
+	{
+		G_LOCK( resolver_cache );
+		entry = resolver_cache != NULL ? g_hash_table_lookup( resolver_cache, host ) : NULL;
+		if( entry != NULL && now - entry->resolved < (gint64)ttl * G_USEC_PER_SEC )
+		{
+			addresses = g_list_copy_deep( entry->addresses, (GCopyFunc)g_object_ref, NULL );
+			G_UNLOCK( resolver_cache );
+			return addresses;
+		}
+		G_UNLOCK( resolver_cache );
+	}
+
+	/* the default resolver may be replaced by the user, e.g. for testing */
+	addresses = g_resolver_lookup_by_name( g_resolver_get_default(), host, NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	if( ttl > 0 )
+	{
+		entry = g_new( DictResolverEntry, 1 );
+		entry->addresses = g_list_copy_deep( addresses, (GCopyFunc)g_object_ref, NULL );
+		entry->resolved = now;
+
+		G_LOCK( resolver_cache );
+		if( resolver_cache == NULL )
+			resolver_cache = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, (GDestroyNotify)resolver_entry_free );
+		g_hash_table_replace( resolver_cache, g_strdup( host ), entry );
+		G_UNLOCK( resolver_cache );
+	}
+
+	return addresses;
+}
+
+static void
+forget_host(
+	const gchar *host )
+{
+	G_LOCK( resolver_cache );
+	if( resolver_cache != NULL )
+		g_hash_table_remove( resolver_cache, host );
+	G_UNLOCK( resolver_cache );
+}
+
+/* alternate address families starting with the preferred one, RFC 8305 */
+static GList*
+interleave_addresses(
+	GList *addresses )
+{
+	GQueue first = G_QUEUE_INIT, second = G_QUEUE_INIT;
+	GSocketFamily family;
+	GList *l, *ordered = NULL;
+
+	if( addresses == NULL )
+		return NULL;
+
+	family = g_inet_address_get_family( G_INET_ADDRESS( addresses->data ) );
+	for( l = addresses; l != NULL; l = l->next )
+	{
+		if( g_inet_address_get_family( G_INET_ADDRESS( l->data ) ) == family )
+			g_queue_push_tail( &first, l->data );
+		else
+			g_queue_push_tail( &second, l->data );
+	}
+
+	while( !g_queue_is_empty( &first ) || !g_queue_is_empty( &second ) )
+	{
+		if( !g_queue_is_empty( &first ) )
+			ordered = g_list_prepend( ordered, g_queue_pop_head( &first ) );
+		if( !g_queue_is_empty( &second ) )
+			ordered = g_list_prepend( ordered, g_queue_pop_head( &second ) );
+	}
+
+	return g_list_reverse( ordered );
+}
+
+static void
+connect_attempt_free(
+	DictConnectAttempt *attempt )
+{
+	g_source_destroy( attempt->source );
+	g_source_unref( attempt->source );
+	g_object_unref( attempt->socket );
+	g_free( attempt );
+}
+
+static gboolean
+connect_attempt_ready(
+	GSocket *socket,
+	GIOCondition condition,
+	gpointer user_data )
+{
+	DictConnectAttempt *attempt = user_data;
+	DictConnectRace *race = attempt->race;
+	GError *loc_error = NULL;
+
+	if( g_socket_check_connect_result( socket, &loc_error ) )
+	{
+		if( race->winner == NULL )
+			race->winner = g_object_ref( socket );
+	}
+	else
+	{
+		g_clear_error( &race->error );
+		race->error = loc_error;
+	}
+
+	g_ptr_array_remove( race->attempts, attempt );
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+connect_delay_expired(
+	gpointer user_data )
+{
+	DictConnectRace *race = user_data;
+
+	race->delay_expired = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+connect_attempt_start(
+	DictConnectRace *race,
+	GInetAddress *address,
+	guint16 port )
+{
+	DictConnectAttempt *attempt;
+	GSocketAddress *socket_address;
+	GSocket *socket;
+	GError *loc_error = NULL;
+
+	socket = g_socket_new( g_inet_address_get_family( address ), G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_clear_error( &race->error );
+		race->error = loc_error;
+		return;
+	}
+	g_socket_set_blocking( socket, FALSE );
+
+#ifdef TCP_FASTOPEN_CONNECT
+	/* with a cookie of the server connect() returns at once and the first write goes with SYN, the address is not raced then */
+	if( race->fast_open )
+		g_socket_set_option( socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, NULL );
+#endif
+
+	socket_address = g_inet_socket_address_new( address, port );
+	g_socket_connect( socket, socket_address, NULL, &loc_error );
+	g_object_unref( socket_address );
+
+	/* connected at once */
+	if( loc_error == NULL )
+	{
+		race->winner = socket;
+		return;
+	}
+
+	if( !g_error_matches( loc_error, G_IO_ERROR, G_IO_ERROR_PENDING ) )
+	{
+		g_object_unref( socket );
+		g_clear_error( &race->error );
+		race->error = loc_error;
+		return;
+	}
+	g_clear_error( &loc_error );
+
+	/* wait until the socket is writable */
+	attempt = g_new( DictConnectAttempt, 1 );
+	attempt->race = race;
+	attempt->socket = socket;
+	attempt->source = g_socket_create_source( socket, G_IO_OUT, NULL );
+	g_source_set_callback( attempt->source, (GSourceFunc)connect_attempt_ready, attempt, NULL );
+	g_source_attach( attempt->source, race->context );
+	g_ptr_array_add( race->attempts, attempt );
+}
+
+/*
+Resolves the host using the cache and connects to the first responding address.
+An attempt is started every delay milliseconds, until one of them succeeds, so a dead address does not block the others.
+*/
+static GIOStream*
+connect_to_host(
+	const gchar *host,
+	guint16 port,
+	guint ttl,
+	guint delay,
+	gboolean fast_open,
+	GError **error )
+{
+	DictConnectRace race;
+	GSource *timeout;
+	GList *addresses, *ordered, *l;
+	GIOStream *iostream = NULL;
+	GError *loc_error = NULL;
+
+	addresses = resolve_host( host, ttl, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+	ordered = interleave_addresses( addresses );
+
+	race.context = g_main_context_new();
+	race.attempts = g_ptr_array_new_with_free_func( (GDestroyNotify)connect_attempt_free );
+	race.winner = NULL;
+	race.error = NULL;
+	race.fast_open = fast_open;
+
+	l = ordered;
+	while( race.winner == NULL )
+	{
+		if( l != NULL )
+		{
+			connect_attempt_start( &race, G_INET_ADDRESS( l->data ), port );
+			l = l->next;
+		}
+
+		/* all addresses failed */
+		if( race.winner != NULL || ( l == NULL && race.attempts->len == 0 ) )
+			break;
+
+		/* the next address will be tried after the delay or after all pending attempts failed */
+		race.delay_expired = FALSE;
+		timeout = NULL;
+		if( l != NULL )
+		{
+			timeout = g_timeout_source_new( delay );
+			g_source_set_callback( timeout, connect_delay_expired, &race, NULL );
+			g_source_attach( timeout, race.context );
+		}
+
+		while( race.winner == NULL && !race.delay_expired && race.attempts->len > 0 )
+			g_main_context_iteration( race.context, TRUE );
+
+		if( timeout != NULL )
+		{
+			g_source_destroy( timeout );
+			g_source_unref( timeout );
+		}
+	}
+
+	/* close the losers */
+	g_ptr_array_unref( race.attempts );
+	g_main_context_unref( race.context );
+	g_list_free( ordered );
+	g_resolver_free_addresses( addresses );
+
+	if( race.winner == NULL )
+	{
+		/* addresses may be outdated */
+		forget_host( host );
+
+		if( race.error == NULL )
+			g_set_error(
+				&race.error,
+				G_IO_ERROR,
+				G_IO_ERROR_HOST_NOT_FOUND,
+				"No address of host %s",
+				host );
+		g_propagate_error( error, race.error );
+		return NULL;
+	}
+	g_clear_error( &race.error );
+
+	g_socket_set_blocking( race.winner, TRUE );
+	iostream = G_IO_STREAM( g_socket_connection_factory_create_connection( race.winner ) );
+	g_object_unref( race.winner );
+
+	return iostream;
+}
+
+/*
+Makes streams over the connected self->iostream and greets the server.
+On error the connection is closed.
+*/
+static gboolean
+open_session(
+	DictClient *self,
+	const gchar *host,
+	guint16 port,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	DictResponse resp;
+	gchar *message = NULL;
+	GOutputStream *capture;
+	GInputStream *input;
+	gint64 start;
+	GError *loc_error = NULL;
+
+	/* make streams, recording ones put the traffic to the capture file */
+	if( self->capture_file != NULL )
+	{
+		start = g_get_monotonic_time();
+		capture = capture_open( self->capture_file, host, port, &loc_error );
+		if( loc_error != NULL )
+		{
+			g_propagate_error( error, loc_error );
+			goto failed;
+		}
+		input = capture_input_stream_new( g_io_stream_get_input_stream( self->iostream ), capture, start );
+		self->output = capture_output_stream_new( g_io_stream_get_output_stream( self->iostream ), capture, start );
+		g_object_unref( capture );
+	}
+	else
+	{
+		input = g_object_ref( g_io_stream_get_input_stream( self->iostream ) );
+		self->output = g_object_ref( g_io_stream_get_output_stream( self->iostream ) );
+	}
+	self->data_input = g_data_input_stream_new( input );
+	g_object_unref( input );
+
+	/* \r\n is used for newline */
+	g_data_input_stream_set_newline_type( self->data_input, G_DATA_STREAM_NEWLINE_TYPE_CR_LF );
+	/* maximum length of a received text is known from the protocol reference */
+	g_buffered_input_stream_set_buffer_size( G_BUFFERED_INPUT_STREAM( self->data_input ), DEFAULT_RECEIVE_TEXT_LEN + 1 );
+
+	/* introduce client to server without waiting for the banner, the server reads the command after sending it */
+	if( client_message != NULL )
+	{
+		command_begin( self->command, "CLIENT" );
+		command_append_string( self->command, client_message );
+		command_end( self->command );
+		flush_commands( self->output, self->command, NULL, &loc_error );
+		if( loc_error!= NULL )
+		{
+			g_propagate_error( error, loc_error );
+			goto failed;
+		}
+	}
+
+	/* receive response after successful connection */
+	resp = (DictResponse){NULL,};
+	resp.message = &message;
+	receive_response( self->data_input, &resp, NULL, &loc_error );
+	if( loc_error!= NULL )
+	{
+		g_propagate_error( error, loc_error );
+		goto failed;
+	}
+
+	if( client_message != NULL )
+	{
+		/* receive response after introducing */
+		receive_response( self->data_input, NULL, NULL, &loc_error );
+		if( loc_error!= NULL )
+		{
+			g_propagate_error( error, loc_error );
+			goto failed;
+		}
+	}
+
+	/* if needed, receive server response text */
+	if( server_response != NULL )
+		*server_response = message;
+	else
+		g_free( message );
+
+	/* save successfuly connected host and port */
+	self->host = g_strdup( host );
+	self->port = port;
+	DICT_PROBE3( connect__done, host, (unsigned)port, 1 );
+
+	return TRUE;
+
+failed:
+	DICT_PROBE3( connect__done, host, (unsigned)port, 0 );
+	g_clear_object( &self->data_input );
+	g_clear_object( &self->output );
+	g_clear_object( &self->iostream );
+	g_free( message );
+
+	return FALSE;
+}
+
+static gboolean
+connect_session(
+	DictClient *self,
+	const gchar *host,
+	guint16 port,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	GError *loc_error = NULL;
+
+	/* fast open needs data to put into SYN, the client message goes first */
+	DICT_PROBE2( connect__start, host, (unsigned)port );
+	self->iostream = connect_to_host( host, port, self->resolver_ttl, self->connect_delay, self->fast_open && client_message != NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		DICT_PROBE3( connect__done, host, (unsigned)port, 0 );
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	return open_session( self, host, port, client_message, server_response, error );
+}
+
+/* any transport GSocketClient knows: TCP, Unix domain sockets, abstract sockets */
+static gboolean
+connect_address_session(
+	DictClient *self,
+	GSocketAddress *address,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	GSocketClient *client;
+	GSocketConnection *connection;
+	gchar *host;
+	guint16 port = 0;
+	gboolean ret;
+	GError *loc_error = NULL;
+
+	/* the host of an inet address is its IP, other addresses are named by their paths */
+	if( G_IS_INET_SOCKET_ADDRESS( address ) )
+	{
+		host = g_inet_address_to_string( g_inet_socket_address_get_address( G_INET_SOCKET_ADDRESS( address ) ) );
+		port = g_inet_socket_address_get_port( G_INET_SOCKET_ADDRESS( address ) );
+	}
+	else
+		host = g_socket_connectable_to_string( G_SOCKET_CONNECTABLE( address ) );
+
+	DICT_PROBE2( connect__start, host, (unsigned)port );
+	client = g_socket_client_new();
+	connection = g_socket_client_connect( client, G_SOCKET_CONNECTABLE( address ), NULL, &loc_error );
+	g_object_unref( client );
+	if( loc_error != NULL )
+	{
+		DICT_PROBE3( connect__done, host, (unsigned)port, 0 );
+		g_free( host );
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	self->iostream = G_IO_STREAM( connection );
+	ret = open_session( self, host, port, client_message, server_response, error );
+	g_free( host );
+
+	return ret;
+}
+
+/* makes the connection deferred by the lazy mode, a failed one is tried again by the next command */
+static void
+session_drop(
+	DictClient *self )
+{
+	g_clear_object( &self->data_input );
+	g_clear_object( &self->output );
+	g_clear_object( &self->iostream );
+	g_clear_pointer( &self->host, g_free );
+
+	/* another server may define words otherwise */
+	prefetch_clear( self );
+	self->suggest_pending = FALSE;
+	suggest_clear( self );
+	cache_clear( self );
+	fan_out_clear( self );
+}
+
+/* a response which was not read to the end closes the input, the rest of it would be taken for the next responses */
+static void
+session_drop_broken(
+	DictClient *self )
+{
+	if( self->data_input != NULL && g_input_stream_is_closed( G_INPUT_STREAM( self->data_input ) ) )
+		session_drop( self );
+}
+
+static gboolean
+session_ensure(
+	DictClient *self,
+	gchar **server_response,
+	GError **error )
+{
+	gboolean ret;
+
+	session_drop_broken( self );
+	if( self->iostream != NULL )
+		return TRUE;
+
+	if( self->lazy_host != NULL )
+		ret = connect_session( self, self->lazy_host, self->lazy_port, self->lazy_message, server_response, error );
+	else if( self->lazy_address != NULL )
+		ret = connect_address_session( self, self->lazy_address, self->lazy_message, server_response, error );
+	else
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_NO_CONNECTION,
+			"No connection" );
+		return FALSE;
+	}
+
+	if( ret )
+		lazy_clear( self );
+
+	return ret;
+}
+
+/**
+\anchor dict_client_new
+\brief Creates a new DictClient instance.
+
+Use <tt>g_object_unref()</tt> to decrease the reference count of the new instance to 0 and destroys the instance. There is no need to call \ref dict_client_disconnect "dict_client_disconnect()" before.
+
+\return New DictClient instance.
+*/
+DictClient*
+dict_client_new(
+	void )
+{
+	return DICT_CLIENT( g_object_new( G_TYPE_DICT_CLIENT, NULL ) );
+}
+
+/**
+\anchor dict_client_is_connected
+\brief Check whether there was a connection to the server.
+
+This function always returns \c TRUE after successfull call of "dict_client_connect()", and \c FALSE otherwise or after call "dict_client_disconnect()".
+
+\param[in] self A DictClient instance.
+
+\return \c TRUE if there was the successfull connection or \c FALSE otherwise.
+*/
+gboolean
+dict_client_is_connected(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	
+	session_drop_broken( self );
+
+	return self->host != NULL || self->lazy_host != NULL || self->lazy_address != NULL;
+}
+
+/**
+\anchor dict_client_error_is_connection
+\brief Checks whether an error means the connection to the server is lost.
+
+The server has closed the connection or the network has failed, so the command may be sent again on a new connection. Refusals of the server are not connection errors.
+
+\param[in] error An error returned by a DictClient function.
+
+\return \c TRUE if the connection is lost or \c FALSE otherwise.
+*/
+gboolean
+dict_client_error_is_connection(
+	const GError *error )
+{
+	g_return_val_if_fail( error != NULL, FALSE );
+
+	return error->domain == G_IO_ERROR ||
+		g_error_matches( error, DICT_CLIENT_ERROR, DICT_CLIENT_ERROR_NO_CONNECTION ) ||
+		g_error_matches( error, DICT_CLIENT_ERROR, DICT_CLIENT_ERROR_SERVER_SHUTTING_DOWN_AT_OPERATOR_REQUEST );
+}
+
+/**
+\anchor dict_client_connect
+\brief Connects to the server.
+
+Use \ref dict_client_disconnect "dict_client_disconnect()" to disconnect the client from the server or decrease the reference count of the instance to 0 by <tt>g_object_unref()</tt>, that will destroy the instance.
+
+Addresses of the \c host are cached for \ref dict_client_set_resolver_ttl "resolver-ttl" seconds. If the \c host has several addresses, IPv6 and IPv4 ones are tried alternately, the next one is tried in parallel if the previous ones have not connected within \ref dict_client_set_connect_delay "connect-delay" milliseconds. The first connected address is used.
+
+The \c client_message is sent right after the connection is made, without waiting for the banner of the server. If the client is \ref dict_client_set_lazy_connect "lazy", only the arguments are kept, the connection is made by the first command or by \ref dict_client_prewarm "dict_client_prewarm()", and \c server_response holds NULL.
+
+\param[in] self A DictClient instance.
+\param[in] host Address of the server (IPv4, IPv6 or resolveable name).
+\param[in] port A port number to connect.
+\param[in] client_message If not NULL, this message will be sent to the server as a greeting.
+\param[out] server_response If not NULL, holds a greeting message from the server.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_connect(
+	DictClient *self,
+	const gchar *host,
+	const guint16 port,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( host != NULL, FALSE );
+
+	/* check if there is a connection */
+	if( dict_client_is_connected( self ) )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS,
+			"A connection already exists" );
+		return FALSE;
+	}
+
+	/* connect on the first command */
+	if( self->lazy_connect )
+	{
+		self->lazy_host = g_strdup( host );
+		self->lazy_port = port;
+		self->lazy_message = g_strdup( client_message );
+		if( server_response != NULL )
+			*server_response = NULL;
+		return TRUE;
+	}
+
+	return connect_session( self, host, port, client_message, server_response, error );
+}
+
+/**
+\anchor dict_client_prewarm
+\brief Makes the connection deferred by the lazy mode.
+
+A worker may call it while it has nothing else to do, so the first lookup does not wait for the resolver, the TCP handshake and the greeting. The function does nothing if the connection is already made. If it fails, the next command tries to connect again.
+
+\param[in] self A DictClient instance.
+\param[out] server_response If not NULL, holds a greeting message from the server or NULL if the connection was already made.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE if the client is connected or \c FALSE on error.
+*/
+gboolean
+dict_client_prewarm(
+	DictClient *self,
+	gchar **server_response,
+	GError **error )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+
+	if( server_response != NULL )
+		*server_response = NULL;
+
+	return session_ensure( self, server_response, error );
+}
+
+/**
+\anchor dict_client_connect_stream
+\brief Starts a session over an already connected stream.
+
+The \c stream may be any transport carrying the protocol, for example a pipe to a local server or an in-memory stream holding recorded responses. The client behaves as if connected by \ref dict_client_connect "dict_client_connect()", but its host is an empty string and its port is 0. The \c stream is closed on disconnection.
+
+\param[in] self A DictClient instance.
+\param[in] stream A connected stream, the client takes a reference to it.
+\param[in] client_message If not NULL, this message will be sent to the server as a greeting.
+\param[out] server_response If not NULL, holds a greeting message from the server.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_connect_stream(
+	DictClient *self,
+	GIOStream *stream,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( G_IS_IO_STREAM( stream ), FALSE );
+
+	if( dict_client_is_connected( self ) )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS,
+			"A connection already exists" );
+		return FALSE;
+	}
+
+	DICT_PROBE2( connect__start, "", 0u );
+	self->iostream = g_object_ref( stream );
+
+	return open_session( self, "", 0, client_message, server_response, error );
+}
+
+/**
+\anchor dict_client_connect_address
+\brief Connects to the server at a socket address.
+
+Works like \ref dict_client_connect "dict_client_connect()", but the transport is chosen by the \c address: a <tt>GInetSocketAddress</tt> connects by TCP without resolving, a <tt>GUnixSocketAddress</tt> connects to a co-located server or proxy through a Unix domain socket and skips the TCP stack. The host of the client is the IP of an inet address and its port, or the path of any other address and port 0. The connection may be \ref dict_client_set_lazy_connect "lazy".
+
+\param[in] self A DictClient instance.
+\param[in] address An address of the server, the client takes a reference to it.
+\param[in] client_message If not NULL, this message will be sent to the server as a greeting.
+\param[out] server_response If not NULL, holds a greeting message from the server.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_connect_address(
+	DictClient *self,
+	GSocketAddress *address,
+	const gchar *client_message,
+	gchar **server_response,
+	GError **error )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( G_IS_SOCKET_ADDRESS( address ), FALSE );
+
+	if( dict_client_is_connected( self ) )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS,
+			"A connection already exists" );
+		return FALSE;
+	}
+
+	/* connect on the first command */
+	if( self->lazy_connect )
+	{
+		self->lazy_address = g_object_ref( address );
+		self->lazy_message = g_strdup( client_message );
+		if( server_response != NULL )
+			*server_response = NULL;
+		return TRUE;
+	}
+
+	return connect_address_session( self, address, client_message, server_response, error );
+}
+
+/**
+\anchor dict_client_disconnect
+\brief Breaks a connection to the server.
+
+Any operation with disconnected DictClient will lead to error.
+
+\param[in] self A DictClient instance.
+\param[out] server_response If not NULL, holds a farewell message from the server.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_disconnect(
+	DictClient *self,
+	gchar **server_response,
+	GError **error )
+{
+	DictResponse resp;
+	gboolean ret = TRUE;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+
+	if( !dict_client_is_connected( self ) )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_NO_CONNECTION,
+			"No connection" );
+		return FALSE;
+	}
+
+	/* a lazy client has nothing to break */
+	if( self->iostream == NULL )
+	{
+		if( server_response != NULL )
+			*server_response = NULL;
+		lazy_clear( self );
+		return TRUE;
+	}
+
+	DICT_PROBE1( disconnect__start, self->host );
+
+	/* a response to suggestions must not be taken for the farewell */
+	suggest_drain( self, NULL );
+
+	/* send goodbye command to server */
+	command_begin( self->command, "QUIT" );
+	command_end( self->command );
+	flush_commands( self->output, self->command, NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		ret = FALSE;
+		goto out;
+	}
+
+	/* receive farewell response */
+	resp = (DictResponse){NULL,};
+	resp.message = server_response;
+	receive_response( self->data_input, &resp, NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		ret = FALSE;
+	}
+
+out:
+	DICT_PROBE2( disconnect__done, self->host, ret );
+	session_drop( self );
+
+	return ret;
+}
+
+/**
+anchor dict_client_define
+\brief Looks up the \c word in the \c database of the server.
+
+If \c database is <tt>!</tt> , then all databases of the server will be scanned until the first match. If \c database is <tt>*</tt> , then all databases of the server will be scaned for all matches. The \c database is searched in the same order as that got by \ref dict_client_show_databases "dict_client_show_databases()". Sizes of \c words, \c databases, \c descriptions and \c definitions are the same.
+
+If there is a headword filter for the \c database (see \ref dict_client_build_filter "dict_client_build_filter()") and the \c word is certainly absent in it, no command is sent to the server and 0 is returned immediately.
+
+If the cache is enabled, definitions of recently looked up words are kept (see \ref dict_client_set_cache_size "dict_client_set_cache_size()") and returned without asking the server. If prefetching is enabled (see \ref dict_client_set_prefetch_budget "dict_client_set_prefetch_budget()"), words cross-referenced by the definitions are requested through an extra connection before this function returns, but their responses are read later.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[out] words If not NULL, holds an array of words found in the \c databases.
+\param[out] databases If not NULL, holds an array of the databases holding the \c words.
+\param[out] descriptions If not NULL, holds an array of the descriptions about the \c databases.
+\param[out] definitions If not NULL, holds an array of the definitions of the \c words.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of the found definitions or -1 on error.
+*/
+glong
+dict_client_define(
+	DictClient *self,
+	const gchar *database,
+	const gchar *word,
+	GStrv *words,
+	GStrv *databases,
+	GStrv *descriptions,
+	GStrv *definitions,
+	GError **error )
+{
+	DictFilter *filter;
+	DictCacheEntry *entry;
+	GStrv loc_words, loc_databases, loc_descriptions, loc_definitions;
+	gchar *key;
+	glong number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	g_return_val_if_fail( database != NULL, -1 );
+	g_return_val_if_fail( word != NULL , -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+	suggest_clear( self );
+
+	/* the word is certainly absent, there is no need to ask the server */
+	filter = g_hash_table_lookup( self->filters, database );
+	if( filter != NULL && !filter_contains( filter, word ) )
+	{
+		pstrnullv( words );
+		pstrnullv( databases );
+		pstrnullv( descriptions );
+		pstrnullv( definitions );
+
+		return 0;
+	}
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+	self->prefetch_remaining = self->prefetch_budget;
+	prefetch_poll( self );
+
+	key = cache_key( database, word );
+	entry = cache_lookup( self, key );
+	if( entry != NULL )
+	{
+		g_free( key );
+		goto found;
+	}
+
+	/* all databases are asked in parallel, the server would search them one by one */
+	if( self->fan_out > 0 && g_strcmp0( database, "*" ) == 0 )
+	{
+		number = fan_out_define( self, word, &loc_words, &loc_databases, &loc_descriptions, &loc_definitions );
+		if( number >= 0 )
+			goto received;
+	}
+
+	command_begin( self->command, "DEFINE" );
+	command_append_string( self->command, database );
+	command_append_string( self->command, word );
+	command_end( self->command );
+	suggest_queue( self, database, word );
+	flush_commands( self->output, self->command, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		self->suggest_pending = FALSE;
+		g_free( key );
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	number = receive_definitions( self->data_input, &loc_words, &loc_databases, &loc_descriptions, &loc_definitions, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_free( key );
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* the suggestions are already on the way, a failure shows up at the next command */
+	if( number == 0 && self->suggest_pending )
+		self->suggest_number = suggest_receive( self, &self->suggest_databases, &self->suggest_words, NULL );
+
+received:
+	entry = cache_insert( self, key, number, loc_words, loc_databases, loc_descriptions, loc_definitions );
+	if( entry != NULL )
+		goto found;
+
+	/* there is no cache, so nothing to prefetch into */
+	if( words != NULL )
+		*words = loc_words;
+	else
+		g_strfreev( loc_words );
+	if( databases != NULL )
+		*databases = loc_databases;
+	else
+		g_strfreev( loc_databases );
+	if( descriptions != NULL )
+		*descriptions = loc_descriptions;
+	else
+		g_strfreev( loc_descriptions );
+	if( definitions != NULL )
+		*definitions = loc_definitions;
+	else
+		g_strfreev( loc_definitions );
+
+	return number;
+
+found:
+	if( words != NULL )
+		*words = g_strdupv( entry->words );
+	if( databases != NULL )
+		*databases = g_strdupv( entry->databases );
+	if( descriptions != NULL )
+		*descriptions = g_strdupv( entry->descriptions );
+	if( definitions != NULL )
+		*definitions = g_strdupv( entry->definitions );
+	number = entry->number;
+
+	/* the caller is likely to follow a cross-reference next, failures show up at the next command */
+	prefetch_references( self, database, entry->definitions, 1 );
+	prefetch_poll( self );
+
+	return number;
+}
+
+/**
+\anchor dict_client_match
+\brief Trys to match the word in the database with the selected strategy.
+
+This function scans an index of the \c database and returns the \c words array holding words those were found using the \c strategy. Not all databases support all strategies, but all databases must support \c prefix and \c exact. Sizes of returned \c databases and \c words are the same. Use items of \c databases and \c words as pairs.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] strategy A strategy to search with, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[out] databases If not NULL, holds an array of the databases holding the \c words. May be NUll, if no \c word in \c database with \c strategy.
+\param[out] words If not NULL, holds an array of words found in the \c databases. May be NUll, if no \c word in \c database with \c strategy.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of the found database-word pairs or -1 on error.
+*/
+glong
+dict_client_match(
+	DictClient *self,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	GStrv *databases,
+	GStrv *words,
+	GError **error )
+{
+	glong number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	g_return_val_if_fail( database != NULL, -1 );
+	g_return_val_if_fail( strategy != NULL, -1 );
+	g_return_val_if_fail( word != NULL , -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+
+	command_begin( self->command, "MATCH" );
+	command_append_string( self->command, database );
+	command_append_string( self->command, strategy );
+	command_append_string( self->command, word );
+	command_end( self->command );
+	number = send_receive_arrays( self->output, self->data_input, self->command, databases, words, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return number;
+}
+
+/**
+\anchor dict_client_define_foreach
+\brief Looks up the \c word in the \c database of the server and passes every definition to \c func as soon as it is received.
+
+Works like \ref dict_client_define "dict_client_define()", but the definitions are not collected into arrays, so the first one may be processed while the others are still on the way. Strings passed to \c func are valid until it returns.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] func A function called for every definition.
+\param[in] user_data Data passed to \c func.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of the found definitions or -1 on error, \c func may have been called before the error.
+*/
+glong
+dict_client_define_foreach(
+	DictClient *self,
+	const gchar *database,
+	const gchar *word,
+	DictClientDefinitionFunc func,
+	gpointer user_data,
+	GError **error )
+{
+	DictFilter *filter;
+	DictCacheEntry *entry;
+	DefinitionForeach foreach;
+	DefinitionArrays arrays;
+	GStrv words, databases, descriptions, definitions;
+	gchar *key;
+	glong i, number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	g_return_val_if_fail( database != NULL, -1 );
+	g_return_val_if_fail( word != NULL , -1 );
+	g_return_val_if_fail( func != NULL , -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+	suggest_clear( self );
+
+	/* the word is certainly absent, there is no need to ask the server */
+	filter = g_hash_table_lookup( self->filters, database );
+	if( filter != NULL && !filter_contains( filter, word ) )
+		return 0;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+	self->prefetch_remaining = self->prefetch_budget;
+	prefetch_poll( self );
+
+	key = cache_key( database, word );
+	entry = cache_lookup( self, key );
+	if( entry != NULL )
+	{
+		g_free( key );
+		for( i = 0; i < entry->number; ++i )
+			func( self, entry->words[i], entry->databases[i], entry->descriptions[i], entry->definitions[i], strlen( entry->definitions[i] ), user_data );
+		goto found;
+	}
+
+	/* all databases are asked in parallel, the definitions are passed when all of them have come */
+	if( self->fan_out > 0 && g_strcmp0( database, "*" ) == 0 )
+	{
+		number = fan_out_define( self, word, &words, &databases, &descriptions, &definitions );
+		if( number >= 0 )
+		{
+			for( i = 0; i < number; ++i )
+				func( self, words[i], databases[i], descriptions[i], definitions[i], strlen( definitions[i] ), user_data );
+
+			entry = cache_insert( self, key, number, words, databases, descriptions, definitions );
+			if( entry != NULL )
+				goto found;
+
+			g_strfreev( words );
+			g_strfreev( databases );
+			g_strfreev( descriptions );
+			g_strfreev( definitions );
+			return number;
+		}
+	}
+
+	command_begin( self->command, "DEFINE" );
+	command_append_string( self->command, database );
+	command_append_string( self->command, word );
+	command_end( self->command );
+	suggest_queue( self, database, word );
+	flush_commands( self->output, self->command, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		self->suggest_pending = FALSE;
+		g_free( key );
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* definitions are kept only if there is a cache to put them in */
+	foreach.self = self;
+	foreach.func = func;
+	foreach.user_data = user_data;
+	foreach.arrays = NULL;
+	if( self->cache_size > 0 )
+	{
+		definition_arrays_init( &arrays );
+		foreach.arrays = &arrays;
+	}
+
+	number = receive_definitions_with( self->data_input, self->text_limit, TRUE, definition_foreach_add, &foreach, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		if( foreach.arrays != NULL )
+			definition_arrays_clear( &arrays );
+		g_free( key );
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* the suggestions are already on the way, a failure shows up at the next command */
+	if( number == 0 && self->suggest_pending )
+		self->suggest_number = suggest_receive( self, &self->suggest_databases, &self->suggest_words, NULL );
+
+	if( foreach.arrays == NULL )
+	{
+		g_free( key );
+		return number;
+	}
+
+	definition_arrays_steal( &arrays, &words, &databases, &descriptions, &definitions );
+	entry = cache_insert( self, key, number, words, databases, descriptions, definitions );
+
+	/* func may have disabled the cache */
+	if( entry == NULL )
+	{
+		g_strfreev( words );
+		g_strfreev( databases );
+		g_strfreev( descriptions );
+		g_strfreev( definitions );
+		return number;
+	}
+
+found:
+	number = entry->number;
+
+	/* the caller is likely to follow a cross-reference next, failures show up at the next command */
+	prefetch_references( self, database, entry->definitions, 1 );
+	prefetch_poll( self );
+
+	return number;
+}
+
+/**
+\anchor dict_client_match_foreach
+\brief Trys to match the word in the database with the selected strategy and passes every database-word pair to \c func.
+
+Works like \ref dict_client_match "dict_client_match()", but the pairs are parsed in place of the received list and are not copied into arrays. Strings passed to \c func are valid until it returns.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] strategy A strategy to search with, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] func A function called for every pair.
+\param[in] user_data Data passed to \c func.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of the found database-word pairs or -1 on error.
+*/
+glong
+dict_client_match_foreach(
+	DictClient *self,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	DictClientPairFunc func,
+	gpointer user_data,
+	GError **error )
+{
+	DictResponse resp;
+	const gchar *data, *desc;
+	gchar *text, *cursor;
+	glong i, number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	g_return_val_if_fail( database != NULL, -1 );
+	g_return_val_if_fail( strategy != NULL, -1 );
+	g_return_val_if_fail( word != NULL , -1 );
+	g_return_val_if_fail( func != NULL , -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+
+	command_begin( self->command, "MATCH" );
+	command_append_string( self->command, database );
+	command_append_string( self->command, strategy );
+	command_append_string( self->command, word );
+	command_end( self->command );
+	flush_commands( self->output, self->command, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* try to get number of pairs */
+	number = 0;
+	resp = (DictResponse){NULL,};
+	resp.number = &number;
+	receive_response( self->data_input, &resp, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* number == 0 means no list and no OK status */
+	if( number == 0 )
+		return 0;
+
+	text = receive_text( self->data_input, NULL, self->text_limit, NULL, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	cursor = text;
+	for( i = 0; i < number && next_pair( &cursor, &data, &desc ); ++i )
+		func( self, data, desc, user_data );
+	g_free( text );
+
+	/* receive OK status */
+	receive_response( self->data_input, NULL, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return number;
+}
+
+/**
+\anchor dict_client_show_databases
+\brief Recieves an array of currently accessible databases at the server.
+
+\param[in] self A \c DictClient instance.
+\param[out] databases If not NULL, holds an array of database names.
+\param[out] descriptions If not NULL, holds an array of database descriptions.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of the dictionary databases at the server or -1 on error.
+*/
+glong
+dict_client_show_databases(
+	DictClient *self,
+	GStrv *databases,
+	GStrv *descriptions,
+	GError **error )
+{
+	glong number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+
+	command_begin( self->command, "SHOW DATABASES" );
+	command_end( self->command );
+	number = send_receive_arrays( self->output, self->data_input, self->command, databases, descriptions, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return number;
+}
+
+/**
+\anchor dict_client_show_strategies
+\brief Recieves an array of the search strategies supported by the server.
+
+\param[in] self A \c DictClient instance.
+\param[out] strategies If not NULL, holds an array of strategy names.
+\param[out] descriptions If not NULL, holds an array of strategy descriptions.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of strategies the server can use or -1 on error.
+*/
+glong
+dict_client_show_strategies(
+	DictClient *self,
+	GStrv *strategies,
+	GStrv *descriptions,
+	GError **error )
+{
+	glong number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+
+	command_begin( self->command, "SHOW STRATEGIES" );
+	command_end( self->command );
+	number = send_receive_arrays( self->output, self->data_input, self->command, strategies, descriptions, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return number;
+}
+
+/**
+\anchor dict_client_show_info
+\brief Recieves the source, copyright and licensing information about the specified database in free form.
+
+\param[in] self A \c DictClient instance.
+\param[in] database Name of the database.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A newly allocated string or NULL on error.
+*/
+gchar*
+dict_client_show_info(
+	DictClient *self,
+	const gchar *database,
+	GError **error )
+{
+	gchar *text;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+	g_return_val_if_fail( database != NULL, NULL );
+
+	if( !session_ensure( self, NULL, error ) )
+		return NULL;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return NULL;
+
+	command_begin( self->command, "SHOW INFO" );
+	command_append_string( self->command, database );
+	command_end( self->command );
+	text = send_receive_information( self->output, self->data_input, self->command, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	return text;
+}
+
+/**
+\anchor dict_client_show_info_to_stream
+\brief Writes the source, copyright and licensing information about the specified database to a stream.
+
+Works like \ref dict_client_show_info "dict_client_show_info()", but the text is written while it is received, so the client holds only a small part of it whatever the text limit is. If writing to the stream fails, the rest of the text is not read and the connection is dropped, the next command fails with \c DICT_CLIENT_ERROR_NO_CONNECTION.
+
+\param[in] self A \c DictClient instance.
+\param[in] database Name of the database.
+\param[in] stream A stream to write the text to, it is neither flushed nor closed.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A number of bytes written or -1 on error.
+*/
+gssize
+dict_client_show_info_to_stream(
+	DictClient *self,
+	const gchar *database,
+	GOutputStream *stream,
+	GError **error )
+{
+	DictSpill spill = {NULL,};
+	gchar *text;
+	gsize length;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	g_return_val_if_fail( database != NULL, -1 );
+	g_return_val_if_fail( G_IS_OUTPUT_STREAM( stream ), -1 );
+
+	if( !session_ensure( self, NULL, error ) )
+		return -1;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return -1;
+
+	command_begin( self->command, "SHOW INFO" );
+	command_append_string( self->command, database );
+	command_end( self->command );
+	flush_commands( self->output, self->command, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* receive confirmation */
+	receive_response( self->data_input, NULL, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* the text goes to the stream by fills of the buffer, a short one is written at the end */
+	spill.stream = stream;
+	text = receive_text( self->data_input, &length, DEFAULT_RECEIVE_TEXT_LEN, &spill, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	/* receive OK status */
+	receive_response( self->data_input, NULL, self->trace, &loc_error );
+	if( loc_error == NULL && text != NULL )
+		spill_write( &spill, text, length, &loc_error );
+	g_free( text );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return -1;
+	}
+
+	return (gssize)spill.length;
+}
+
+/**
+\anchor dict_client_show_server
+\brief Recieves a server information written by the administrator in free form.
+
+\param[in] self A DictClient instance.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A newly allocated string or NULL on error.
+*/
+gchar*
+dict_client_show_server(
+	DictClient *self,
+	GError **error )
+{
+	gchar *text;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	if( !session_ensure( self, NULL, error ) )
+		return NULL;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return NULL;
+
+	command_begin( self->command, "SHOW SERVER" );
+	command_end( self->command );
+	text = send_receive_information( self->output, self->data_input, self->command, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	return text;
+}
+
+/**
+\anchor dict_client_status
+\brief Recieves some server-specific timing and debugging information about the server in free form.
+
+\param[in] self A DictClient instance.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A newly allocated string or NULL on error.
+*/
+gchar*
+dict_client_status(
+	DictClient *self,
+	GError **error )
+{
+	DictResponse resp;
+	gchar *text;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	if( !session_ensure( self, NULL, error ) )
+		return NULL;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return NULL;
+
+	command_begin( self->command, "STATUS" );
+	command_end( self->command );
+	flush_commands( self->output, self->command, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	/* status response is a simple line */
+	resp = (DictResponse){NULL,};
+	resp.message = &text;
+	receive_response( self->data_input, &resp, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	return text;
+}
+
+/**
+\anchor dict_client_help
+\brief Recieves a short summary of commands that are understood by the server.
+
+\param[in] self A DictClient instance.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return A newly allocated string or NULL on error.
+*/
+gchar*
+dict_client_help(
+	DictClient *self,
+	GError **error )
+{
+	gchar *text;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	if( !session_ensure( self, NULL, error ) )
+		return NULL;
+
+	/* a skipped response comes first */
+	if( !suggest_drain( self, error ) )
+		return NULL;
+
+	command_begin( self->command, "HELP" );
+	command_end( self->command );
+	text = send_receive_information( self->output, self->data_input, self->command, self->text_limit, self->trace, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return NULL;
+	}
+
+	return text;
+}
+
+/**
+\anchor dict_client_build_filter
+\brief Builds a headword filter of the database from the server.
+
+The filter is a probabilistic set of all headwords of the \c database, they are requested by <tt>MATCH</tt> command with the \c strategy and the \c word. So, the pair must match all the headwords, for example, <tt>re</tt> and <tt>.</tt> . After that \ref dict_client_define "dict_client_define()" returns 0 immediately for words certainly absent in the \c database. About 1% of absent words still reach the server. A previous filter of the \c database is replaced.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database name, must not be NULL, <tt>*</tt> or <tt>!</tt>.
+\param[in] strategy A strategy to match all headwords, must not be NULL.
+\param[in] word A word to match all headwords, must not be NULL.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_build_filter(
+	DictClient *self,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	GError **error )
+{
+	DictFilter *filter;
+	GStrv words;
+	guint8 *bits;
+	glong i, number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( database != NULL, FALSE );
+	g_return_val_if_fail( strategy != NULL, FALSE );
+	g_return_val_if_fail( word != NULL, FALSE );
+
+	if( !filter_check_database( database, error ) )
+		return FALSE;
+
+	number = dict_client_match( self, database, strategy, word, NULL, &words, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	/* an empty filter would reject every word */
+	if( number == 0 )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_INVALID_FILTER,
+			"No headwords in database %s",
+			database );
+		return FALSE;
+	}
+
+	filter = filter_new( number, &bits );
+	for( i = 0; i < number; ++i )
+		filter_add( bits, filter->n_bits, filter->n_hashes, words[i], -1 );
+	g_strfreev( words );
+
+	g_hash_table_replace( self->filters, g_strdup( database ), filter );
+
+	return TRUE;
+}
+
+/**
+\anchor dict_client_build_filter_from_index
+\brief Builds a headword filter of the database from a local index file.
+
+Works as \ref dict_client_build_filter "dict_client_build_filter()", but headwords are read from the dictd index file \c index_path, which holds a headword followed by a tab character in every line. No connection is needed.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database name, must not be NULL, <tt>*</tt> or <tt>!</tt>.
+\param[in] index_path A path to the index file of the \c database.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_build_filter_from_index(
+	DictClient *self,
+	const gchar *database,
+	const gchar *index_path,
+	GError **error )
+{
+	DictFilter *filter;
+	GMappedFile *file;
+	const gchar *s, *end, *eol, *tab;
+	guint8 *bits;
+	guint64 number;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( database != NULL, FALSE );
+	g_return_val_if_fail( index_path != NULL, FALSE );
+
+	if( !filter_check_database( database, error ) )
+		return FALSE;
+
+	file = g_mapped_file_new( index_path, FALSE, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	s = g_mapped_file_get_contents( file );
+	end = s + g_mapped_file_get_length( file );
+
+	/* count lines to size the filter */
+	number = 0;
+	for( eol = s; eol < end && ( eol = memchr( eol, '\n', end - eol ) ) != NULL; eol++ )
+		number++;
+	if( end > s && end[-1] != '\n' )
+		number++;
+
+	if( number == 0 )
+	{
+		g_mapped_file_unref( file );
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_INVALID_FILTER,
+			"No headwords in index file %s",
+			index_path );
+		return FALSE;
+	}
+
+	filter = filter_new( number, &bits );
+	for( ; s < end; s = eol + 1 )
+	{
+		eol = memchr( s, '\n', end - s );
+		if( eol == NULL )
+			eol = end;
+
+		tab = memchr( s, '\t', eol - s );
+		filter_add( bits, filter->n_bits, filter->n_hashes, s, ( tab != NULL ? tab : eol ) - s );
+	}
+	g_mapped_file_unref( file );
+
+	g_hash_table_replace( self->filters, g_strdup( database ), filter );
+
+	return TRUE;
+}
+
+/**
+\anchor dict_client_load_filter
+\brief Loads a headword filter of the database saved by \ref dict_client_save_filter "dict_client_save_filter()".
+
+The file is mapped into memory, not read. A previous filter of the \c database is replaced.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database name, must not be NULL, <tt>*</tt> or <tt>!</tt>.
+\param[in] path A path to the filter file.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_load_filter(
+	DictClient *self,
+	const gchar *database,
+	const gchar *path,
+	GError **error )
+{
+	DictFilter *filter;
+	GMappedFile *file;
+	const gchar *data;
+	guint32 version, n_hashes;
+	guint64 n_bits;
+	gsize length;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( database != NULL, FALSE );
+	g_return_val_if_fail( path != NULL, FALSE );
+
+	if( !filter_check_database( database, error ) )
+		return FALSE;
+
+	file = g_mapped_file_new( path, FALSE, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	/* header: magic, version, number of hashes, reserved, number of bits */
+	data = g_mapped_file_get_contents( file );
+	length = g_mapped_file_get_length( file );
+	if( length < FILTER_HEADER_LEN || memcmp( data, FILTER_MAGIC, 4 ) != 0 )
+		goto failed;
+
+	memcpy( &version, data + 4, sizeof( version ) );
+	memcpy( &n_hashes, data + 8, sizeof( n_hashes ) );
+	memcpy( &n_bits, data + 16, sizeof( n_bits ) );
+	version = GUINT32_FROM_LE( version );
+	n_hashes = GUINT32_FROM_LE( n_hashes );
+	n_bits = GUINT64_FROM_LE( n_bits );
+	if( version != FILTER_VERSION || n_hashes == 0 || n_hashes > MAX_FILTER_HASHES || n_bits == 0 || ( length - FILTER_HEADER_LEN ) * 8 < n_bits )
+		goto failed;
+
+	filter = g_new( DictFilter, 1 );
+	filter->n_bits = n_bits;
+	filter->n_hashes = n_hashes;
+	filter->bits = g_bytes_new_with_free_func( data + FILTER_HEADER_LEN, ( n_bits + 7 ) / 8, (GDestroyNotify)g_mapped_file_unref, file );
+
+	g_hash_table_replace( self->filters, g_strdup( database ), filter );
+
+	return TRUE;
+
+failed:
+	g_mapped_file_unref( file );
+	g_set_error(
+		error,
+		DICT_CLIENT_ERROR,
+		DICT_CLIENT_ERROR_INVALID_FILTER,
+		"Invalid filter file %s",
+		path );
+
+	return FALSE;
+}
+
+/**
+\anchor dict_client_save_filter
+\brief Saves the headword filter of the database to a file.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database name, must not be NULL.
+\param[in] path A path to the filter file, the file is replaced.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_client_save_filter(
+	DictClient *self,
+	const gchar *database,
+	const gchar *path,
+	GError **error )
+{
+	DictFilter *filter;
+	const guint8 *bits;
+	gchar *data;
+	guint32 value;
+	guint64 n_bits;
+	gsize length;
+	gboolean ret;
+
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+	g_return_val_if_fail( database != NULL, FALSE );
+	g_return_val_if_fail( path != NULL, FALSE );
+
+	filter = g_hash_table_lookup( self->filters, database );
+	if( filter == NULL )
+	{
+		g_set_error(
+			error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_NO_FILTER,
+			"No filter for database %s",
+			database );
+		return FALSE;
+	}
+
+	bits = g_bytes_get_data( filter->bits, &length );
+	data = g_malloc0( FILTER_HEADER_LEN + length );
+
+	memcpy( data, FILTER_MAGIC, 4 );
+	value = GUINT32_TO_LE( FILTER_VERSION );
+	memcpy( data + 4, &value, sizeof( value ) );
+	value = GUINT32_TO_LE( filter->n_hashes );
+	memcpy( data + 8, &value, sizeof( value ) );
+	n_bits = GUINT64_TO_LE( filter->n_bits );
+	memcpy( data + 16, &n_bits, sizeof( n_bits ) );
+	memcpy( data + FILTER_HEADER_LEN, bits, length );
+
+	ret = g_file_set_contents( path, data, FILTER_HEADER_LEN + length, error );
+	g_free( data );
+
+	return ret;
+}
+
+/**
+\anchor dict_client_remove_filter
+\brief Removes the headword filter of the database, if any.
+
+\param[in] self A \c DictClient instance.
+\param[in] database A database name, must not be NULL.
+*/
+void
+dict_client_remove_filter(
+	DictClient *self,
+	const gchar *database )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+	g_return_if_fail( database != NULL );
+
+	g_hash_table_remove( self->filters, database );
+}
+
+/**
+\anchor dict_client_get_host
+\brief Get the host name.
+
+\param[in] self A DictClient instance.
+
+\return A newly allocated string or NULL on error.
+*/
+gchar*
+dict_client_get_host(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	return g_strdup( self->host );
+}
+
+/**
+\anchor dict_client_get_port
+\brief Get the port number.
+
+\param[in] self A DictClient instance.
+
+\return An guint16 port number.
+*/
+guint16
+dict_client_get_port(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->port;
+}
+
+/**
+\anchor dict_client_set_resolver_ttl
+\brief Sets a time to cache resolved host addresses.
+
+The cache is shared by all DictClient instances, but every instance uses its own time to decide whether cached addresses are fresh. Addresses are forgotten when none of them can be connected.
+
+\param[in] self A DictClient instance.
+\param[in] ttl A number of seconds, 0 disables the cache. Default is 60.
+*/
+void
+dict_client_set_resolver_ttl(
+	DictClient *self,
+	guint ttl )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	self->resolver_ttl = ttl;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_RESOLVER_TTL] );
+}
+
+/**
+\anchor dict_client_get_resolver_ttl
+\brief Get the time to cache resolved host addresses.
+
+\param[in] self A DictClient instance.
+
+\return A number of seconds.
+*/
+guint
+dict_client_get_resolver_ttl(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->resolver_ttl;
+}
+
+/**
+\anchor dict_client_set_connect_delay
+\brief Sets a delay to try the next host address in parallel on connection.
+
+\param[in] self A DictClient instance.
+\param[in] delay A number of milliseconds. Default is 250.
+*/
+void
+dict_client_set_connect_delay(
+	DictClient *self,
+	guint delay )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	self->connect_delay = delay;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_CONNECT_DELAY] );
+}
+
+/**
+\anchor dict_client_get_connect_delay
+\brief Get the delay to try the next host address in parallel on connection.
+
+\param[in] self A DictClient instance.
+
+\return A number of milliseconds.
+*/
+guint
+dict_client_get_connect_delay(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->connect_delay;
+}
+
+/**
+\anchor dict_client_set_slow_threshold
+\brief Sets a time a request may take before it is logged.
+
+A request taking longer is logged by <tt>g_log_structured()</tt> with the \c LIBRARY_NAME domain and \c G_LOG_LEVEL_MESSAGE level. The record holds the request ID, the command, byte counts, the response code and the times of the send, the first status line, every 151 header with its database and the final status, in microseconds from the start of the request. Requests answered from the cache or the headword filter send nothing and are not logged.
+
+\param[in] self A DictClient instance.
+\param[in] threshold A number of milliseconds, 0 disables logging. Default is 0.
+*/
+void
+dict_client_set_slow_threshold(
+	DictClient *self,
+	guint threshold )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	if( threshold == 0 )
+		g_clear_pointer( &self->trace, trace_free );
+	else if( self->trace == NULL )
+		self->trace = trace_new( threshold );
+	else
+		self->trace->threshold = (gint64)threshold * 1000;
+
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_SLOW_THRESHOLD] );
+}
+
+/**
+\anchor dict_client_get_slow_threshold
+\brief Gets the time a request may take before it is logged.
+
+\param[in] self A DictClient instance.
+
+\return A number of milliseconds, 0 if logging is disabled.
+*/
+guint
+dict_client_get_slow_threshold(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->trace != NULL ? (guint)( self->trace->threshold / 1000 ) : 0;
+}
+
+/**
+\anchor dict_client_get_request_id
+\brief Gets the ID of the last request sent by the client.
+
+IDs are given only if slow requests are logged (see \ref dict_client_set_slow_threshold "dict_client_set_slow_threshold()"), they are unique among all clients of the process. The ID may be attached to the caller's own logs to find the matching slow request record.
+
+\param[in] self A DictClient instance.
+
+\return A request ID or 0.
+*/
+guint
+dict_client_get_request_id(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->trace != NULL ? self->trace->id : 0;
+}
+
+/**
+\anchor dict_client_set_capture_file
+\brief Sets a file the traffic of the client is recorded to.
+
+Every byte sent and received is recorded with its time from the next connection on, a session of every connection is appended to the file. The file may be served back by the <tt>glib-dict-replay</tt> program to reproduce the server's responses and timing without the server. A failed write to the file stops recording but does not break the connection. The file must not be shared by several clients.
+
+\param[in] self A DictClient instance.
+\param[in] filename A path of the file or NULL to stop recording. Default is NULL.
+*/
+void
+dict_client_set_capture_file(
+	DictClient *self,
+	const gchar *filename )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	g_free( self->capture_file );
+	self->capture_file = g_strdup( filename );
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_CAPTURE_FILE] );
+}
+
+/**
+\anchor dict_client_get_capture_file
+\brief Gets a file the traffic of the client is recorded to.
+
+\param[in] self A DictClient instance.
+
+\return A newly allocated string or NULL if the traffic is not recorded.
+*/
+gchar*
+dict_client_get_capture_file(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	return g_strdup( self->capture_file );
+}
+
+/**
+\anchor dict_client_set_text_limit
+\brief Sets a number of bytes a text of a response may take in memory.
+
+A longer definition passed to \ref dict_client_define_foreach "dict_client_define_foreach()" is written to a temporary file in \c g_get_tmp_dir() and passed mapped, the file is removed as soon as it is mapped. Functions returning the text as strings or arrays fail with \c DICT_CLIENT_ERROR_TEXT_TOO_LONG on a longer text and stop reading it, the connection is dropped then and the next command fails with \c DICT_CLIENT_ERROR_NO_CONNECTION. \ref dict_client_show_info_to_stream "dict_client_show_info_to_stream()" is not limited. The limit protects the process from a server sending endless text.
+
+\param[in] self A DictClient instance.
+\param[in] limit A number of bytes, 0 disables the limit. Default is 0.
+*/
+void
+dict_client_set_text_limit(
+	DictClient *self,
+	guint limit )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	self->text_limit = limit;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_TEXT_LIMIT] );
+}
+
+/**
+\anchor dict_client_get_text_limit
+\brief Gets the number of bytes a text of a response may take in memory.
+
+\param[in] self A DictClient instance.
+
+\return A number of bytes, 0 if there is no limit.
+*/
+guint
+dict_client_get_text_limit(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->text_limit;
+}
+
+/**
+\anchor dict_client_set_lazy_connect
+\brief Sets whether the connection is deferred until the first command.
+
+A lazy client keeps the arguments of \ref dict_client_connect "dict_client_connect()" and connects when a command needs the server, so a worker that never looks anything up never connects. \ref dict_client_prewarm "dict_client_prewarm()" connects ahead of the first command. The mode affects next calls of \ref dict_client_connect "dict_client_connect()".
+
+\param[in] self A DictClient instance.
+\param[in] lazy_connect \c TRUE to defer the connection. Default is \c FALSE.
+*/
+void
+dict_client_set_lazy_connect(
+	DictClient *self,
+	gboolean lazy_connect )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	self->lazy_connect = lazy_connect;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_LAZY_CONNECT] );
+}
+
+/**
+\anchor dict_client_get_lazy_connect
+\brief Gets whether the connection is deferred until the first command.
+
+\param[in] self A DictClient instance.
+
+\return \c TRUE if the connection is deferred.
+*/
+gboolean
+dict_client_get_lazy_connect(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
 
-	return number;
+	return self->lazy_connect;
 }
 
 /**
-\anchor dict_client_show_databases
-\brief Recieves an array of currently accessible databases at the server.
+\anchor dict_client_set_fast_open
+\brief Sets whether TCP Fast Open is used on connection.
 
-\param[in] self A \c DictClient instance.
-\param[out] databases If not NULL, holds an array of database names.
-\param[out] descriptions If not NULL, holds an array of database descriptions.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+If the kernel holds a Fast Open cookie of the server, the client message is sent with the connection request and the greeting arrives a round trip earlier. Without a client message or where <tt>TCP_FASTOPEN_CONNECT</tt> is not supported the option does nothing. A connection opened this way is not raced against the other addresses of the host, an unreachable address shows up as an error of the greeting.
 
-\return A number of the dictionary databases at the server or -1 on error.
+\param[in] self A DictClient instance.
+\param[in] fast_open \c TRUE to use TCP Fast Open. Default is \c FALSE.
 */
-glong
-dict_client_show_databases(
+void
+dict_client_set_fast_open(
 	DictClient *self,
-	GStrv *databases,
-	GStrv *descriptions,
-	GError **error )
+	gboolean fast_open )
 {
-	glong number;
-	GError *loc_error = NULL;
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	self->fast_open = fast_open;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_FAST_OPEN] );
+}
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return -1;
-	}
+/**
+\anchor dict_client_get_fast_open
+\brief Gets whether TCP Fast Open is used on connection.
 
-	number = send_receive_arrays( self->data_output, self->data_input, "SHOW DATABASES\r\n", databases, descriptions, &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return -1;
-	}
+\param[in] self A DictClient instance.
 
-	return number;
+\return \c TRUE if TCP Fast Open is used.
+*/
+gboolean
+dict_client_get_fast_open(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), FALSE );
+
+	return self->fast_open;
 }
 
 /**
-\anchor dict_client_show_strategies
-\brief Recieves an array of the search strategies supported by the server.
+\anchor dict_client_set_fan_out
+\brief Sets a number of connections a lookup in all databases is split over.
 
-\param[in] self A \c DictClient instance.
-\param[out] strategies If not NULL, holds an array of strategy names.
-\param[out] descriptions If not NULL, holds an array of strategy descriptions.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+\ref dict_client_define "dict_client_define()" and \ref dict_client_define_foreach "dict_client_define_foreach()" with the \c "*" database send one <tt>DEFINE</tt> per database of the server through that many extra connections at once, so the lookup takes as long as the slowest database instead of all of them one after another. Definitions are returned in the order of \ref dict_client_show_databases "dict_client_show_databases()", which is the order the server searches them in. The list of databases is asked once per connection. If any part of the lookup fails, the server is asked for \c "*" as usual. Only clients connected by a host and a port split lookups, the extra connections do not greet the server with the client message and are not logged as slow requests. Changing the number closes the extra connections.
 
-\return A number of strategies the server can use or -1 on error.
+\param[in] self A DictClient instance.
+\param[in] fan_out A number of connections, 0 disables splitting. Default is 0.
 */
-glong
-dict_client_show_strategies(
+void
+dict_client_set_fan_out(
 	DictClient *self,
-	GStrv *strategies,
-	GStrv *descriptions,
-	GError **error )
+	guint fan_out )
 {
-	glong number;
-	GError *loc_error = NULL;
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
+	self->fan_out = fan_out;
+	g_clear_object( &self->fan_engine );
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_FAN_OUT] );
+}
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return -1;
-	}
+/**
+\anchor dict_client_get_fan_out
+\brief Gets the number of connections a lookup in all databases is split over.
 
-	number = send_receive_arrays( self->data_output, self->data_input, "SHOW STRATEGIES\r\n", strategies, descriptions, &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return -1;
-	}
+\param[in] self A DictClient instance.
 
-	return number;
+\return A number of connections, 0 if lookups are not split.
+*/
+guint
+dict_client_get_fan_out(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
+
+	return self->fan_out;
 }
 
 /**
-\anchor dict_client_show_info
-\brief Recieves the source, copyright and licensing information about the specified database in free form.
+\anchor dict_client_set_suggest_strategy
+\brief Sets a strategy of the suggestions for words which are not found.
 
-\param[in] self A \c DictClient instance.
-\param[in] database Name of the database.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+\ref dict_client_define "dict_client_define()" and \ref dict_client_define_foreach "dict_client_define_foreach()" send a <tt>MATCH</tt> of the word with this strategy right behind the <tt>DEFINE</tt>, so the suggestions for a misspelled word come without another round trip. If the word is found, the response to the <tt>MATCH</tt> is skipped before the next command. The suggestions are returned by \ref dict_client_get_suggestions "dict_client_get_suggestions()". Words found in the cache, excluded by a headword filter or looked up by a fan-out get no suggestions.
 
-\return A newly allocated string or NULL on error.
+\param[in] self A DictClient instance.
+\param[in] strategy A strategy, usually \c "lev", or NULL to disable suggestions. Default is NULL.
 */
-gchar*
-dict_client_show_info(
+void
+dict_client_set_suggest_strategy(
 	DictClient *self,
-	const gchar *database,
-	GError **error )
+	const gchar *strategy )
 {
-	gchar *command, *text;
-	GError *loc_error = NULL;
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
-	g_return_val_if_fail( database != NULL, NULL );
+	g_free( self->suggest_strategy );
+	self->suggest_strategy = g_strdup( strategy );
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_SUGGEST_STRATEGY] );
+}
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return NULL;
-	}
+/**
+\anchor dict_client_get_suggest_strategy
+\brief Gets the strategy of the suggestions for words which are not found.
 
-	command = g_strdup_printf( "SHOW INFO \"%s\"\r\n", database );
-	text = send_receive_information( self->data_output, self->data_input, command, &loc_error );
-	g_free( command );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return NULL;
-	}
+\param[in] self A DictClient instance.
 
-	return text;
+\return A newly allocated string or NULL if suggestions are disabled.
+*/
+gchar*
+dict_client_get_suggest_strategy(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+
+	return g_strdup( self->suggest_strategy );
 }
 
 /**
-\anchor dict_client_show_server
-\brief Recieves a server information written by the administrator in free form.
+\anchor dict_client_get_suggestions
+\brief Gets the suggestions received for the word of the last lookup.
+
+See \ref dict_client_set_suggest_strategy "dict_client_set_suggest_strategy()". The arrays are the same as those of \ref dict_client_match "dict_client_match()".
 
 \param[in] self A DictClient instance.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+\param[out] databases If not NULL, holds a newly allocated array of the databases holding the \c words.
+\param[out] words If not NULL, holds a newly allocated array of the suggested words.
 
-\return A newly allocated string or NULL on error.
+\return A number of the suggested database-word pairs or -1 if the last lookup received no suggestions, because the word was found or the server was not asked.
 */
-gchar*
-dict_client_show_server(
+glong
+dict_client_get_suggestions(
 	DictClient *self,
-	GError **error )
+	GStrv *databases,
+	GStrv *words )
 {
-	gchar *text;
-	GError *loc_error = NULL;
-
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), -1 );
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return NULL;
-	}
+	if( databases != NULL )
+		*databases = g_strdupv( self->suggest_databases );
+	if( words != NULL )
+		*words = g_strdupv( self->suggest_words );
 
-	text = send_receive_information( self->data_output, self->data_input, "SHOW SERVER\r\n", &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return NULL;
-	}
+	return self->suggest_number;
+}
 
-	return text;
+/**
+\anchor dict_client_clear_resolver_cache
+\brief Forgets all cached host addresses.
+*/
+void
+dict_client_clear_resolver_cache(
+	void )
+{
+	G_LOCK( resolver_cache );
+	if( resolver_cache != NULL )
+		g_hash_table_remove_all( resolver_cache );
+	G_UNLOCK( resolver_cache );
 }
 
 /**
-\anchor dict_client_status
-\brief Recieves some server-specific timing and debugging information about the server in free form.
+\anchor dict_client_set_cache_size
+\brief Sets a number of looked up words whose definitions are kept.
 
-\param[in] self A DictClient instance.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+\ref dict_client_define "dict_client_define()" returns kept definitions without asking the server. The least recently used words are forgotten first. The cache is cleared on disconnection.
 
-\return A newly allocated string or NULL on error.
+\param[in] self A DictClient instance.
+\param[in] size A number of words, 0 disables the cache and prefetching. Default is 0.
 */
-gchar*
-dict_client_status(
+void
+dict_client_set_cache_size(
 	DictClient *self,
-	GError **error )
+	guint size )
 {
-	DictResponse resp;
-	gchar *text;
-	GError *loc_error = NULL;
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+	self->cache_size = size;
+	cache_trim( self, size );
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_CACHE_SIZE] );
+}
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return NULL;
-	}
+/**
+\anchor dict_client_get_cache_size
+\brief Get the number of looked up words whose definitions are kept.
 
-	send_command( self->data_output, "STATUS\r\n", &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return NULL;
-	}
+\param[in] self A DictClient instance.
 
-	/* status response is a simple line */
-	resp = (DictResponse){NULL,};
-	resp.message = &text;
-	receive_response( self->data_input, &resp, &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return NULL;
-	}
+\return A number of words.
+*/
+guint
+dict_client_get_cache_size(
+	DictClient *self )
+{
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
 
-	return text;
+	return self->cache_size;
 }
 
 /**
-\anchor dict_client_help
-\brief Recieves a short summary of commands that are understood by the server.
+\anchor dict_client_clear_cache
+\brief Forgets all kept definitions.
 
 \param[in] self A DictClient instance.
-\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
-
-\return A newly allocated string or NULL on error.
 */
-gchar*
-dict_client_help(
-	DictClient *self,
-	GError **error )
+void
+dict_client_clear_cache(
+	DictClient *self )
 {
-	gchar *text;
-	GError *loc_error = NULL;
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
 
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+	cache_clear( self );
+}
 
-	if( !dict_client_is_connected( self ) )
-	{
-		g_set_error(
-			error,
-			DICT_CLIENT_ERROR,
-			DICT_CLIENT_ERROR_NO_CONNECTION,
-			"No connection" );
-		return NULL;
-	}
+/**
+\anchor dict_client_set_prefetch_budget
+\brief Sets a number of cross-referenced words prefetched after a lookup.
 
-	text = send_receive_information( self->data_output, self->data_input, "HELP\r\n", &loc_error );
-	if( loc_error != NULL )
-	{
-		g_propagate_error( error, loc_error );
-		return NULL;
-	}
+After \ref dict_client_define "dict_client_define()" returns, words in braces of the definitions are requested from the same database. They are sent at the low priority through an extra connection, so the lookups of the caller never wait for them. Responses which have come are put into the cache at the next lookup, so a following lookup of them costs no round trip. Words already kept or certainly absent by the headword filter are not requested. Only clients connected by a host and a port prefetch, the extra connection does not greet the server with the client message.
 
-	return text;
+\param[in] self A DictClient instance.
+\param[in] budget A number of words per lookup, 0 disables prefetching. Default is 0.
+*/
+void
+dict_client_set_prefetch_budget(
+	DictClient *self,
+	guint budget )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+
+	self->prefetch_budget = budget;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_PREFETCH_BUDGET] );
 }
 
 /**
-\anchor dict_client_get_host
-\brief Get the host name.
+\anchor dict_client_get_prefetch_budget
+\brief Get the number of cross-referenced words prefetched after a lookup.
 
 \param[in] self A DictClient instance.
 
-\return A newly allocated string or NULL on error.
+\return A number of words.
 */
-gchar*
-dict_client_get_host(
+guint
+dict_client_get_prefetch_budget(
 	DictClient *self )
 {
-	g_return_val_if_fail( DICT_IS_CLIENT( self ), NULL );
+	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
 
-	return g_strdup( self->host );
+	return self->prefetch_budget;
 }
 
 /**
-\anchor dict_client_get_port
-\brief Get the port number.
+\anchor dict_client_set_prefetch_depth
+\brief Sets a number of cross-reference levels followed by prefetching.
+
+With depth 1 only words referenced by the looked up definitions are prefetched, with depth 2 also words referenced by the prefetched definitions and so on, while the budget lasts.
 
 \param[in] self A DictClient instance.
+\param[in] depth A number of levels, at least 1. Default is 1.
+*/
+void
+dict_client_set_prefetch_depth(
+	DictClient *self,
+	guint depth )
+{
+	g_return_if_fail( DICT_IS_CLIENT( self ) );
+	g_return_if_fail( depth > 0 );
 
-\return An guint16 port number.
+	self->prefetch_depth = depth;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_PREFETCH_DEPTH] );
+}
+
+/**
+\anchor dict_client_get_prefetch_depth
+\brief Get the number of cross-reference levels followed by prefetching.
+
+\param[in] self A DictClient instance.
+
+\return A number of levels.
 */
-guint16
-dict_client_get_port(
+guint
+dict_client_get_prefetch_depth(
 	DictClient *self )
 {
 	g_return_val_if_fail( DICT_IS_CLIENT( self ), 0 );
 
-	return self->port;
+	return self->prefetch_depth;
 }
-
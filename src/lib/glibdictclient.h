@@ -26,6 +26,7 @@ g_object_unref( G_OBJECT( dict_client ) );
 #ifndef GLIB_DICT_CLIENT_H
 #define GLIB_DICT_CLIENT_H
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 
@@ -53,6 +54,9 @@ enum _DictClientError
 	DICT_CLIENT_ERROR_NO_CONNECTION = 601, /**< No connection. */
 	DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE = 700, /**< Unknown response code. */
 	DICT_CLIENT_ERROR_CAN_NOT_RECOGNIZE_TEXT = 800, /**< Can not recognize text. */
+	DICT_CLIENT_ERROR_TEXT_TOO_LONG = 801, /**< Text is longer than the limit, see \ref dict_client_set_text_limit "dict_client_set_text_limit()". */
+	DICT_CLIENT_ERROR_INVALID_FILTER = 900, /**< Invalid headword filter. */
+	DICT_CLIENT_ERROR_NO_FILTER = 901, /**< No headword filter for the database. */
 
 	N_DICT_CLIENT_ERROR
 };
@@ -68,20 +72,76 @@ GQuark dict_client_error_quark( void );
 #define G_TYPE_DICT_CLIENT ( dict_client_get_type() )
 G_DECLARE_FINAL_TYPE( DictClient, dict_client, DICT, CLIENT, GObject )
 
+/**
+\typedef DictClientDefinitionFunc
+\brief Receives a definition found by \ref dict_client_define_foreach "dict_client_define_foreach()".
+
+Arguments are the items of the arrays returned by \ref dict_client_define "dict_client_define()", \c length is the length of \c definition in bytes. The strings are owned by the client. A definition longer than the text limit is passed as a mapped temporary file, it is still terminated by a zero byte.
+*/
+typedef void (*DictClientDefinitionFunc)( DictClient *client, const gchar *word, const gchar *database, const gchar *description, const gchar *definition, gsize length, gpointer user_data );
+
+/**
+\typedef DictClientPairFunc
+\brief Receives a database-word pair found by \ref dict_client_match_foreach "dict_client_match_foreach()".
+
+The strings are owned by the client.
+*/
+typedef void (*DictClientPairFunc)( DictClient *client, const gchar *database, const gchar *word, gpointer user_data );
+
 DictClient* dict_client_new( void );
 gboolean dict_client_is_connected( DictClient *self );
+gboolean dict_client_error_is_connection( const GError *error );
 gboolean dict_client_connect( DictClient *self, const gchar *host, const guint16 port, const gchar *client_message, gchar **server_response, GError **error );
+gboolean dict_client_connect_stream( DictClient *self, GIOStream *stream, const gchar *client_message, gchar **server_response, GError **error );
+gboolean dict_client_connect_address( DictClient *self, GSocketAddress *address, const gchar *client_message, gchar **server_response, GError **error );
+gboolean dict_client_prewarm( DictClient *self, gchar **server_response, GError **error );
 gboolean dict_client_disconnect( DictClient *self, gchar **server_responce, GError **error );
 glong dict_client_define( DictClient *self, const gchar *database, const gchar *word, GStrv *words, GStrv *databases, GStrv *descriptions, GStrv *definitions, GError **error );
 glong dict_client_match( DictClient *self, const gchar *database, const gchar *strategy, const gchar *word, GStrv *databases, GStrv *words, GError **error );
+glong dict_client_define_foreach( DictClient *self, const gchar *database, const gchar *word, DictClientDefinitionFunc func, gpointer user_data, GError **error );
+glong dict_client_match_foreach( DictClient *self, const gchar *database, const gchar *strategy, const gchar *word, DictClientPairFunc func, gpointer user_data, GError **error );
 glong dict_client_show_databases( DictClient *self, GStrv *databases, GStrv *descriptions, GError **error );
 glong dict_client_show_strategies( DictClient *self, GStrv *strategies, GStrv *descriptions, GError **error );
 gchar* dict_client_show_info( DictClient *self, const gchar *database, GError **error );
+gssize dict_client_show_info_to_stream( DictClient *self, const gchar *database, GOutputStream *stream, GError **error );
 gchar* dict_client_show_server( DictClient *self, GError **error );
 gchar* dict_client_status( DictClient *self, GError **error );
 gchar* dict_client_help( DictClient *self, GError **error );
+gboolean dict_client_build_filter( DictClient *self, const gchar *database, const gchar *strategy, const gchar *word, GError **error );
+gboolean dict_client_build_filter_from_index( DictClient *self, const gchar *database, const gchar *index_path, GError **error );
+gboolean dict_client_load_filter( DictClient *self, const gchar *database, const gchar *path, GError **error );
+gboolean dict_client_save_filter( DictClient *self, const gchar *database, const gchar *path, GError **error );
+void dict_client_remove_filter( DictClient *self, const gchar *database );
 gchar* dict_client_get_host( DictClient *self );
 guint16 dict_client_get_port( DictClient *self );
+void dict_client_set_resolver_ttl( DictClient *self, guint ttl );
+guint dict_client_get_resolver_ttl( DictClient *self );
+void dict_client_set_connect_delay( DictClient *self, guint delay );
+guint dict_client_get_connect_delay( DictClient *self );
+void dict_client_clear_resolver_cache( void );
+void dict_client_set_cache_size( DictClient *self, guint size );
+guint dict_client_get_cache_size( DictClient *self );
+void dict_client_clear_cache( DictClient *self );
+void dict_client_set_prefetch_budget( DictClient *self, guint budget );
+guint dict_client_get_prefetch_budget( DictClient *self );
+void dict_client_set_prefetch_depth( DictClient *self, guint depth );
+guint dict_client_get_prefetch_depth( DictClient *self );
+void dict_client_set_slow_threshold( DictClient *self, guint threshold );
+guint dict_client_get_slow_threshold( DictClient *self );
+guint dict_client_get_request_id( DictClient *self );
+void dict_client_set_capture_file( DictClient *self, const gchar *filename );
+gchar* dict_client_get_capture_file( DictClient *self );
+void dict_client_set_text_limit( DictClient *self, guint limit );
+guint dict_client_get_text_limit( DictClient *self );
+void dict_client_set_lazy_connect( DictClient *self, gboolean lazy_connect );
+gboolean dict_client_get_lazy_connect( DictClient *self );
+void dict_client_set_fast_open( DictClient *self, gboolean fast_open );
+gboolean dict_client_get_fast_open( DictClient *self );
+void dict_client_set_fan_out( DictClient *self, guint fan_out );
+guint dict_client_get_fan_out( DictClient *self );
+void dict_client_set_suggest_strategy( DictClient *self, const gchar *strategy );
+gchar* dict_client_get_suggest_strategy( DictClient *self );
+glong dict_client_get_suggestions( DictClient *self, GStrv *databases, GStrv *words );
 
 G_END_DECLS
 
@@ -0,0 +1,700 @@
+#include <string.h>
+#include <glib.h>
+#include "glibdictdefinition.h"
+
+#define MAX_SENSE_NUMBER_LEN 3
+
+/* spans are offsets into the text, a text is indexed up to 4 GiB */
+struct _DictSpan
+{
+	guint32 start;
+	guint32 length;
+};
+typedef struct _DictSpan DictSpan;
+
+struct _DictSense
+{
+	guint32 start;
+	guint32 length;
+	/* index of the part of speech in effect, or -1 */
+	gint32 part_of_speech;
+};
+typedef struct _DictSense DictSense;
+
+struct _DictDefinition
+{
+	GObject parent_instance;
+
+	gchar *text;
+	gsize length;
+
+	/* releases the text, NULL if the text is borrowed */
+	GDestroyNotify text_notify;
+	gpointer text_data;
+
+	/* the index is built on the first access */
+	gboolean indexed;
+	GArray *senses;
+	GArray *parts_of_speech;
+	GArray *references;
+	DictSpan pronunciation;
+};
+typedef struct _DictDefinition DictDefinition;
+
+G_DEFINE_FINAL_TYPE( DictDefinition, dict_definition, G_TYPE_OBJECT )
+
+static const gchar *parts_of_speech[] =
+{
+	"n", "v", "a", "adj", "adv", "prep", "conj", "interj", "pron",
+	"noun", "verb", "adjective", "adverb",
+	NULL
+};
+
+static gboolean
+is_blank(
+	gchar c )
+{
+	return c == ' ' || c == '\t';
+}
+
+static const gchar*
+skip_blank(
+	const gchar *p,
+	const gchar *end )
+{
+	while( p < end && is_blank( *p ) )
+		++p;
+
+	return p;
+}
+
+/* returns the end of a part of speech token at p or NULL, "v. t." and "v. i." are single tokens */
+static const gchar*
+part_of_speech_end(
+	const gchar *p,
+	const gchar *end )
+{
+	const gchar *q = p, *r;
+	gsize len;
+	guint i;
+
+	while( q < end && g_ascii_islower( *q ) )
+		++q;
+	len = q - p;
+	if( len == 0 )
+		return NULL;
+
+	for( i = 0; parts_of_speech[i] != NULL; ++i )
+		if( strlen( parts_of_speech[i] ) == len && strncmp( parts_of_speech[i], p, len ) == 0 )
+			break;
+	if( parts_of_speech[i] == NULL )
+		return NULL;
+
+	if( q < end && *q == '.' )
+	{
+		++q;
+		r = skip_blank( q, end );
+		if( *p == 'v' && len == 1 && end - r >= 2 && ( r[0] == 't' || r[0] == 'i' ) && r[1] == '.' )
+			q = r + 2;
+	}
+
+	/* a part of speech is a whole word */
+	if( q < end && ( g_ascii_isalnum( *q ) || *q == '-' ) )
+		return NULL;
+
+	return q;
+}
+
+/*
+Recognizes a sense marker at the beginning of a line: "1.", "1:", "n 1:" or "n :".
+Returns the beginning of the sense text or NULL, the part of speech is returned if there is one.
+*/
+static const gchar*
+parse_sense_marker(
+	const gchar *p,
+	const gchar *end,
+	const gchar **pos,
+	const gchar **pos_end )
+{
+	const gchar *q, *digits;
+
+	*pos = NULL;
+	*pos_end = NULL;
+
+	q = part_of_speech_end( p, end );
+	if( q != NULL && q < end && is_blank( *q ) )
+	{
+		*pos = p;
+		*pos_end = q;
+		p = skip_blank( q, end );
+	}
+	else if( q != NULL && q < end && *q == ':' )
+	{
+		*pos = p;
+		*pos_end = q;
+		p = q;
+	}
+
+	digits = p;
+	while( p < end && g_ascii_isdigit( *p ) && p - digits < MAX_SENSE_NUMBER_LEN )
+		++p;
+	if( p == digits && *pos == NULL )
+		return NULL;
+	if( p < end && g_ascii_isdigit( *p ) )
+		return NULL;
+
+	if( p >= end || ( *p != ':' && ( *p != '.' || p == digits ) ) )
+		return NULL;
+	++p;
+	if( p < end && !is_blank( *p ) )
+		return NULL;
+
+	return skip_blank( p, end );
+}
+
+static void
+append_span(
+	GArray *spans,
+	const gchar *text,
+	const gchar *start,
+	const gchar *end )
+{
+	DictSpan span;
+
+	span.start = start - text;
+	span.length = end - start;
+	g_array_append_val( spans, span );
+}
+
+/* finds the pronunciation and the part of speech in the first line */
+static void
+index_headline(
+	DictDefinition *self,
+	const gchar *p,
+	const gchar *end )
+{
+	const gchar *start = p, *open, *close = NULL, *q;
+	gchar delimiter;
+
+	/* pronunciation is enclosed in backslashes (GCIDE) or slashes (IPA) */
+	for( open = p; open < end; ++open )
+		if( *open == '\\' || *open == '/' )
+		{
+			delimiter = *open;
+			close = memchr( open + 1, delimiter, end - open - 1 );
+			if( close != NULL && close > open + 1 )
+				break;
+			close = NULL;
+		}
+
+	if( close != NULL )
+	{
+		self->pronunciation.start = open + 1 - self->text;
+		self->pronunciation.length = close - open - 1;
+		p = close + 1;
+	}
+	else
+	{
+		/* skip the headword */
+		while( p < end && !is_blank( *p ) )
+			++p;
+	}
+
+	/* the first part of speech before the etymology */
+	while( p < end && *p != '[' )
+	{
+		if( *p == '(' )
+		{
+			q = memchr( p, ')', end - p );
+			if( q == NULL )
+				break;
+			p = q + 1;
+			continue;
+		}
+
+		if( g_ascii_islower( *p ) && ( p == start || !g_ascii_isalnum( p[-1] ) ) )
+		{
+			q = part_of_speech_end( p, end );
+			if( q != NULL )
+			{
+				append_span( self->parts_of_speech, self->text, p, q );
+				return;
+			}
+		}
+		++p;
+	}
+}
+
+static void
+close_sense(
+	DictDefinition *self,
+	const gchar *end )
+{
+	DictSense *sense;
+
+	if( self->senses->len == 0 )
+		return;
+
+	sense = &g_array_index( self->senses, DictSense, self->senses->len - 1 );
+	if( self->text + sense->start < end )
+		sense->length = end - self->text - sense->start;
+}
+
+static void
+open_sense(
+	DictDefinition *self,
+	const gchar *start,
+	gint32 part_of_speech )
+{
+	DictSense sense;
+
+	sense.start = start - self->text;
+	sense.length = 0;
+	sense.part_of_speech = part_of_speech;
+	g_array_append_val( self->senses, sense );
+}
+
+/* builds the index in a single pass over the text */
+static void
+definition_index(
+	DictDefinition *self )
+{
+	const gchar *p, *end, *eol, *line_end, *s, *body, *pos, *pos_end;
+	const gchar *content_end = NULL, *first_body = NULL, *brace;
+	gboolean headline = TRUE;
+	gint32 part_of_speech = -1;
+
+	if( self->indexed )
+		return;
+	self->indexed = TRUE;
+
+	self->senses = g_array_new( FALSE, FALSE, sizeof( DictSense ) );
+	self->parts_of_speech = g_array_new( FALSE, FALSE, sizeof( DictSpan ) );
+	self->references = g_array_new( FALSE, FALSE, sizeof( DictSpan ) );
+
+	p = self->text;
+	end = self->text + MIN( self->length, G_MAXUINT32 );
+	while( p < end )
+	{
+		eol = memchr( p, '\n', end - p );
+		if( eol == NULL )
+			eol = end;
+
+		line_end = eol;
+		while( line_end > p && ( line_end[-1] == '\r' || is_blank( line_end[-1] ) ) )
+			--line_end;
+
+		s = skip_blank( p, line_end );
+		if( s < line_end )
+		{
+			body = parse_sense_marker( s, line_end, &pos, &pos_end );
+			if( body != NULL )
+			{
+				close_sense( self, content_end );
+				if( pos != NULL )
+				{
+					append_span( self->parts_of_speech, self->text, pos, pos_end );
+					part_of_speech = self->parts_of_speech->len - 1;
+				}
+				open_sense( self, body, part_of_speech );
+			}
+			else if( headline )
+			{
+				index_headline( self, s, line_end );
+				if( self->parts_of_speech->len > 0 )
+					part_of_speech = 0;
+			}
+			else if( first_body == NULL )
+				first_body = s;
+
+			headline = FALSE;
+			content_end = line_end;
+		}
+
+		/* cross-references may be broken across lines */
+		brace = memchr( p, '{', eol - p );
+		while( brace != NULL )
+		{
+			s = memchr( brace + 1, '}', end - brace - 1 );
+			if( s == NULL )
+				break;
+
+			/* an unbalanced brace is not a cross-reference */
+			body = memchr( brace + 1, '{', s - brace - 1 );
+			if( body != NULL )
+			{
+				brace = body < eol ? body : NULL;
+				continue;
+			}
+
+			append_span( self->references, self->text, brace + 1, s );
+			brace = s < eol ? memchr( s, '{', eol - s ) : NULL;
+		}
+
+		p = eol + 1;
+	}
+	close_sense( self, content_end );
+
+	/* without numbered senses the body is one sense */
+	if( self->senses->len == 0 && first_body != NULL )
+	{
+		open_sense( self, first_body, self->parts_of_speech->len > 0 ? 0 : -1 );
+		close_sense( self, content_end );
+	}
+}
+
+static void
+dict_definition_init(
+	DictDefinition *self )
+{
+	self->text = NULL;
+	self->length = 0;
+	self->text_notify = NULL;
+	self->text_data = NULL;
+	self->indexed = FALSE;
+	self->senses = NULL;
+	self->parts_of_speech = NULL;
+	self->references = NULL;
+	self->pronunciation.start = 0;
+	self->pronunciation.length = 0;
+}
+
+static void
+dict_definition_finalize(
+	GObject *object )
+{
+	DictDefinition *self = DICT_DEFINITION( object );
+
+	if( self->text_notify != NULL )
+		self->text_notify( self->text_data );
+	g_clear_pointer( &self->senses, g_array_unref );
+	g_clear_pointer( &self->parts_of_speech, g_array_unref );
+	g_clear_pointer( &self->references, g_array_unref );
+
+	G_OBJECT_CLASS( dict_definition_parent_class )->finalize( object );
+}
+
+static void
+dict_definition_class_init(
+	DictDefinitionClass *klass )
+{
+	GObjectClass *object_class = G_OBJECT_CLASS( klass );
+
+	object_class->finalize = dict_definition_finalize;
+}
+
+/**
+\anchor dict_definition_new
+\brief Creates a new DictDefinition instance from a copy of the text.
+
+Use <tt>g_object_unref()</tt> to decrease the reference count of the new instance to 0 and destroys the instance.
+
+\param[in] text Text of a definition.
+\param[in] length Length of the text in bytes, or -1 if the text is nul-terminated.
+
+\return New DictDefinition instance.
+*/
+DictDefinition*
+dict_definition_new(
+	const gchar *text,
+	gssize length )
+{
+	g_return_val_if_fail( text != NULL, NULL );
+
+	if( length < 0 )
+		length = strlen( text );
+
+	return dict_definition_new_take( g_strndup( text, length ) );
+}
+
+/**
+\anchor dict_definition_new_take
+\brief Creates a new DictDefinition instance that owns the text.
+
+Unlike \ref dict_definition_new "dict_definition_new()" the text is not copied, it is freed with the instance.
+
+\param[in] text Nul-terminated text of a definition, allocated by <tt>g_malloc()</tt>.
+
+\return New DictDefinition instance.
+*/
+DictDefinition*
+dict_definition_new_take(
+	gchar *text )
+{
+	g_return_val_if_fail( text != NULL, NULL );
+
+	return dict_definition_new_borrow( text, -1, g_free, text );
+}
+
+/**
+\anchor dict_definition_new_borrow
+\brief Creates a new DictDefinition instance over a text owned by the caller.
+
+The text is neither copied nor freed by the instance, it must stay valid until \c notify is called with \c user_data, which happens when the instance is destroyed. With \c notify NULL the text must outlive the instance.
+
+\param[in] text Text of a definition.
+\param[in] length Length of the text in bytes, or -1 if the text is nul-terminated. The text is not nul-terminated by the instance.
+\param[in] notify A function to release the text or NULL.
+\param[in] user_data Data passed to \c notify.
+
+\return New DictDefinition instance.
+*/
+DictDefinition*
+dict_definition_new_borrow(
+	const gchar *text,
+	gssize length,
+	GDestroyNotify notify,
+	gpointer user_data )
+{
+	DictDefinition *self;
+
+	g_return_val_if_fail( text != NULL, NULL );
+
+	self = DICT_DEFINITION( g_object_new( G_TYPE_DICT_DEFINITION, NULL ) );
+	self->text = (gchar*)text;
+	self->length = length < 0 ? strlen( text ) : (gsize)length;
+	self->text_notify = notify;
+	self->text_data = user_data;
+
+	return self;
+}
+
+/**
+\anchor dict_definition_get_text
+\brief Returns the whole text of the definition.
+
+\param[in] self A DictDefinition instance.
+
+\return Text of the instance, it is not nul-terminated only if the instance was made by \ref dict_definition_new_borrow "dict_definition_new_borrow()" with a length.
+*/
+const gchar*
+dict_definition_get_text(
+	DictDefinition *self )
+{
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+
+	return self->text;
+}
+
+/**
+\anchor dict_definition_get_n_senses
+\brief Returns number of senses.
+
+Senses are numbered lines like "1." or "n 1:". If there are no numbered lines, the text after the first line is a single sense.
+
+\param[in] self A DictDefinition instance.
+
+\return Number of senses.
+*/
+guint
+dict_definition_get_n_senses(
+	DictDefinition *self )
+{
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), 0 );
+
+	definition_index( self );
+
+	return self->senses->len;
+}
+
+/**
+\anchor dict_definition_get_sense
+\brief Returns text of a sense without its number.
+
+The returned text is not nul-terminated, it is a part of the definition.
+
+\param[in] self A DictDefinition instance.
+\param[in] n Index of the sense, starting from 0.
+\param[out] length Length of the sense in bytes.
+
+\return Pointer into the text owned by the instance, or \c NULL if there is no such sense.
+*/
+const gchar*
+dict_definition_get_sense(
+	DictDefinition *self,
+	guint n,
+	gsize *length )
+{
+	DictSense *sense;
+
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+	g_return_val_if_fail( length != NULL, NULL );
+
+	definition_index( self );
+	if( n >= self->senses->len )
+		return NULL;
+
+	sense = &g_array_index( self->senses, DictSense, n );
+	*length = sense->length;
+
+	return self->text + sense->start;
+}
+
+/**
+\anchor dict_definition_get_part_of_speech
+\brief Returns part of speech of a sense.
+
+The part of speech is given before the sense number ("n 1:") or in the first line ("n.") and holds for the following senses. The returned text is not nul-terminated.
+
+\param[in] self A DictDefinition instance.
+\param[in] n Index of the sense, starting from 0.
+\param[out] length Length of the part of speech in bytes.
+
+\return Pointer into the text owned by the instance, or \c NULL if it is unknown.
+*/
+const gchar*
+dict_definition_get_part_of_speech(
+	DictDefinition *self,
+	guint n,
+	gsize *length )
+{
+	DictSense *sense;
+	DictSpan *span;
+
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+	g_return_val_if_fail( length != NULL, NULL );
+
+	definition_index( self );
+	if( n >= self->senses->len )
+		return NULL;
+
+	sense = &g_array_index( self->senses, DictSense, n );
+	if( sense->part_of_speech < 0 )
+		return NULL;
+
+	span = &g_array_index( self->parts_of_speech, DictSpan, sense->part_of_speech );
+	*length = span->length;
+
+	return self->text + span->start;
+}
+
+/**
+\anchor dict_definition_get_pronunciation
+\brief Returns pronunciation of the headword.
+
+Pronunciation is looked for between backslashes or slashes in the first line. The returned text is not nul-terminated.
+
+\param[in] self A DictDefinition instance.
+\param[out] length Length of the pronunciation in bytes.
+
+\return Pointer into the text owned by the instance, or \c NULL if there is no pronunciation.
+*/
+const gchar*
+dict_definition_get_pronunciation(
+	DictDefinition *self,
+	gsize *length )
+{
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+	g_return_val_if_fail( length != NULL, NULL );
+
+	definition_index( self );
+	if( self->pronunciation.length == 0 )
+		return NULL;
+
+	*length = self->pronunciation.length;
+
+	return self->text + self->pronunciation.start;
+}
+
+/**
+\anchor dict_definition_get_n_references
+\brief Returns number of cross-references.
+
+Cross-references are words enclosed in braces, like "{canine}".
+
+\param[in] self A DictDefinition instance.
+
+\return Number of cross-references.
+*/
+guint
+dict_definition_get_n_references(
+	DictDefinition *self )
+{
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), 0 );
+
+	definition_index( self );
+
+	return self->references->len;
+}
+
+/**
+\anchor dict_definition_get_reference
+\brief Returns a cross-reference without braces.
+
+The returned text is not nul-terminated and may contain line breaks.
+
+\param[in] self A DictDefinition instance.
+\param[in] n Index of the cross-reference, starting from 0.
+\param[out] length Length of the cross-reference in bytes.
+
+\return Pointer into the text owned by the instance, or \c NULL if there is no such cross-reference.
+*/
+const gchar*
+dict_definition_get_reference(
+	DictDefinition *self,
+	guint n,
+	gsize *length )
+{
+	DictSpan *span;
+
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+	g_return_val_if_fail( length != NULL, NULL );
+
+	definition_index( self );
+	if( n >= self->references->len )
+		return NULL;
+
+	span = &g_array_index( self->references, DictSpan, n );
+	*length = span->length;
+
+	return self->text + span->start;
+}
+
+/**
+\anchor dict_definition_dup_references
+\brief Returns copies of all cross-references.
+
+Line breaks and runs of spaces inside a cross-reference are replaced by a single space. Use <tt>g_strfreev()</tt> to free the array.
+
+\param[in] self A DictDefinition instance.
+
+\return Array of cross-references, or \c NULL if there are none.
+*/
+GStrv
+dict_definition_dup_references(
+	DictDefinition *self )
+{
+	GStrv references;
+	DictSpan *span;
+	GString *reference;
+	const gchar *p, *end;
+	guint i;
+
+	g_return_val_if_fail( DICT_IS_DEFINITION( self ), NULL );
+
+	definition_index( self );
+	if( self->references->len == 0 )
+		return NULL;
+
+	references = g_new( gchar*, self->references->len + 1 );
+	for( i = 0; i < self->references->len; ++i )
+	{
+		span = &g_array_index( self->references, DictSpan, i );
+		reference = g_string_sized_new( span->length );
+		end = self->text + span->start + span->length;
+		for( p = self->text + span->start; p < end; ++p )
+		{
+			if( g_ascii_isspace( *p ) )
+			{
+				if( reference->len > 0 && reference->str[reference->len - 1] != ' ' )
+					g_string_append_c( reference, ' ' );
+				continue;
+			}
+			g_string_append_c( reference, *p );
+		}
+		references[i] = g_string_free( reference, FALSE );
+	}
+	references[i] = NULL;
+
+	return references;
+}
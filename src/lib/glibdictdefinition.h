@@ -0,0 +1,53 @@
+/**
+\file
+\author leonadkr@gmail.com
+\brief Header for DictDefinition class
+
+DictDefinition wraps the text of a definition returned by \ref dict_client_define "dict_client_define()". Senses, parts of speech, pronunciation and cross-references are found on the first access and kept as offsets into the text, the text itself is never copied.
+
+Typical use of this class, the text is borrowed from the array, so the array is freed after the instance:
+\code
+DictDefinition *dict_definition;
+const gchar *sense;
+gsize length;
+guint i;
+
+dict_definition = dict_definition_new_borrow( definitions[0], -1, NULL, NULL );
+
+for( i = 0; i < dict_definition_get_n_senses( dict_definition ); ++i )
+{
+	sense = dict_definition_get_sense( dict_definition, i, &length );
+	g_print( "%u. %.*s\n", i + 1, (gint)length, sense );
+}
+
+g_object_unref( G_OBJECT( dict_definition ) );
+g_strfreev( definitions );
+\endcode
+*/
+
+#ifndef GLIB_DICT_DEFINITION_H
+#define GLIB_DICT_DEFINITION_H
+
+#include <glib-object.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define G_TYPE_DICT_DEFINITION ( dict_definition_get_type() )
+G_DECLARE_FINAL_TYPE( DictDefinition, dict_definition, DICT, DEFINITION, GObject )
+
+DictDefinition* dict_definition_new( const gchar *text, gssize length );
+DictDefinition* dict_definition_new_take( gchar *text );
+DictDefinition* dict_definition_new_borrow( const gchar *text, gssize length, GDestroyNotify notify, gpointer user_data );
+const gchar* dict_definition_get_text( DictDefinition *self );
+guint dict_definition_get_n_senses( DictDefinition *self );
+const gchar* dict_definition_get_sense( DictDefinition *self, guint n, gsize *length );
+const gchar* dict_definition_get_part_of_speech( DictDefinition *self, guint n, gsize *length );
+const gchar* dict_definition_get_pronunciation( DictDefinition *self, gsize *length );
+guint dict_definition_get_n_references( DictDefinition *self );
+const gchar* dict_definition_get_reference( DictDefinition *self, guint n, gsize *length );
+GStrv dict_definition_dup_references( DictDefinition *self );
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,2095 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+#include "glibdictengine.h"
+#include "glibdictprobes.h"
+#include "glibdictprotocol.h"
+
+#define DEFAULT_RECEIVE_LEN 16384
+#define DEFAULT_COMMAND_LEN 1024
+#define DEFAULT_COMPACT_LEN 65536
+#define DEFAULT_RECEIVE_LIMIT 262144
+#define MAX_EVENTS 64
+
+#define DEFAULT_PROBE_INTERVAL 5000
+/* weight of a new sample in the average latency */
+#define LATENCY_WEIGHT 0.2
+
+/* recent response times kept to find the hedging threshold */
+#define LATENCY_SAMPLES 256
+#define MIN_HEDGE_SAMPLES 32
+
+enum _DictRequestType
+{
+	REQUEST_DEFINE,
+	REQUEST_MATCH,
+	/* health probe, it has no callback and is not counted as pending */
+	REQUEST_STATUS
+};
+typedef enum _DictRequestType DictRequestType;
+
+/* what is expected next in the response */
+enum _DictReplyState
+{
+	REPLY_STATUS,
+	REPLY_DEFINITION,
+	REPLY_LIST
+};
+typedef enum _DictReplyState DictReplyState;
+
+enum _DictConnectionState
+{
+	CONNECTION_CLOSED,
+	CONNECTION_CONNECTING,
+	CONNECTION_BANNER,
+	CONNECTION_READY
+};
+typedef enum _DictConnectionState DictConnectionState;
+
+struct _DictRequest
+{
+	DictRequestType type;
+	gchar *database;
+	gchar *strategy;
+	gchar *word;
+	GCallback callback;
+	gpointer user_data;
+	DictEnginePriority priority;
+
+	/* set when the request is sent */
+	struct _DictServer *server;
+	gint64 sent;
+
+	/* a hedged request and its duplicate refer to each other, the one finishing last is an orphan */
+	struct _DictRequest *twin;
+	gboolean hedged;
+	gboolean orphan;
+
+	DictReplyState state;
+	glong number;
+	GPtrArray *words;
+	GPtrArray *databases;
+	GPtrArray *descriptions;
+	GPtrArray *definitions;
+	GStrv data;
+	GStrv desc;
+};
+typedef struct _DictRequest DictRequest;
+
+struct _DictServer
+{
+	gchar *host;
+	guint16 port;
+	GList *addresses;
+
+	/* connections of the server, owned by the engine */
+	GPtrArray *connections;
+
+	/* average response time in microseconds, 0 if unknown */
+	gdouble latency;
+	guint inflight;
+	gboolean down;
+
+	gint64 probed;
+	gboolean probing;
+	gboolean has_status;
+	DictStatus status;
+};
+typedef struct _DictServer DictServer;
+
+struct _DictConnection
+{
+	DictEngine *engine;
+	DictServer *server;
+	DictConnectionState state;
+	GSocket *socket;
+	GList *address;
+	GIOCondition events;
+
+	GByteArray *input;
+	gsize input_start;
+	/* the most bytes held since the last empty buffer and since the buffer was allocated */
+	gsize input_fill;
+	gsize input_capacity;
+	/* decaying average of input_fill, the buffer is shrunk to it */
+	gsize input_typical;
+	GString *output;
+	gsize output_sent;
+	DictTextScanner scanner;
+
+	/* requests sent and waiting for responses, in order */
+	GQueue requests;
+};
+typedef struct _DictConnection DictConnection;
+
+struct _DictEngine
+{
+	GObject parent_instance;
+
+#ifdef HAVE_SYS_EPOLL_H
+	gint epoll_fd;
+#endif
+	GPtrArray *servers;
+	GPtrArray *connections;
+	guint pipeline_depth;
+	guint probe_interval;
+	guint receive_limit;
+
+	gdouble hedge_percentile;
+	gint64 samples[LATENCY_SAMPLES];
+	guint n_samples;
+	guint next_sample;
+	gint64 hedge_threshold;
+	gboolean samples_changed;
+
+	/* requests waiting for a free connection by priority, the higher ones are sent first */
+	GQueue queue[N_DICT_ENGINE_PRIORITY];
+	guint pending;
+
+	/* connections kept free for every class and requests of every class in flight */
+	guint reserved[N_DICT_ENGINE_PRIORITY];
+	guint inflight[N_DICT_ENGINE_PRIORITY];
+};
+typedef struct _DictEngine DictEngine;
+
+G_DEFINE_FINAL_TYPE( DictEngine, dict_engine, G_TYPE_OBJECT )
+
+enum _DictEnginePropertyID
+{
+	PROP_0, /* 0 is reserved for GObject */
+
+	PROP_PIPELINE_DEPTH,
+	PROP_PROBE_INTERVAL,
+	PROP_HEDGE_PERCENTILE,
+	PROP_RECEIVE_LIMIT,
+	PROP_HIGH_RESERVED,
+	PROP_LOW_RESERVED,
+
+	N_PROPS
+};
+typedef enum _DictEnginePropertyID DictEnginePropertyID;
+
+static GParamSpec *object_props[N_PROPS] = { NULL, };
+
+static void
+request_free(
+	DictRequest *request )
+{
+	g_free( request->database );
+	g_free( request->strategy );
+	g_free( request->word );
+	g_clear_pointer( &request->words, g_ptr_array_unref );
+	g_clear_pointer( &request->databases, g_ptr_array_unref );
+	g_clear_pointer( &request->descriptions, g_ptr_array_unref );
+	g_clear_pointer( &request->definitions, g_ptr_array_unref );
+	g_strfreev( request->data );
+	g_strfreev( request->desc );
+	g_free( request );
+}
+
+static GStrv
+steal_strv(
+	GPtrArray **array )
+{
+	GPtrArray *a = *array;
+
+	*array = NULL;
+	if( a->len == 0 )
+	{
+		g_ptr_array_unref( a );
+		return NULL;
+	}
+
+	g_ptr_array_set_free_func( a, NULL );
+	g_ptr_array_add( a, NULL );
+
+	return (GStrv)g_ptr_array_free( a, FALSE );
+}
+
+/* takes a response time into the average latency */
+static void
+server_observe(
+	DictServer *server,
+	gint64 latency )
+{
+	if( server->latency == 0 )
+		server->latency = latency;
+	else
+		server->latency += LATENCY_WEIGHT * ( latency - server->latency );
+
+	server->down = FALSE;
+}
+
+/* remembers a response time for the hedging threshold */
+static void
+engine_sample(
+	DictEngine *self,
+	gint64 latency )
+{
+	self->samples[self->next_sample] = latency;
+	self->next_sample = ( self->next_sample + 1 ) % LATENCY_SAMPLES;
+	if( self->n_samples < LATENCY_SAMPLES )
+		self->n_samples++;
+	self->samples_changed = TRUE;
+}
+
+/* hands the result to the callback and frees the request */
+static void
+request_complete(
+	DictEngine *self,
+	DictRequest *request,
+	const GError *error )
+{
+	DictServer *server = request->server;
+	GStrv words, databases, descriptions, definitions, data, desc;
+	gboolean responded;
+	glong number;
+
+	/* a refusal of the server is still a response */
+	responded = error == NULL || ( error->domain == DICT_CLIENT_ERROR && error->code < DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS );
+
+	if( server != NULL )
+	{
+		server->inflight--;
+		if( request->type != REQUEST_STATUS )
+			self->inflight[request->priority]--;
+
+		if( responded )
+			server_observe( server, g_get_monotonic_time() - request->sent );
+		else
+			server->down = TRUE;
+	}
+
+	if( responded && server != NULL && request->type != REQUEST_STATUS )
+		engine_sample( self, g_get_monotonic_time() - request->sent );
+
+	/* the twin has answered already, this response is only drained */
+	if( request->orphan )
+	{
+		request_free( request );
+		return;
+	}
+
+	if( request->twin != NULL )
+	{
+		/* the twin may still answer */
+		if( !responded )
+		{
+			request->twin->twin = NULL;
+			request_free( request );
+			return;
+		}
+
+		request->twin->orphan = TRUE;
+		request->twin->twin = NULL;
+	}
+
+	if( request->type != REQUEST_STATUS )
+		self->pending--;
+
+	switch( request->type )
+	{
+		case REQUEST_DEFINE:
+			if( error != NULL )
+			{
+				( (DictEngineDefineFunc)request->callback )( self, -1, NULL, NULL, NULL, NULL, error, request->user_data );
+				break;
+			}
+
+			number = request->definitions->len;
+			words = steal_strv( &request->words );
+			databases = steal_strv( &request->databases );
+			descriptions = steal_strv( &request->descriptions );
+			definitions = steal_strv( &request->definitions );
+			( (DictEngineDefineFunc)request->callback )( self, number, words, databases, descriptions, definitions, NULL, request->user_data );
+			break;
+
+		case REQUEST_MATCH:
+			if( error != NULL )
+			{
+				( (DictEngineMatchFunc)request->callback )( self, -1, NULL, NULL, error, request->user_data );
+				break;
+			}
+
+			data = g_steal_pointer( &request->data );
+			desc = g_steal_pointer( &request->desc );
+			( (DictEngineMatchFunc)request->callback )( self, data != NULL ? request->number : 0, data, desc, NULL, request->user_data );
+			break;
+
+		case REQUEST_STATUS:
+			if( server != NULL )
+				server->probing = FALSE;
+			break;
+	}
+
+	request_free( request );
+}
+
+static DictRequest*
+request_new(
+	DictRequestType type,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	DictEnginePriority priority,
+	GCallback callback,
+	gpointer user_data )
+{
+	DictRequest *request;
+
+	request = g_new0( DictRequest, 1 );
+	request->type = type;
+	request->database = g_strdup( database );
+	request->strategy = g_strdup( strategy );
+	request->word = g_strdup( word );
+	request->priority = priority;
+	request->callback = callback;
+	request->user_data = user_data;
+	request->state = REPLY_STATUS;
+
+	if( type == REQUEST_DEFINE )
+	{
+		request->words = g_ptr_array_new_with_free_func( g_free );
+		request->databases = g_ptr_array_new_with_free_func( g_free );
+		request->descriptions = g_ptr_array_new_with_free_func( g_free );
+		request->definitions = g_ptr_array_new_with_free_func( g_free );
+	}
+
+	return request;
+}
+
+static void
+request_build_command(
+	DictRequest *request,
+	GString *command )
+{
+	switch( request->type )
+	{
+		case REQUEST_DEFINE:
+			command_begin( command, "DEFINE" );
+			command_append_string( command, request->database );
+			command_append_string( command, request->word );
+			command_end( command );
+			break;
+
+		case REQUEST_MATCH:
+			command_begin( command, "MATCH" );
+			command_append_string( command, request->database );
+			command_append_string( command, request->strategy );
+			command_append_string( command, request->word );
+			command_end( command );
+			break;
+
+		case REQUEST_STATUS:
+			command_begin( command, "STATUS" );
+			command_end( command );
+			break;
+	}
+}
+
+static void
+server_free(
+	DictServer *server )
+{
+	g_free( server->host );
+	g_resolver_free_addresses( server->addresses );
+	g_ptr_array_unref( server->connections );
+	g_free( server );
+}
+
+static void
+engine_watch(
+	DictEngine *self,
+	DictConnection *connection,
+	GIOCondition events )
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event event;
+
+	if( events == connection->events )
+		return;
+
+	event.events = ( events & G_IO_IN ? EPOLLIN : 0 ) | ( events & G_IO_OUT ? EPOLLOUT : 0 );
+	event.data.ptr = connection;
+	if( connection->events == 0 )
+		epoll_ctl( self->epoll_fd, EPOLL_CTL_ADD, g_socket_get_fd( connection->socket ), &event );
+	else if( events == 0 )
+		epoll_ctl( self->epoll_fd, EPOLL_CTL_DEL, g_socket_get_fd( connection->socket ), &event );
+	else
+		epoll_ctl( self->epoll_fd, EPOLL_CTL_MOD, g_socket_get_fd( connection->socket ), &event );
+#endif
+
+	connection->events = events;
+}
+
+static void
+connection_update_watch(
+	DictConnection *connection )
+{
+	GIOCondition events;
+
+	switch( connection->state )
+	{
+		case CONNECTION_CONNECTING:
+			events = G_IO_OUT;
+			break;
+
+		case CONNECTION_BANNER:
+		case CONNECTION_READY:
+			events = G_IO_IN;
+			if( connection->output->len > connection->output_sent )
+				events |= G_IO_OUT;
+			break;
+
+		default:
+			events = 0;
+			break;
+	}
+
+	engine_watch( connection->engine, connection, events );
+}
+
+static void
+connection_close(
+	DictConnection *connection )
+{
+	if( connection->socket != NULL )
+	{
+		DICT_PROBE2( engine__close, connection->server->host, (size_t)g_queue_get_length( &connection->requests ) );
+		engine_watch( connection->engine, connection, 0 );
+		g_socket_close( connection->socket, NULL );
+		g_clear_object( &connection->socket );
+	}
+
+	g_byte_array_set_size( connection->input, 0 );
+	connection->input_start = 0;
+	g_string_truncate( connection->output, 0 );
+	connection->output_sent = 0;
+	text_scanner_clear( &connection->scanner );
+	connection->state = CONNECTION_CLOSED;
+}
+
+/* starts a non-blocking connect to the next address of the server */
+static gboolean
+connection_open(
+	DictConnection *connection,
+	GError **error )
+{
+	GInetAddress *address;
+	GSocketAddress *socket_address;
+	GSocket *socket;
+	GError *loc_error = NULL;
+
+	while( connection->address != NULL )
+	{
+		address = G_INET_ADDRESS( connection->address->data );
+		connection->address = connection->address->next;
+
+		socket = g_socket_new( g_inet_address_get_family( address ), G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, &loc_error );
+		if( loc_error != NULL )
+		{
+			g_clear_error( error );
+			g_propagate_error( error, loc_error );
+			loc_error = NULL;
+			continue;
+		}
+		g_socket_set_blocking( socket, FALSE );
+
+		DICT_PROBE2( engine__connect, connection->server->host, (unsigned)connection->server->port );
+		socket_address = g_inet_socket_address_new( address, connection->server->port );
+		g_socket_connect( socket, socket_address, NULL, &loc_error );
+		g_object_unref( socket_address );
+		if( loc_error != NULL && !g_error_matches( loc_error, G_IO_ERROR, G_IO_ERROR_PENDING ) )
+		{
+			g_object_unref( socket );
+			g_clear_error( error );
+			g_propagate_error( error, loc_error );
+			loc_error = NULL;
+			continue;
+		}
+		g_clear_error( &loc_error );
+		g_clear_error( error );
+
+		connection->socket = socket;
+		connection->state = CONNECTION_CONNECTING;
+		connection_update_watch( connection );
+
+		return TRUE;
+	}
+
+	connection->state = CONNECTION_CLOSED;
+
+	return FALSE;
+}
+
+/* fails all requests sent through the connection, a connection that was ready is reopened */
+static void
+connection_fail(
+	DictConnection *connection,
+	const GError *error )
+{
+	DictRequest *request;
+	gboolean reopen;
+
+	reopen = connection->state == CONNECTION_READY;
+	connection_close( connection );
+	connection->server->down = TRUE;
+
+	while( ( request = g_queue_pop_head( &connection->requests ) ) != NULL )
+		request_complete( connection->engine, request, error );
+
+	if( reopen )
+	{
+		connection->address = connection->server->addresses;
+		connection_open( connection, NULL );
+	}
+}
+
+/*
+A GByteArray keeps its memory when it is emptied, so one huge response would stay allocated for the life of the connection.
+When the buffer is empty and has grown well over the typical fill, it is allocated again at the typical size.
+*/
+static void
+connection_trim_input(
+	DictConnection *connection )
+{
+	gsize typical;
+
+	connection->input_typical = ( connection->input_typical * 7 + connection->input_fill ) / 8;
+	connection->input_fill = 0;
+
+	typical = MAX( connection->input_typical, DEFAULT_RECEIVE_LEN );
+	if( connection->input_capacity > 2 * typical + DEFAULT_RECEIVE_LEN )
+	{
+		DICT_PROBE2( buffer__shrink, (size_t)connection->input_capacity, (size_t)typical );
+		g_byte_array_unref( connection->input );
+		connection->input = g_byte_array_sized_new( typical );
+		connection->input_capacity = typical;
+	}
+}
+
+static void
+connection_consume(
+	DictConnection *connection,
+	gsize length )
+{
+	connection->input_start += length;
+
+	if( connection->input_start == connection->input->len )
+	{
+		g_byte_array_set_size( connection->input, 0 );
+		connection->input_start = 0;
+		connection_trim_input( connection );
+	}
+	else if( connection->input_start > DEFAULT_COMPACT_LEN && connection->input_start > connection->input->len / 2 )
+	{
+		g_byte_array_remove_range( connection->input, 0, connection->input_start );
+		connection->input_start = 0;
+	}
+}
+
+static void
+connection_send(
+	DictConnection *connection )
+{
+	gssize size;
+	GError *loc_error = NULL;
+
+	while( connection->output_sent < connection->output->len )
+	{
+		size = g_socket_send_with_blocking( connection->socket, connection->output->str + connection->output_sent, connection->output->len - connection->output_sent, FALSE, NULL, &loc_error );
+		if( loc_error != NULL )
+		{
+			if( g_error_matches( loc_error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK ) )
+			{
+				g_clear_error( &loc_error );
+				break;
+			}
+
+			connection_fail( connection, loc_error );
+			g_error_free( loc_error );
+			return;
+		}
+
+		DICT_PROBE3( engine__send, connection->output->str + connection->output_sent, (size_t)( connection->output->len - connection->output_sent ), (size_t)size );
+		connection->output_sent += size;
+	}
+
+	if( connection->output_sent == connection->output->len )
+	{
+		g_string_truncate( connection->output, 0 );
+		connection->output_sent = 0;
+	}
+
+	connection_update_watch( connection );
+}
+
+/* reads all available bytes, returns FALSE if the connection has failed */
+static gboolean
+connection_receive(
+	DictConnection *connection )
+{
+	guint length;
+	gssize size;
+	GError *loc_error = NULL;
+
+	/* the rest is read after the held bytes are parsed, the socket stays readable until then */
+	while( connection->input->len - connection->input_start < connection->engine->receive_limit )
+	{
+		length = connection->input->len;
+		g_byte_array_set_size( connection->input, length + DEFAULT_RECEIVE_LEN );
+
+		size = g_socket_receive_with_blocking( connection->socket, (gchar*)connection->input->data + length, DEFAULT_RECEIVE_LEN, FALSE, NULL, &loc_error );
+		if( loc_error != NULL )
+		{
+			g_byte_array_set_size( connection->input, length );
+			if( g_error_matches( loc_error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK ) )
+			{
+				g_clear_error( &loc_error );
+				return TRUE;
+			}
+
+			connection_fail( connection, loc_error );
+			g_error_free( loc_error );
+			return FALSE;
+		}
+		g_byte_array_set_size( connection->input, length + size );
+		connection->input_fill = MAX( connection->input_fill, connection->input->len );
+		connection->input_capacity = MAX( connection->input_capacity, connection->input->len + DEFAULT_RECEIVE_LEN );
+		DICT_PROBE1( engine__receive, (size_t)size );
+
+		/* the stream is over */
+		if( size == 0 )
+		{
+			g_set_error(
+				&loc_error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_NO_CONNECTION,
+				"Connection closed by server" );
+			connection_fail( connection, loc_error );
+			g_error_free( loc_error );
+			return FALSE;
+		}
+
+		if( size < DEFAULT_RECEIVE_LEN )
+			return TRUE;
+	}
+
+	return TRUE;
+}
+
+/* returns FALSE if the connection has failed */
+static gboolean
+connection_handle_status(
+	DictConnection *connection,
+	gchar *line )
+{
+	DictRequest *request;
+	DictResponse resp;
+	gchar *word, *database, *description, *message;
+	glong code, number;
+	GError *loc_error = NULL;
+
+	request = g_queue_peek_head( &connection->requests );
+
+	word = database = description = message = NULL;
+	number = 0;
+	resp = (DictResponse){NULL,};
+	resp.number = &number;
+	resp.message = &message;
+	resp.word = &word;
+	resp.database = &database;
+	resp.description = &description;
+	code = parse_response( line, &resp, &loc_error );
+	DICT_PROBE2( engine__status, (long)code, line );
+
+	if( g_error_matches( loc_error, DICT_CLIENT_ERROR, DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE ) )
+	{
+		/* the rest of the stream can not be trusted */
+		connection_fail( connection, loc_error );
+		g_error_free( loc_error );
+		return FALSE;
+	}
+
+	switch( code )
+	{
+		case 150:
+		case 152:
+			request->number = number;
+			if( code == 152 && request->type == REQUEST_MATCH )
+				request->state = REPLY_LIST;
+			break;
+
+		case 151:
+			if( request->type == REQUEST_DEFINE )
+			{
+				g_ptr_array_add( request->words, g_steal_pointer( &word ) );
+				g_ptr_array_add( request->databases, g_steal_pointer( &database ) );
+				g_ptr_array_add( request->descriptions, g_steal_pointer( &description ) );
+				request->state = REPLY_DEFINITION;
+			}
+			break;
+
+		/* the response is over */
+		default:
+			if( code == 210 && request->type == REQUEST_STATUS )
+				connection->server->has_status = parse_status( message, &connection->server->status );
+
+			g_queue_pop_head( &connection->requests );
+			request_complete( connection->engine, request, loc_error );
+			break;
+	}
+
+	g_free( word );
+	g_free( database );
+	g_free( description );
+	g_free( message );
+	g_clear_error( &loc_error );
+
+	return TRUE;
+}
+
+static void
+connection_handle_text(
+	DictConnection *connection,
+	gchar *text )
+{
+	DictRequest *request;
+
+	request = g_queue_peek_head( &connection->requests );
+
+	if( request->state == REPLY_DEFINITION )
+	{
+		g_ptr_array_add( request->definitions, text );
+	}
+	else
+	{
+		split_pairs( text, request->number, &request->data, &request->desc );
+		g_free( text );
+	}
+
+	request->state = REPLY_STATUS;
+}
+
+/* parses complete lines and texts received so far */
+static void
+connection_parse(
+	DictConnection *connection )
+{
+	DictRequest *request;
+	const gchar *buf, *eol;
+	gchar *line;
+	gsize length;
+	GError *loc_error = NULL;
+
+	while( connection->state == CONNECTION_BANNER || connection->state == CONNECTION_READY )
+	{
+		buf = (const gchar*)connection->input->data + connection->input_start;
+		length = connection->input->len - connection->input_start;
+
+		request = g_queue_peek_head( &connection->requests );
+		if( connection->state == CONNECTION_READY && request == NULL )
+			break;
+
+		if( connection->state == CONNECTION_BANNER || request->state == REPLY_STATUS )
+		{
+			eol = memchr( buf, '\n', length );
+			if( eol == NULL )
+				break;
+
+			line = g_strndup( buf, ( eol > buf && eol[-1] == '\r' ) ? eol - buf - 1 : eol - buf );
+			connection_consume( connection, eol - buf + 1 );
+
+			if( connection->state == CONNECTION_BANNER )
+			{
+				parse_response( line, NULL, &loc_error );
+				g_free( line );
+				if( loc_error != NULL )
+				{
+					connection_fail( connection, loc_error );
+					g_error_free( loc_error );
+					return;
+				}
+
+				connection->state = CONNECTION_READY;
+				continue;
+			}
+
+			if( !connection_handle_status( connection, line ) )
+			{
+				g_free( line );
+				return;
+			}
+			g_free( line );
+		}
+		else
+		{
+			/* scanned bytes are copied to the text, so they are dropped from the input at once */
+			if( !text_scanner_scan( &connection->scanner, buf, length ) )
+			{
+				connection_consume( connection, connection->scanner.offset );
+				connection->scanner.offset = 0;
+				break;
+			}
+
+			DICT_PROBE1( engine__text, (size_t)connection->scanner.offset );
+			connection_consume( connection, connection->scanner.offset );
+			connection_handle_text( connection, text_scanner_finish( &connection->scanner, NULL ) );
+		}
+	}
+}
+
+static void
+connection_process(
+	DictConnection *connection,
+	GIOCondition condition )
+{
+	GError *loc_error = NULL;
+
+	/* the connection has failed while processing other events */
+	if( connection->socket == NULL )
+		return;
+
+	if( connection->state == CONNECTION_CONNECTING )
+	{
+		if( !g_socket_check_connect_result( connection->socket, &loc_error ) )
+		{
+			/* try the next address of the server */
+			connection_close( connection );
+			if( !connection_open( connection, NULL ) )
+				connection_fail( connection, loc_error );
+			g_error_free( loc_error );
+			return;
+		}
+
+		connection->state = CONNECTION_BANNER;
+		connection_update_watch( connection );
+		return;
+	}
+
+	if( condition & ( G_IO_IN | G_IO_ERR | G_IO_HUP ) )
+	{
+		if( !connection_receive( connection ) )
+			return;
+
+		connection_parse( connection );
+
+		/* a status line over the limit or bytes nobody asked for, they can not be parsed */
+		if( connection->socket != NULL && connection->input->len - connection->input_start >= connection->engine->receive_limit )
+		{
+			g_set_error(
+				&loc_error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE,
+				"Response line is too long" );
+			connection_fail( connection, loc_error );
+			g_error_free( loc_error );
+			return;
+		}
+	}
+
+	if( ( condition & G_IO_OUT ) && connection->socket != NULL )
+		connection_send( connection );
+}
+
+static DictConnection*
+connection_new(
+	DictEngine *self,
+	DictServer *server )
+{
+	DictConnection *connection;
+
+	connection = g_new0( DictConnection, 1 );
+	connection->engine = self;
+	connection->server = server;
+	connection->state = CONNECTION_CLOSED;
+	connection->address = server->addresses;
+	connection->input = g_byte_array_sized_new( DEFAULT_RECEIVE_LEN );
+	connection->input_capacity = DEFAULT_RECEIVE_LEN;
+	connection->output = g_string_sized_new( DEFAULT_COMMAND_LEN );
+	text_scanner_init( &connection->scanner );
+	g_queue_init( &connection->requests );
+
+	return connection;
+}
+
+static void
+connection_free(
+	DictConnection *connection )
+{
+	connection_close( connection );
+	g_queue_clear_full( &connection->requests, (GDestroyNotify)request_free );
+	g_byte_array_unref( connection->input );
+	g_string_free( connection->output, TRUE );
+	g_free( connection );
+}
+
+/* returns the least loaded connection of the server that can take another request */
+static DictConnection*
+server_free_connection(
+	DictEngine *self,
+	DictServer *server,
+	DictConnection *exclude )
+{
+	DictConnection *connection, *best = NULL;
+	guint i;
+
+	for( i = 0; i < server->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( server->connections, i );
+		if( connection == exclude || connection->state != CONNECTION_READY || g_queue_get_length( &connection->requests ) >= self->pipeline_depth )
+			continue;
+
+		if( best == NULL || g_queue_get_length( &connection->requests ) < g_queue_get_length( &best->requests ) )
+			best = connection;
+	}
+
+	return best;
+}
+
+static gboolean
+server_is_alive(
+	DictServer *server )
+{
+	DictConnection *connection;
+	guint i;
+
+	for( i = 0; i < server->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( server->connections, i );
+		if( connection->state != CONNECTION_CLOSED )
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* expected time to serve one more request, lower is better */
+static gdouble
+server_score(
+	DictServer *server )
+{
+	return ( server->latency + 1 ) * ( server->inflight + 1 );
+}
+
+/*
+Chooses a connection for the next request by the power of two choices: two random servers with a free connection are compared by their latency and load.
+Servers marked down are used only if no other server is alive. The \c exclude connection is never chosen, its server only if no other server has a free connection.
+*/
+static DictConnection*
+engine_select(
+	DictEngine *self,
+	DictConnection *exclude )
+{
+	DictServer *server;
+	DictConnection **free_connections;
+	gboolean up_alive = FALSE;
+	guint i, n, a, b;
+
+	free_connections = g_newa( DictConnection*, self->servers->len );
+
+	for( i = 0; i < self->servers->len; ++i )
+	{
+		server = g_ptr_array_index( self->servers, i );
+		if( !server->down && server_is_alive( server ) )
+			up_alive = TRUE;
+	}
+
+	n = 0;
+	for( i = 0; i < self->servers->len; ++i )
+	{
+		server = g_ptr_array_index( self->servers, i );
+		if( ( up_alive && server->down ) || ( exclude != NULL && server == exclude->server ) )
+			continue;
+
+		free_connections[n] = server_free_connection( self, server, exclude );
+		if( free_connections[n] != NULL )
+			n++;
+	}
+
+	if( n == 0 && exclude != NULL )
+		return server_free_connection( self, exclude->server, exclude );
+	if( n == 0 )
+		return NULL;
+	if( n == 1 )
+		return free_connections[0];
+
+	a = g_random_int_range( 0, n );
+	b = g_random_int_range( 0, n - 1 );
+	if( b >= a )
+		b++;
+
+	if( server_score( free_connections[b]->server ) < server_score( free_connections[a]->server ) )
+		a = b;
+
+	return free_connections[a];
+}
+
+/* adds the request to the output of the connection, it is sent later */
+static void
+connection_push(
+	DictConnection *connection,
+	DictRequest *request )
+{
+	request_build_command( request, connection->output );
+	request->server = connection->server;
+	request->sent = g_get_monotonic_time();
+	request->server->inflight++;
+	if( request->type != REQUEST_STATUS )
+		connection->engine->inflight[request->priority]++;
+	g_queue_push_tail( &connection->requests, request );
+}
+
+/*
+A request of the class may take a free slot of a connection if the free slots left cover the reservations the other classes do not use.
+A slot is a place in the pipeline of a ready connection.
+*/
+static gboolean
+engine_admits(
+	DictEngine *self,
+	DictEnginePriority priority )
+{
+	DictConnection *connection;
+	guint i, length, free_slots = 0, held = 0, reserved;
+
+	for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+	{
+		reserved = self->reserved[i] * self->pipeline_depth;
+		if( i != priority && self->inflight[i] < reserved )
+			held += reserved - self->inflight[i];
+	}
+	if( held == 0 )
+		return TRUE;
+
+	for( i = 0; i < self->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( self->connections, i );
+		length = g_queue_get_length( &connection->requests );
+		if( connection->state == CONNECTION_READY && length < self->pipeline_depth )
+			free_slots += self->pipeline_depth - length;
+	}
+
+	return free_slots > held;
+}
+
+/* sends STATUS to servers not probed for the probe interval */
+static void
+engine_probe(
+	DictEngine *self )
+{
+	DictServer *server;
+	DictConnection *connection;
+	gint64 now, interval;
+	guint i, j;
+
+	if( self->probe_interval == 0 )
+		return;
+
+	now = g_get_monotonic_time();
+	interval = (gint64)self->probe_interval * 1000;
+
+	for( i = 0; i < self->servers->len; ++i )
+	{
+		server = g_ptr_array_index( self->servers, i );
+
+		/* a probe without an answer for the whole interval means an overloaded server */
+		if( server->probing )
+		{
+			if( now - server->probed > interval )
+				server->down = TRUE;
+			continue;
+		}
+
+		if( now - server->probed < interval )
+			continue;
+
+		connection = server_free_connection( self, server, NULL );
+		if( connection != NULL )
+		{
+			connection_push( connection, request_new( REQUEST_STATUS, NULL, NULL, NULL, DICT_ENGINE_PRIORITY_HIGH, NULL, NULL ) );
+			server->probing = TRUE;
+			server->probed = now;
+			continue;
+		}
+
+		/* a dead server comes back only through a new connection */
+		if( server_is_alive( server ) )
+			continue;
+		server->probed = now;
+		for( j = 0; j < server->connections->len; ++j )
+		{
+			connection = g_ptr_array_index( server->connections, j );
+			connection->address = server->addresses;
+			if( connection_open( connection, NULL ) )
+				break;
+		}
+	}
+}
+
+static gint
+compare_samples(
+	gconstpointer a,
+	gconstpointer b,
+	gpointer user_data )
+{
+	gint64 x = *(const gint64*)a, y = *(const gint64*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* returns the response time at the hedge percentile, -1 if it is not known yet */
+static gint64
+engine_hedge_threshold(
+	DictEngine *self )
+{
+	gint64 samples[LATENCY_SAMPLES];
+	guint index;
+
+	if( self->n_samples < MIN_HEDGE_SAMPLES )
+		return -1;
+
+	if( self->samples_changed )
+	{
+		memcpy( samples, self->samples, self->n_samples * sizeof( gint64 ) );
+		g_qsort_with_data( samples, self->n_samples, sizeof( gint64 ), compare_samples, NULL );
+
+		index = MIN( (guint)( self->hedge_percentile / 100 * self->n_samples ), self->n_samples - 1 );
+		self->hedge_threshold = samples[index];
+		self->samples_changed = FALSE;
+	}
+
+	return self->hedge_threshold;
+}
+
+static gboolean
+engine_queued(
+	DictEngine *self )
+{
+	guint i;
+
+	for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+		if( !g_queue_is_empty( &self->queue[i] ) )
+			return TRUE;
+
+	return FALSE;
+}
+
+/*
+Duplicates requests waiting longer than the hedge threshold through another free connection, preferably to another server.
+Hedges are sent only when no request waits in the queue, so they never delay a first attempt.
+Returns the number of milliseconds until the next request becomes late, or -1.
+*/
+static gint
+engine_hedge(
+	DictEngine *self )
+{
+	DictConnection *connection, *other;
+	DictRequest *request, *hedge;
+	gint64 now, threshold, wait = -1;
+	guint i;
+	GList *l;
+
+	if( self->hedge_percentile <= 0 || engine_queued( self ) )
+		return -1;
+
+	threshold = engine_hedge_threshold( self );
+	if( threshold < 0 )
+		return -1;
+
+	now = g_get_monotonic_time();
+	for( i = 0; i < self->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( self->connections, i );
+		for( l = connection->requests.head; l != NULL; l = l->next )
+		{
+			request = l->data;
+			if( request->type == REQUEST_STATUS || request->hedged || request->orphan )
+				continue;
+
+			if( now - request->sent < threshold )
+			{
+				if( wait < 0 || request->sent + threshold - now < wait )
+					wait = request->sent + threshold - now;
+				continue;
+			}
+
+			/* a hedge must not take a connection reserved for the other class */
+			if( !engine_admits( self, request->priority ) )
+				continue;
+
+			other = engine_select( self, connection );
+			if( other == NULL )
+				return -1;
+
+			hedge = request_new( request->type, request->database, request->strategy, request->word, request->priority, request->callback, request->user_data );
+			request->hedged = hedge->hedged = TRUE;
+			request->twin = hedge;
+			hedge->twin = request;
+			connection_push( other, hedge );
+		}
+	}
+
+	return wait < 0 ? -1 : (gint)MIN( ( wait + 999 ) / 1000, G_MAXINT );
+}
+
+/* sends queued requests through free connections, returns the number of milliseconds until a request should be hedged, or -1 */
+static gint
+engine_dispatch(
+	DictEngine *self )
+{
+	DictConnection *connection;
+	DictRequest *request;
+	gboolean alive = FALSE;
+	gint hedge_wait;
+	guint i;
+	GError *loc_error = NULL;
+
+	engine_probe( self );
+
+	for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+	{
+		while( !g_queue_is_empty( &self->queue[i] ) && engine_admits( self, i ) && ( connection = engine_select( self, NULL ) ) != NULL )
+			connection_push( connection, g_queue_pop_head( &self->queue[i] ) );
+	}
+	hedge_wait = engine_hedge( self );
+
+	for( i = 0; i < self->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( self->connections, i );
+		if( connection->state != CONNECTION_CLOSED )
+			alive = TRUE;
+
+		if( connection->state == CONNECTION_READY && connection->output->len > connection->output_sent )
+			connection_send( connection );
+	}
+
+	/* nothing could ever serve the queue */
+	if( !alive && engine_queued( self ) )
+	{
+		g_set_error(
+			&loc_error,
+			DICT_CLIENT_ERROR,
+			DICT_CLIENT_ERROR_NO_CONNECTION,
+			"No connection" );
+		for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+			while( ( request = g_queue_pop_head( &self->queue[i] ) ) != NULL )
+				request_complete( self, request, loc_error );
+		g_error_free( loc_error );
+	}
+
+	return hedge_wait;
+}
+
+/* waits for ready connections and processes them, returns FALSE if there is nothing to wait for */
+static gboolean
+engine_wait(
+	DictEngine *self,
+	gint timeout )
+{
+	DictConnection *connection;
+	guint i;
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event events[MAX_EVENTS];
+	GIOCondition condition;
+	gint j, n;
+#else
+	GPollFD *fds;
+	DictConnection **ready;
+	guint n;
+#endif
+	gboolean watched = FALSE;
+
+	for( i = 0; i < self->connections->len && !watched; ++i )
+	{
+		connection = g_ptr_array_index( self->connections, i );
+		watched = connection->events != 0;
+	}
+	if( !watched )
+		return FALSE;
+
+#ifdef HAVE_SYS_EPOLL_H
+	n = epoll_wait( self->epoll_fd, events, MAX_EVENTS, timeout );
+	for( j = 0; j < n; ++j )
+	{
+		condition = ( events[j].events & EPOLLIN ? G_IO_IN : 0 ) |
+			( events[j].events & EPOLLOUT ? G_IO_OUT : 0 ) |
+			( events[j].events & EPOLLERR ? G_IO_ERR : 0 ) |
+			( events[j].events & EPOLLHUP ? G_IO_HUP : 0 );
+		connection_process( events[j].data.ptr, condition );
+	}
+#else
+	/* portable fallback */
+	fds = g_new( GPollFD, self->connections->len );
+	ready = g_new( DictConnection*, self->connections->len );
+	n = 0;
+	for( i = 0; i < self->connections->len; ++i )
+	{
+		connection = g_ptr_array_index( self->connections, i );
+		if( connection->events == 0 )
+			continue;
+
+		fds[n].fd = g_socket_get_fd( connection->socket );
+		fds[n].events = connection->events;
+		fds[n].revents = 0;
+		ready[n++] = connection;
+	}
+
+	g_poll( fds, n, timeout );
+	for( i = 0; i < n; ++i )
+		if( fds[i].revents != 0 )
+			connection_process( ready[i], fds[i].revents );
+
+	g_free( fds );
+	g_free( ready );
+#endif
+
+	return TRUE;
+}
+
+static void
+dict_engine_init(
+	DictEngine *self )
+{
+	guint i;
+
+#ifdef HAVE_SYS_EPOLL_H
+	self->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+#endif
+	self->servers = g_ptr_array_new_with_free_func( (GDestroyNotify)server_free );
+	self->connections = g_ptr_array_new_with_free_func( (GDestroyNotify)connection_free );
+	for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+		g_queue_init( &self->queue[i] );
+
+	self->pipeline_depth = g_value_get_uint( g_param_spec_get_default_value( object_props[PROP_PIPELINE_DEPTH] ) );
+	self->probe_interval = g_value_get_uint( g_param_spec_get_default_value( object_props[PROP_PROBE_INTERVAL] ) );
+	self->receive_limit = g_value_get_uint( g_param_spec_get_default_value( object_props[PROP_RECEIVE_LIMIT] ) );
+	self->reserved[DICT_ENGINE_PRIORITY_HIGH] = g_value_get_uint( g_param_spec_get_default_value( object_props[PROP_HIGH_RESERVED] ) );
+	self->reserved[DICT_ENGINE_PRIORITY_LOW] = g_value_get_uint( g_param_spec_get_default_value( object_props[PROP_LOW_RESERVED] ) );
+}
+
+static void
+dict_engine_dispose(
+	GObject *object )
+{
+	DictEngine *self = DICT_ENGINE( object );
+	guint i;
+
+	/* connections refer to servers */
+	g_clear_pointer( &self->connections, g_ptr_array_unref );
+	g_clear_pointer( &self->servers, g_ptr_array_unref );
+	for( i = 0; i < N_DICT_ENGINE_PRIORITY; ++i )
+		g_queue_clear_full( &self->queue[i], (GDestroyNotify)request_free );
+
+	G_OBJECT_CLASS( dict_engine_parent_class )->dispose( object );
+}
+
+static void
+dict_engine_finalize(
+	GObject *object )
+{
+#ifdef HAVE_SYS_EPOLL_H
+	DictEngine *self = DICT_ENGINE( object );
+
+	if( self->epoll_fd >= 0 )
+		close( self->epoll_fd );
+#endif
+
+	G_OBJECT_CLASS( dict_engine_parent_class )->finalize( object );
+}
+
+static void
+dict_engine_get_property(
+	GObject *object,
+	guint prop_id,
+	GValue *value,
+	GParamSpec *pspec )
+{
+	DictEngine *self = DICT_ENGINE( object );
+
+	switch( (DictEnginePropertyID)prop_id )
+	{
+		case PROP_PIPELINE_DEPTH:
+			g_value_set_uint( value, self->pipeline_depth );
+			break;
+		case PROP_PROBE_INTERVAL:
+			g_value_set_uint( value, self->probe_interval );
+			break;
+		case PROP_HEDGE_PERCENTILE:
+			g_value_set_double( value, self->hedge_percentile );
+			break;
+		case PROP_RECEIVE_LIMIT:
+			g_value_set_uint( value, self->receive_limit );
+			break;
+		case PROP_HIGH_RESERVED:
+			g_value_set_uint( value, self->reserved[DICT_ENGINE_PRIORITY_HIGH] );
+			break;
+		case PROP_LOW_RESERVED:
+			g_value_set_uint( value, self->reserved[DICT_ENGINE_PRIORITY_LOW] );
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID( object, prop_id, pspec );
+			break;
+	}
+}
+
+static void
+dict_engine_set_property(
+	GObject *object,
+	guint prop_id,
+	const GValue *value,
+	GParamSpec *pspec )
+{
+	DictEngine *self = DICT_ENGINE( object );
+
+	switch( (DictEnginePropertyID)prop_id )
+	{
+		case PROP_PIPELINE_DEPTH:
+			self->pipeline_depth = g_value_get_uint( value );
+			break;
+		case PROP_PROBE_INTERVAL:
+			self->probe_interval = g_value_get_uint( value );
+			break;
+		case PROP_HEDGE_PERCENTILE:
+			self->hedge_percentile = g_value_get_double( value );
+			/* the threshold is taken at the new percentile */
+			self->samples_changed = TRUE;
+			break;
+		case PROP_RECEIVE_LIMIT:
+			self->receive_limit = g_value_get_uint( value );
+			break;
+		case PROP_HIGH_RESERVED:
+			self->reserved[DICT_ENGINE_PRIORITY_HIGH] = g_value_get_uint( value );
+			break;
+		case PROP_LOW_RESERVED:
+			self->reserved[DICT_ENGINE_PRIORITY_LOW] = g_value_get_uint( value );
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID( object, prop_id, pspec );
+			break;
+	}
+}
+
+static void
+dict_engine_class_init(
+	DictEngineClass *klass )
+{
+	GObjectClass *object_class = G_OBJECT_CLASS( klass );
+
+	object_class->get_property = dict_engine_get_property;
+	object_class->set_property = dict_engine_set_property;
+	object_class->dispose = dict_engine_dispose;
+	object_class->finalize = dict_engine_finalize;
+
+	object_props[PROP_PIPELINE_DEPTH] = g_param_spec_uint(
+		"pipeline-depth",
+		"Pipeline depth",
+		"Number of requests sent through one connection before their responses are received",
+		1,
+		G_MAXUINT,
+		1,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_PROBE_INTERVAL] = g_param_spec_uint(
+		"probe-interval",
+		"Probe interval",
+		"Number of milliseconds between STATUS probes of every server, 0 disables probes",
+		0,
+		G_MAXUINT,
+		DEFAULT_PROBE_INTERVAL,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_HEDGE_PERCENTILE] = g_param_spec_double(
+		"hedge-percentile",
+		"Hedge percentile",
+		"Percentile of recent response times after which a request is duplicated, 0 disables hedging",
+		0,
+		100,
+		0,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_RECEIVE_LIMIT] = g_param_spec_uint(
+		"receive-limit",
+		"Receive limit",
+		"Number of unparsed bytes a connection holds before it stops reading the socket",
+		DEFAULT_RECEIVE_LEN,
+		G_MAXUINT,
+		DEFAULT_RECEIVE_LIMIT,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_HIGH_RESERVED] = g_param_spec_uint(
+		"high-reserved",
+		"Connections reserved for high priority",
+		"Number of connections low priority requests leave free for high priority ones",
+		0,
+		G_MAXUINT,
+		0,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	object_props[PROP_LOW_RESERVED] = g_param_spec_uint(
+		"low-reserved",
+		"Connections reserved for low priority",
+		"Number of connections high priority requests leave free for low priority ones",
+		0,
+		G_MAXUINT,
+		0,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS );
+	g_object_class_install_properties( object_class, N_PROPS, object_props );
+}
+
+/**
+\anchor dict_engine_new
+\brief Creates a new DictEngine instance.
+
+Use <tt>g_object_unref()</tt> to decrease the reference count of the new instance to 0 and destroys the instance. All connections are closed, callbacks of unfinished requests are not called.
+
+\return New DictEngine instance.
+*/
+DictEngine*
+dict_engine_new(
+	void )
+{
+	return DICT_ENGINE( g_object_new( G_TYPE_DICT_ENGINE, NULL ) );
+}
+
+/**
+\anchor dict_engine_add_server
+\brief Opens connections to the server.
+
+The host is resolved at once, but connections are established while the engine is iterated. If a connection fails after it was established, it is opened again. If no connection is left, all queued requests fail. If no connection can be opened at all, the server is not added.
+
+Servers added to one engine are treated as replicas holding the same databases. Every request goes to the faster of two randomly chosen servers, judged by the average response time and the number of requests in flight. Servers are probed by <tt>STATUS</tt> (see \ref dict_engine_set_probe_interval "dict_engine_set_probe_interval()"), a server failing or not answering a probe in time is avoided until it responds again.
+
+\param[in] self A DictEngine instance.
+\param[in] host Address of the server (IPv4, IPv6 or resolveable name).
+\param[in] port A port number to connect.
+\param[in] n_connections A number of connections to open, must be positive.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+gboolean
+dict_engine_add_server(
+	DictEngine *self,
+	const gchar *host,
+	const guint16 port,
+	guint n_connections,
+	GError **error )
+{
+	DictServer *server;
+	DictConnection *connection;
+	GInetAddress *address;
+	guint i, opened;
+	GError *loc_error = NULL;
+
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), FALSE );
+	g_return_val_if_fail( host != NULL, FALSE );
+	g_return_val_if_fail( n_connections > 0, FALSE );
+
+	server = g_new0( DictServer, 1 );
+	server->host = g_strdup( host );
+	server->port = port;
+	server->connections = g_ptr_array_new();
+
+	/* IP literals need no resolving */
+	address = g_inet_address_new_from_string( host );
+	if( address != NULL )
+		server->addresses = g_list_append( NULL, address );
+	else
+		server->addresses = g_resolver_lookup_by_name( g_resolver_get_default(), host, NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		server_free( server );
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+	g_ptr_array_add( self->servers, server );
+
+	opened = 0;
+	for( i = 0; i < n_connections; ++i )
+	{
+		connection = connection_new( self, server );
+		g_ptr_array_add( self->connections, connection );
+		g_ptr_array_add( server->connections, connection );
+
+		g_clear_error( &loc_error );
+		if( connection_open( connection, &loc_error ) )
+			opened++;
+	}
+
+	/* the engine is left as it was, connections refer to the server, so they go first */
+	if( opened == 0 )
+	{
+		g_ptr_array_remove_range( self->connections, self->connections->len - n_connections, n_connections );
+		g_ptr_array_remove_index( self->servers, self->servers->len - 1 );
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+	g_clear_error( &loc_error );
+
+	return TRUE;
+}
+
+/**
+\anchor dict_engine_define
+\brief Queues a lookup of the \c word in the \c database.
+
+See \ref dict_client_define "dict_client_define()" for the meaning of the arguments. The \c callback is called from \ref dict_engine_iterate "dict_engine_iterate()" when the response is received. The request has the high priority.
+
+\param[in] self A DictEngine instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] callback A function to receive the result, must not be NULL.
+\param[in] user_data Data passed to the \c callback.
+*/
+void
+dict_engine_define(
+	DictEngine *self,
+	const gchar *database,
+	const gchar *word,
+	DictEngineDefineFunc callback,
+	gpointer user_data )
+{
+	dict_engine_define_full( self, database, word, DICT_ENGINE_PRIORITY_HIGH, callback, user_data );
+}
+
+/**
+\anchor dict_engine_define_full
+\brief Queues a lookup of the \c word in the \c database with the \c priority.
+
+Queued requests of a higher priority are sent before those of a lower one, see \ref dict_engine_set_reserved "dict_engine_set_reserved()" to keep connections for a class.
+
+\param[in] self A DictEngine instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] priority A priority of the request.
+\param[in] callback A function to receive the result, must not be NULL.
+\param[in] user_data Data passed to the \c callback.
+*/
+void
+dict_engine_define_full(
+	DictEngine *self,
+	const gchar *database,
+	const gchar *word,
+	DictEnginePriority priority,
+	DictEngineDefineFunc callback,
+	gpointer user_data )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( database != NULL );
+	g_return_if_fail( word != NULL );
+	g_return_if_fail( priority < N_DICT_ENGINE_PRIORITY );
+	g_return_if_fail( callback != NULL );
+
+	g_queue_push_tail( &self->queue[priority], request_new( REQUEST_DEFINE, database, NULL, word, priority, G_CALLBACK( callback ), user_data ) );
+	self->pending++;
+}
+
+/**
+\anchor dict_engine_match
+\brief Queues a match of the \c word in the \c database with the \c strategy.
+
+See \ref dict_client_match "dict_client_match()" for the meaning of the arguments. The \c callback is called from \ref dict_engine_iterate "dict_engine_iterate()" when the response is received. The request has the high priority.
+
+\param[in] self A DictEngine instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] strategy A strategy to search with, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] callback A function to receive the result, must not be NULL.
+\param[in] user_data Data passed to the \c callback.
+*/
+void
+dict_engine_match(
+	DictEngine *self,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	DictEngineMatchFunc callback,
+	gpointer user_data )
+{
+	dict_engine_match_full( self, database, strategy, word, DICT_ENGINE_PRIORITY_HIGH, callback, user_data );
+}
+
+/**
+\anchor dict_engine_match_full
+\brief Queues a match of the \c word in the \c database with the \c strategy and the \c priority.
+
+See \ref dict_engine_define_full "dict_engine_define_full()" for the meaning of the \c priority.
+
+\param[in] self A DictEngine instance.
+\param[in] database A database to search in, must not be NULL.
+\param[in] strategy A strategy to search with, must not be NULL.
+\param[in] word A word to search, must not be NULL.
+\param[in] priority A priority of the request.
+\param[in] callback A function to receive the result, must not be NULL.
+\param[in] user_data Data passed to the \c callback.
+*/
+void
+dict_engine_match_full(
+	DictEngine *self,
+	const gchar *database,
+	const gchar *strategy,
+	const gchar *word,
+	DictEnginePriority priority,
+	DictEngineMatchFunc callback,
+	gpointer user_data )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( database != NULL );
+	g_return_if_fail( strategy != NULL );
+	g_return_if_fail( word != NULL );
+	g_return_if_fail( priority < N_DICT_ENGINE_PRIORITY );
+	g_return_if_fail( callback != NULL );
+
+	g_queue_push_tail( &self->queue[priority], request_new( REQUEST_MATCH, database, strategy, word, priority, G_CALLBACK( callback ), user_data ) );
+	self->pending++;
+}
+
+/**
+\anchor dict_engine_iterate
+\brief Sends queued requests and processes the connections ready for input or output.
+
+Callbacks of the finished requests are called from this function, they may queue new requests, but must not destroy the engine.
+
+\param[in] self A DictEngine instance.
+\param[in] timeout A number of milliseconds to wait for a ready connection, -1 to wait without limit.
+
+\return \c TRUE if there are unfinished requests or \c FALSE otherwise.
+*/
+gboolean
+dict_engine_iterate(
+	DictEngine *self,
+	gint timeout )
+{
+	gint hedge_wait;
+
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), FALSE );
+
+	/* wake up in time for the next probe */
+	if( self->probe_interval > 0 && ( timeout < 0 || (guint)timeout > self->probe_interval ) )
+		timeout = MIN( self->probe_interval, G_MAXINT );
+
+	/* and for the next late request */
+	hedge_wait = engine_dispatch( self );
+	if( hedge_wait >= 0 && ( timeout < 0 || hedge_wait < timeout ) )
+		timeout = hedge_wait;
+
+	if( engine_wait( self, timeout ) )
+		engine_dispatch( self );
+
+	return self->pending > 0;
+}
+
+/**
+\anchor dict_engine_run
+\brief Iterates the engine until all requests are finished.
+
+\param[in] self A DictEngine instance.
+*/
+void
+dict_engine_run(
+	DictEngine *self )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+
+	while( dict_engine_iterate( self, -1 ) );
+}
+
+/**
+\anchor dict_engine_get_pending
+\brief Get the number of unfinished requests.
+
+\param[in] self A DictEngine instance.
+
+\return A number of queued and sent requests without a response.
+*/
+guint
+dict_engine_get_pending(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->pending;
+}
+
+/**
+\anchor dict_engine_set_pipeline_depth
+\brief Sets a number of requests sent through one connection at once.
+
+Requests are sent one after another without waiting for the responses, which come back in the same order. Deep pipelines save round trips on bulk lookups, but a slow response delays all requests behind it.
+
+\param[in] self A DictEngine instance.
+\param[in] depth A number of requests, at least 1. Default is 1.
+*/
+void
+dict_engine_set_pipeline_depth(
+	DictEngine *self,
+	guint depth )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( depth > 0 );
+
+	self->pipeline_depth = depth;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_PIPELINE_DEPTH] );
+}
+
+/**
+\anchor dict_engine_get_pipeline_depth
+\brief Get the number of requests sent through one connection at once.
+
+\param[in] self A DictEngine instance.
+
+\return A number of requests.
+*/
+guint
+dict_engine_get_pipeline_depth(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->pipeline_depth;
+}
+
+/**
+\anchor dict_engine_set_probe_interval
+\brief Sets a time between health probes of every server.
+
+Each probe is a <tt>STATUS</tt> command sent through a free connection of the server. Its response time counts into the average latency of the server, and a probe left without an answer for the whole interval marks the server down. A server without live connections is connected again at the probe time.
+
+\param[in] self A DictEngine instance.
+\param[in] interval A number of milliseconds, 0 disables probes. Default is 5000.
+*/
+void
+dict_engine_set_probe_interval(
+	DictEngine *self,
+	guint interval )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+
+	self->probe_interval = interval;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_PROBE_INTERVAL] );
+}
+
+/**
+\anchor dict_engine_get_probe_interval
+\brief Get the time between health probes of every server.
+
+\param[in] self A DictEngine instance.
+
+\return A number of milliseconds.
+*/
+guint
+dict_engine_get_probe_interval(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->probe_interval;
+}
+
+/**
+\anchor dict_engine_get_n_servers
+\brief Get the number of servers added to the engine.
+
+\param[in] self A DictEngine instance.
+
+\return A number of servers.
+*/
+guint
+dict_engine_get_n_servers(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->servers->len;
+}
+
+/**
+\anchor dict_engine_get_server_latency
+\brief Get the average response time of a server.
+
+\param[in] self A DictEngine instance.
+\param[in] index Index of the server in the order of \ref dict_engine_add_server "dict_engine_add_server()" calls.
+\param[out] down If not NULL, holds \c TRUE if the server is avoided after a failure or a late probe.
+
+\return A number of milliseconds, 0 if nothing was received from the server yet.
+*/
+gdouble
+dict_engine_get_server_latency(
+	DictEngine *self,
+	guint index,
+	gboolean *down )
+{
+	DictServer *server;
+
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+	g_return_val_if_fail( index < self->servers->len, 0 );
+
+	server = g_ptr_array_index( self->servers, index );
+	if( down != NULL )
+		*down = server->down;
+
+	return server->latency / 1000;
+}
+
+/**
+\anchor dict_engine_get_server_times
+\brief Get the times reported by the last probe of a server.
+
+dictd reports times spent by its process serving the probing connection as <tt>[d/m/c = 1/2/300; 12.000r 0.010u 0.002s]</tt> in the <tt>STATUS</tt> reply. Other servers may not report them.
+
+\param[in] self A DictEngine instance.
+\param[in] index Index of the server in the order of \ref dict_engine_add_server "dict_engine_add_server()" calls.
+\param[out] real If not NULL, holds the real time in seconds.
+\param[out] user If not NULL, holds the user CPU time in seconds.
+\param[out] system If not NULL, holds the system CPU time in seconds.
+
+\return \c TRUE if the server has reported the times or \c FALSE otherwise.
+*/
+gboolean
+dict_engine_get_server_times(
+	DictEngine *self,
+	guint index,
+	gdouble *real,
+	gdouble *user,
+	gdouble *system )
+{
+	DictServer *server;
+
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), FALSE );
+	g_return_val_if_fail( index < self->servers->len, FALSE );
+
+	server = g_ptr_array_index( self->servers, index );
+	if( !server->has_status )
+		return FALSE;
+
+	if( real != NULL )
+		*real = server->status.real;
+	if( user != NULL )
+		*user = server->status.user;
+	if( system != NULL )
+		*system = server->status.system;
+
+	return TRUE;
+}
+
+/**
+\anchor dict_engine_set_hedge_percentile
+\brief Sets when a late request is duplicated.
+
+If a <tt>DEFINE</tt> or <tt>MATCH</tt> request has waited for a response longer than the given percentile of recent response times, the same request is sent through another free connection, preferably to another server. The first response is handed to the callback, the other one is read and discarded. Late requests are not duplicated while requests wait in the queue, so hedging uses only idle connections.
+
+\param[in] self A DictEngine instance.
+\param[in] percentile A percentile between 0 and 100, for example 95. 0 disables hedging, it is the default.
+*/
+void
+dict_engine_set_hedge_percentile(
+	DictEngine *self,
+	gdouble percentile )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( percentile >= 0 && percentile <= 100 );
+
+	self->hedge_percentile = percentile;
+	self->samples_changed = TRUE;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_HEDGE_PERCENTILE] );
+}
+
+/**
+\anchor dict_engine_get_hedge_percentile
+\brief Get the percentile of response times after which a request is duplicated.
+
+\param[in] self A DictEngine instance.
+
+\return A percentile, 0 if hedging is disabled.
+*/
+gdouble
+dict_engine_get_hedge_percentile(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->hedge_percentile;
+}
+
+/**
+\anchor dict_engine_set_receive_limit
+\brief Sets a number of received bytes a connection may hold before they are parsed.
+
+A connection stops reading its socket when it holds this many bytes and reads the rest after parsing them, so a huge response does not have to fit in memory at once. Texts are parsed as their bytes arrive, only the texts themselves grow with the response. A connection buffer grown over its typical fill is shrunk back when it is emptied.
+
+\param[in] self A DictEngine instance.
+\param[in] limit A number of bytes, at least 16384. Default is 262144.
+*/
+void
+dict_engine_set_receive_limit(
+	DictEngine *self,
+	guint limit )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( limit >= DEFAULT_RECEIVE_LEN );
+
+	self->receive_limit = limit;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[PROP_RECEIVE_LIMIT] );
+}
+
+/**
+\anchor dict_engine_get_receive_limit
+\brief Get the number of received bytes a connection may hold before they are parsed.
+
+\param[in] self A DictEngine instance.
+
+\return A number of bytes.
+*/
+guint
+dict_engine_get_receive_limit(
+	DictEngine *self )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+
+	return self->receive_limit;
+}
+
+/**
+\anchor dict_engine_set_reserved
+\brief Sets a number of connections kept free for requests of the \c priority.
+
+Requests of the other priorities are not sent to the last free pipeline slots of this many connections, unless requests of the \c priority already use them, so a burst of bulk requests does not delay interactive ones and the other way round. Reservations are counted in slots of the pipeline depth and over all the servers.
+
+\param[in] self A DictEngine instance.
+\param[in] priority A priority to reserve connections for.
+\param[in] n_connections A number of connections. Default is 0.
+*/
+void
+dict_engine_set_reserved(
+	DictEngine *self,
+	DictEnginePriority priority,
+	guint n_connections )
+{
+	g_return_if_fail( DICT_IS_ENGINE( self ) );
+	g_return_if_fail( priority < N_DICT_ENGINE_PRIORITY );
+
+	self->reserved[priority] = n_connections;
+	g_object_notify_by_pspec( G_OBJECT( self ), object_props[priority == DICT_ENGINE_PRIORITY_HIGH ? PROP_HIGH_RESERVED : PROP_LOW_RESERVED] );
+}
+
+/**
+\anchor dict_engine_get_reserved
+\brief Get the number of connections kept free for requests of the \c priority.
+
+\param[in] self A DictEngine instance.
+\param[in] priority A priority.
+
+\return A number of connections.
+*/
+guint
+dict_engine_get_reserved(
+	DictEngine *self,
+	DictEnginePriority priority )
+{
+	g_return_val_if_fail( DICT_IS_ENGINE( self ), 0 );
+	g_return_val_if_fail( priority < N_DICT_ENGINE_PRIORITY, 0 );
+
+	return self->reserved[priority];
+}
@@ -0,0 +1,108 @@
+/**
+\file
+\author leonadkr@gmail.com
+\brief Header for DictEngine class
+
+DictEngine drives many non-blocking connections to dict servers from a single thread. Requests are queued and sent to the first free connection, responses are parsed as their bytes arrive and handed to callbacks.
+
+Typical use of this class:
+\code
+static void
+on_define( DictEngine *engine, glong number, GStrv words, GStrv databases, GStrv descriptions, GStrv definitions, const GError *error, gpointer user_data )
+{
+	glong i;
+
+	for( i = 0; i < number; ++i )
+		g_print( "%s\n%s\n", words[i], definitions[i] );
+
+	g_strfreev( words );
+	g_strfreev( databases );
+	g_strfreev( descriptions );
+	g_strfreev( definitions );
+}
+
+DictEngine *dict_engine;
+
+dict_engine = dict_engine_new();
+dict_engine_add_server( dict_engine, "localhost", 2628, 16, NULL );
+
+dict_engine_define( dict_engine, "*", "one", on_define, NULL );
+dict_engine_define( dict_engine, "*", "two", on_define, NULL );
+dict_engine_run( dict_engine );
+
+g_object_unref( G_OBJECT( dict_engine ) );
+\endcode
+*/
+
+#ifndef GLIB_DICT_ENGINE_H
+#define GLIB_DICT_ENGINE_H
+
+#include <glib-object.h>
+#include <glib.h>
+#include "glibdictclient.h"
+
+G_BEGIN_DECLS
+
+#define G_TYPE_DICT_ENGINE ( dict_engine_get_type() )
+G_DECLARE_FINAL_TYPE( DictEngine, dict_engine, DICT, ENGINE, GObject )
+
+/**
+\anchor _DictEnginePriority
+\enum _DictEnginePriority
+\brief Priorities of queued requests, see \ref dict_engine_define_full "dict_engine_define_full()".
+*/
+enum _DictEnginePriority
+{
+	DICT_ENGINE_PRIORITY_HIGH, /**< Interactive requests, sent before all others. */
+	DICT_ENGINE_PRIORITY_LOW, /**< Bulk or prefetch requests, sent when no high priority request waits. */
+
+	N_DICT_ENGINE_PRIORITY
+};
+/**
+\typedef DictEnginePriority
+\brief Synonym for \ref _DictEnginePriority "enum _DictEnginePriority".
+*/
+typedef enum _DictEnginePriority DictEnginePriority;
+
+/**
+\typedef DictEngineDefineFunc
+\brief Receives the result of \ref dict_engine_define "dict_engine_define()".
+
+Arguments are the same as those of \ref dict_client_define "dict_client_define()", the arrays are owned by the callback. On error \c number is -1, the arrays are NULL and \c error is set, it is owned by the engine.
+*/
+typedef void (*DictEngineDefineFunc)( DictEngine *engine, glong number, GStrv words, GStrv databases, GStrv descriptions, GStrv definitions, const GError *error, gpointer user_data );
+
+/**
+\typedef DictEngineMatchFunc
+\brief Receives the result of \ref dict_engine_match "dict_engine_match()".
+
+Arguments are the same as those of \ref dict_client_match "dict_client_match()", the arrays are owned by the callback. On error \c number is -1, the arrays are NULL and \c error is set, it is owned by the engine.
+*/
+typedef void (*DictEngineMatchFunc)( DictEngine *engine, glong number, GStrv databases, GStrv words, const GError *error, gpointer user_data );
+
+DictEngine* dict_engine_new( void );
+gboolean dict_engine_add_server( DictEngine *self, const gchar *host, const guint16 port, guint n_connections, GError **error );
+void dict_engine_define( DictEngine *self, const gchar *database, const gchar *word, DictEngineDefineFunc callback, gpointer user_data );
+void dict_engine_define_full( DictEngine *self, const gchar *database, const gchar *word, DictEnginePriority priority, DictEngineDefineFunc callback, gpointer user_data );
+void dict_engine_match( DictEngine *self, const gchar *database, const gchar *strategy, const gchar *word, DictEngineMatchFunc callback, gpointer user_data );
+void dict_engine_match_full( DictEngine *self, const gchar *database, const gchar *strategy, const gchar *word, DictEnginePriority priority, DictEngineMatchFunc callback, gpointer user_data );
+gboolean dict_engine_iterate( DictEngine *self, gint timeout );
+void dict_engine_run( DictEngine *self );
+guint dict_engine_get_pending( DictEngine *self );
+void dict_engine_set_pipeline_depth( DictEngine *self, guint depth );
+guint dict_engine_get_pipeline_depth( DictEngine *self );
+void dict_engine_set_probe_interval( DictEngine *self, guint interval );
+guint dict_engine_get_probe_interval( DictEngine *self );
+guint dict_engine_get_n_servers( DictEngine *self );
+gdouble dict_engine_get_server_latency( DictEngine *self, guint index, gboolean *down );
+gboolean dict_engine_get_server_times( DictEngine *self, guint index, gdouble *real, gdouble *user, gdouble *system );
+void dict_engine_set_hedge_percentile( DictEngine *self, gdouble percentile );
+gdouble dict_engine_get_hedge_percentile( DictEngine *self );
+void dict_engine_set_receive_limit( DictEngine *self, guint limit );
+guint dict_engine_get_receive_limit( DictEngine *self );
+void dict_engine_set_reserved( DictEngine *self, DictEnginePriority priority, guint n_connections );
+guint dict_engine_get_reserved( DictEngine *self, DictEnginePriority priority );
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef GLIB_DICT_PROBES_H
+#define GLIB_DICT_PROBES_H
+
+#include "config.h"
+
+#include <glib.h>
+
+/*
+Static tracepoints of the glibdictclient provider, they can be listed with "bpftrace -l 'usdt:PATH:glibdictclient:*'".
+A probe compiles to a single nop, so only values already at hand are passed as arguments.
+
+Probes of DictClient:
+	command__send__start( const char *commands, size_t length )
+	command__send__done( size_t length, int ok )
+	status__receive__start()
+	status__receive__done( long code, size_t length )
+	text__receive__start()
+	text__receive__done( size_t length, int ok )
+	buffer__shrink( size_t old_size, size_t new_size )
+	connect__start( const char *host, unsigned port )
+	connect__done( const char *host, unsigned port, int ok )
+	disconnect__start( const char *host )
+	disconnect__done( const char *host, int ok )
+
+Probes of DictEngine:
+	engine__send( const char *commands, size_t length, size_t sent )
+	engine__receive( size_t length )
+	engine__status( long code, const char *line )
+	engine__text( size_t length )
+	engine__connect( const char *host, unsigned port )
+	engine__close( const char *host, size_t pending )
+*/
+#if defined( HAVE_SYS_SDT_H )
+#include <sys/sdt.h>
+
+#define DICT_PROBE( name ) DTRACE_PROBE( glibdictclient, name )
+#define DICT_PROBE1( name, a ) DTRACE_PROBE1( glibdictclient, name, a )
+#define DICT_PROBE2( name, a, b ) DTRACE_PROBE2( glibdictclient, name, a, b )
+#define DICT_PROBE3( name, a, b, c ) DTRACE_PROBE3( glibdictclient, name, a, b, c )
+#else
+#define DICT_PROBE( name ) do { } while( FALSE )
+#define DICT_PROBE1( name, a ) do { } while( FALSE )
+#define DICT_PROBE2( name, a, b ) do { } while( FALSE )
+#define DICT_PROBE3( name, a, b, c ) do { } while( FALSE )
+#endif
+
+#endif
@@ -0,0 +1,671 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+#include <glib.h>
+#include "glibdictclient.h"
+#include "glibdictprotocol.h"
+
+/**
+\anchor unbracket_string
+\brief Finds a bracketed substring.
+
+Scans \c line for pair of double or single brackets (<tt>\"\"</tt> or <tt>''</tt>). Ignores leading and trailing whitespace characters ( <tt>\*space\*</tt>, <tt>\\t</tt>, <tt>\\r</tt>, <tt>\\n</tt> ), ignores back-slashed brackets (<tt>\\\"</tt>, <tt>\'</tt>). If no brackets found, returns a substring not including whitespace characters. Returns NULL, if \c line includes only whilespace characters or no bracket pair found (just one bracket).
+
+For example,
+\code
+gchar *retstr, *endstr, *s;
+s = unbracket_string( "\t one two three ", &retstr, &endstr );
+\endcode
+will set variables as
+\code
+s == "one two three "
+retstr == "one"
+endstr == " two three "
+\endcode
+and
+\code
+gchar *retstr, *endstr, *s;
+s = unbracket_string( "\t \"one \\'two\\'\" three ", &retstr, &endstr );
+\endcode
+will set variables as
+\code
+s == "one \\'two\\'\" three "
+retstr == "one \\'two\\'"
+endstr == "\" three "
+\endcode
+
+\param[in] line Input string, will not be modified.
+\param[out] retstr If not NULL, will hold a newly allocated copy of the found substring.
+\param[out] endstr If not NULL, will hold a pointer to the second bracket or a whitespace character (if there is no the first bracket).
+
+\return A pointer to the begining of the found substring inside the \c line or NULL.
+*/
+gchar*
+unbracket_string(
+	gchar *line,
+	gchar **retstr,
+	gchar **endstr )
+{
+	gchar *s, *end;
+
+	/* ignore whitespace characters */
+	for( s = line; strchr( " \t\r\n", (int)s[0] ) != NULL; s++ )
+		if( (int)s[0] == (int)'\0' )
+			goto failed;
+
+	/* scan for bracket pair */
+	switch( (int)s[0] )
+	{
+		case (int)'"':
+		case (int)'\'':
+			end = s;
+			do
+				end = strchr( ++end, (int)s[0] );
+			while( end != NULL && end[-1] == (int)'\\' );
+			s++;
+			break;
+
+		default:
+			for( end = s; strchr( " \t\r\n\0", (int)end[0] ) == NULL; end++ );
+			break;
+	}
+	if( end == NULL )
+		goto failed;
+
+	if( endstr != NULL )
+		*endstr = end;
+
+	if( retstr != NULL )
+		*retstr = g_strndup( s, (gsize)end - (gsize)s );
+
+	return s;
+
+failed:
+	if( retstr != NULL )
+		*retstr = NULL;
+
+	if( endstr != NULL )
+		*endstr = NULL;
+
+	return NULL;
+}
+
+/*
+Parses a status line of the server, fields of resp pointing to non-NULL are set.
+Returns the response code, the error is set for error codes.
+*/
+glong
+parse_response(
+	gchar *line,
+	DictResponse *resp,
+	GError **error )
+{
+	gchar *message;
+	glong code;
+
+	g_return_val_if_fail( line != NULL, DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE );
+
+	code = strtol( line, &message, 10 );
+	if( message[0] != '\0' )
+		message++;
+	if( resp != NULL && resp->code != NULL )
+		*(resp->code) = code;
+
+	switch( code )
+	{
+		/* simple response */
+		case 112:
+		case 113:
+		case 114:
+		case 130:
+		case 210:
+		case 220:
+		case 221:
+		case 230:
+		case 250:
+		case 330:
+		case 552:
+		case 554:
+		case 555:
+			if( resp != NULL && resp->message != NULL )
+				*(resp->message) = g_strdup( message );
+			break;
+
+		/* one numerical argument */
+		case 110:
+		case 111:
+		case 150:
+		case 152:
+			if( resp != NULL && resp->number != NULL )
+			{
+				*(resp->number) = strtol( message, &message, 10 );
+				message++;
+			}
+			else
+				message = strchr( message, (int)' ' ) + 1;
+
+			if( resp != NULL && resp->message != NULL )
+				*(resp->message) = g_strdup( message );
+			break;
+
+		/* three textual arguments */
+		case 151:
+			if( resp != NULL )
+			{
+				unbracket_string( message, resp->word, &message );
+				unbracket_string( ++message, resp->database, &message );
+				unbracket_string( ++message, resp->description, NULL );
+
+				/* this case has no additional message */
+				if( resp->message != NULL )
+					*(resp->message) = NULL;
+			}
+			break;
+
+		/* error treatment */
+		case 420:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_SERVER_TEMPORARY_UNAVAILABLE,
+				"Server temporary_unavailable" );
+			break;
+
+		case 421:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_SERVER_SHUTTING_DOWN_AT_OPERATOR_REQUEST,
+				"Server shutting down at operator request" );
+			break;
+
+		case 500:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_SYNTAX_ERROR_COMMAND_NOT_RECOGNIZED,
+				"Syntax error command not recognized" );
+			break;
+
+		case 501:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_SYNTAX_ERROR_ILLEGAL_PARAMETERS,
+				"Syntax error illegal parameters" );
+			break;
+
+		case 502:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_COMMAND_NOT_IMPLEMENTED,
+				"Command not implemented" );
+			break;
+
+		case 503:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_COMMAND_PARAMETER_NOT_IMPLEMENTED,
+				"Command parameter not implemented" );
+			break;
+
+		case 530:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_ACCESS_DENIED,
+				"Access denied" );
+			break;
+
+		case 531:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_ACCESS_DENIED_USE_SHOW_INFO_FOR_SERVER_INFORMATION,
+				"Access denied, use \"SHOW INFO\" for server information" );
+			break;
+
+		case 532:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_ACCESS_DENIED_UNKNOWN_MECHANISM,
+				"Access denied, unknown mechanism" );
+			break;
+
+		case 550:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_INVALID_DATABASE_USE_SHOW_DB_FOR_LIST_OF_DATABASES,
+				"Invalid database use, \"SHOW DB\" for list of databases" );
+			break;
+
+		case 551:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_INVALID_STRATEGY_USE_SHOW_STRAT_FOR_A_LIST_OF_STRATEGIES,
+				"Invalid strategy, use \"SHOW STRAT\" for a list of strategies" );
+			break;
+
+		default:
+			g_set_error(
+				error,
+				DICT_CLIENT_ERROR,
+				DICT_CLIENT_ERROR_UNKNOWN_RESPONSE_CODE,
+				"Unknown response code %ld",
+				code );
+			break;
+	}
+
+	return code;
+}
+
+/* fills up the arrays from a text holding a pair of strings in each line */
+void
+split_pairs(
+	gchar *text,
+	glong number,
+	GStrv *data,
+	GStrv *desc )
+{
+	gchar *s;
+	glong i;
+
+	/* allocate arrays */
+	pstrallocv_number( data, number + 1 );
+	pstrallocv_number( desc, number + 1 );
+
+	if( data == NULL && desc == NULL )
+		return;
+
+	s = text - 1;
+	for( i = 0; i < number; ++i )
+	{
+		if( data != NULL )
+			unbracket_string( ++s, &((*data)[i]), &s );
+		else
+			unbracket_string( ++s, NULL, &s );
+
+		if( desc != NULL )
+			unbracket_string( ++s, &((*desc)[i]), &s );
+		else
+			unbracket_string( ++s, NULL, &s );
+	}
+	pstrnullv_index( data, number );
+	pstrnullv_index( desc, number );
+}
+
+/* terminates the next bracketed string of the text in place and moves the cursor past it */
+static const gchar*
+next_string(
+	gchar **cursor )
+{
+	gchar *s, *end;
+
+	s = unbracket_string( *cursor, NULL, &end );
+	if( s == NULL )
+		return NULL;
+
+	*cursor = *end == '\0' ? end : end + 1;
+	*end = '\0';
+
+	return s;
+}
+
+/*
+Parses the next pair of a list text without copying, the text is modified.
+Returns FALSE when the text is over.
+*/
+gboolean
+next_pair(
+	gchar **cursor,
+	const gchar **data,
+	const gchar **desc )
+{
+	g_return_val_if_fail( cursor != NULL && *cursor != NULL, FALSE );
+
+	*data = next_string( cursor );
+	if( *data == NULL )
+		return FALSE;
+
+	*desc = next_string( cursor );
+	if( *desc == NULL )
+		*desc = "";
+
+	return TRUE;
+}
+
+/* parses a number followed by the suffix */
+static gboolean
+parse_status_time(
+	const gchar **s,
+	gchar suffix,
+	gdouble *value )
+{
+	gchar *end;
+
+	*value = g_ascii_strtod( *s, &end );
+	if( end == *s || *end != suffix )
+		return FALSE;
+	*s = end + 1;
+	while( **s == ' ' )
+		(*s)++;
+
+	return TRUE;
+}
+
+/*
+Parses timing fields of the STATUS reply, dictd sends them as "[d/m/c = 1/2/300; 12.000r 0.010u 0.002s]".
+Returns FALSE if the message has no such fields, other servers may reply in free form.
+*/
+gboolean
+parse_status(
+	const gchar *message,
+	DictStatus *status )
+{
+	const gchar *s;
+	gchar *end;
+
+	g_return_val_if_fail( message != NULL, FALSE );
+	g_return_val_if_fail( status != NULL, FALSE );
+
+	s = strstr( message, "[d/m/c = " );
+	if( s == NULL )
+		return FALSE;
+	s += strlen( "[d/m/c = " );
+
+	status->defines = strtol( s, &end, 10 );
+	if( end == s || *end != '/' )
+		return FALSE;
+	s = end + 1;
+	status->matches = strtol( s, &end, 10 );
+	if( end == s || *end != '/' )
+		return FALSE;
+	s = end + 1;
+	status->comparisons = strtol( s, &end, 10 );
+	if( end == s || *end != ';' )
+		return FALSE;
+	s = end + 1;
+	while( *s == ' ' )
+		s++;
+
+	return parse_status_time( &s, 'r', &status->real ) &&
+		parse_status_time( &s, 'u', &status->user ) &&
+		parse_status_time( &s, 's', &status->system );
+}
+
+void
+command_begin(
+	GString *command,
+	const gchar *keyword )
+{
+	g_string_append( command, keyword );
+}
+
+/* RFC 2229: a quoted string may hold a quote escaped by a backslash */
+void
+command_append_string(
+	GString *command,
+	const gchar *string )
+{
+	const gchar *s;
+
+	g_string_append( command, " \"" );
+	for( s = string; *s != '\0'; s++ )
+	{
+		switch( (int)s[0] )
+		{
+			case (int)'"':
+			case (int)'\\':
+				g_string_append_c( command, '\\' );
+				g_string_append_c( command, s[0] );
+				break;
+
+			/* a command is a single line */
+			case (int)'\r':
+			case (int)'\n':
+				g_string_append_c( command, ' ' );
+				break;
+
+			default:
+				g_string_append_c( command, s[0] );
+				break;
+		}
+	}
+	g_string_append_c( command, '"' );
+}
+
+void
+command_end(
+	GString *command )
+{
+	g_string_append( command, "\r\n" );
+}
+
+/* invalid sequences are replaced by U+FFFD */
+#define REPLACEMENT_CHARACTER "\xef\xbf\xbd"
+
+/*
+Checks a UTF-8 sequence beginning with a non-ASCII byte.
+Returns its length, 0 if more bytes are needed to decide, or -1 if the sequence is invalid.
+*/
+static gint
+utf8_sequence(
+	const guchar *s,
+	gsize length )
+{
+	gint n, i;
+	guchar min, max;
+
+	/* the second byte has narrower bounds to reject overlong forms, surrogates and too large code points */
+	min = 0x80;
+	max = 0xbf;
+	if( s[0] >= 0xc2 && s[0] <= 0xdf )
+		n = 2;
+	else if( s[0] >= 0xe0 && s[0] <= 0xef )
+	{
+		n = 3;
+		if( s[0] == 0xe0 )
+			min = 0xa0;
+		else if( s[0] == 0xed )
+			max = 0x9f;
+	}
+	else if( s[0] >= 0xf0 && s[0] <= 0xf4 )
+	{
+		n = 4;
+		if( s[0] == 0xf0 )
+			min = 0x90;
+		else if( s[0] == 0xf4 )
+			max = 0x8f;
+	}
+	else
+		return -1;
+
+	for( i = 1; i < n; ++i )
+	{
+		if( (gsize)i >= length )
+			return 0;
+
+		if( s[i] < min || s[i] > max )
+			return -1;
+
+		min = 0x80;
+		max = 0xbf;
+	}
+
+	return n;
+}
+
+/* skips bytes those are neither line feeds nor non-ASCII */
+static const guchar*
+skip_plain(
+	const guchar *s,
+	const guchar *end )
+{
+#if defined( __AVX2__ )
+	const __m256i lf32 = _mm256_set1_epi8( '\n' );
+	__m256i v32;
+	guint32 mask32;
+#endif
+#if defined( __SSE2__ )
+	const __m128i lf16 = _mm_set1_epi8( '\n' );
+	__m128i v16;
+	guint32 mask16;
+#endif
+
+	/* the high bit of each byte is set for a line feed or a non-ASCII byte */
+#if defined( __AVX2__ )
+	while( end - s >= 32 )
+	{
+		v32 = _mm256_loadu_si256( (const __m256i*)s );
+		mask32 = (guint32)_mm256_movemask_epi8( _mm256_or_si256( v32, _mm256_cmpeq_epi8( v32, lf32 ) ) );
+		if( mask32 != 0 )
+			return s + g_bit_nth_lsf( mask32, -1 );
+		s += 32;
+	}
+#endif
+#if defined( __SSE2__ )
+	while( end - s >= 16 )
+	{
+		v16 = _mm_loadu_si128( (const __m128i*)s );
+		mask16 = (guint32)_mm_movemask_epi8( _mm_or_si128( v16, _mm_cmpeq_epi8( v16, lf16 ) ) );
+		if( mask16 != 0 )
+			return s + g_bit_nth_lsf( mask16, -1 );
+		s += 16;
+	}
+#endif
+
+	while( s < end && s[0] != '\n' && s[0] < 0x80 )
+		s++;
+
+	return s;
+}
+
+void
+text_scanner_init(
+	DictTextScanner *scanner )
+{
+	scanner->text = NULL;
+	scanner->offset = 0;
+	scanner->line_start = TRUE;
+}
+
+void
+text_scanner_clear(
+	DictTextScanner *scanner )
+{
+	if( scanner->text != NULL )
+		g_string_free( scanner->text, TRUE );
+
+	text_scanner_init( scanner );
+}
+
+/*
+Scans a text block in a single pass: finds the terminating dot line, removes the leading dot of dot-stuffed lines and replaces invalid UTF-8 sequences.
+The buffer must begin at the same byte for every call, bytes scanned by previous calls are skipped.
+Returns TRUE when the block is complete, then the offset of the scanner holds the length of the block including the terminator.
+*/
+gboolean
+text_scanner_scan(
+	DictTextScanner *scanner,
+	const gchar *buf,
+	gsize length )
+{
+	const guchar *s, *end, *run;
+	gint n;
+
+	s = (const guchar*)buf + scanner->offset;
+	end = (const guchar*)buf + length;
+
+	if( scanner->text == NULL )
+		scanner->text = g_string_sized_new( length );
+
+	while( s < end )
+	{
+		if( scanner->line_start )
+		{
+			if( s[0] == (guchar)'.' )
+			{
+				if( end - s < 2 || ( s[1] != (guchar)'.' && end - s < 3 ) )
+					break;
+
+				/* the end of the text, the last line breaker is not a part of it */
+				if( s[1] == (guchar)'\r' && s[2] == (guchar)'\n' )
+				{
+					if( scanner->text->len >= 2 && memcmp( scanner->text->str + scanner->text->len - 2, "\r\n", 2 ) == 0 )
+						g_string_truncate( scanner->text, scanner->text->len - 2 );
+
+					scanner->offset = s + 3 - (const guchar*)buf;
+					return TRUE;
+				}
+
+				/* RFC 2229: a leading dot is doubled */
+				if( s[1] == (guchar)'.' )
+					s++;
+			}
+
+			scanner->line_start = FALSE;
+		}
+
+		run = s;
+		s = skip_plain( s, end );
+		if( s > run )
+			g_string_append_len( scanner->text, (const gchar*)run, s - run );
+		if( s == end )
+			break;
+
+		if( s[0] == (guchar)'\n' )
+		{
+			g_string_append_c( scanner->text, '\n' );
+			scanner->line_start = TRUE;
+			s++;
+			continue;
+		}
+
+		n = utf8_sequence( s, end - s );
+		if( n == 0 )
+			break;
+
+		if( n < 0 )
+		{
+			g_string_append( scanner->text, REPLACEMENT_CHARACTER );
+			s++;
+			continue;
+		}
+
+		g_string_append_len( scanner->text, (const gchar*)s, n );
+		s += n;
+	}
+
+	scanner->offset = s - (const guchar*)buf;
+
+	return FALSE;
+}
+
+/* returns the scanned text and resets the scanner */
+gchar*
+text_scanner_finish(
+	DictTextScanner *scanner,
+	gsize *length )
+{
+	gchar *text;
+
+	if( scanner->text == NULL )
+		scanner->text = g_string_new( NULL );
+
+	if( length != NULL )
+		*length = scanner->text->len;
+	text = g_string_free( scanner->text, FALSE );
+
+	text_scanner_init( scanner );
+
+	return text;
+}
@@ -0,0 +1,63 @@
+/*
+Internal parsing and command building shared by DictClient and DictEngine.
+*/
+
+#ifndef GLIB_DICT_PROTOCOL_H
+#define GLIB_DICT_PROTOCOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define pstrnullv( pstrv ) do { if( ( pstrv ) != NULL ) *( pstrv ) = NULL; } while( FALSE )
+#define pstrallocv_number( pstrv, number ) do { if( ( pstrv ) != NULL ) *( pstrv ) = g_new( gchar*, (number) ); } while( FALSE )
+#define pstrnullv_index( pstrv, index ) do { if( ( pstrv ) != NULL ) (*( pstrv ))[(index)] = NULL; } while( FALSE )
+#define pstrfreev( pstrv ) do { if( ( pstrv ) != NULL ) g_strfreev( *( pstrv ) ); } while( FALSE )
+
+struct _DictResponse
+{
+	glong *code;
+	glong *number;
+	gchar **message;
+	gchar **word;
+	gchar **database;
+	gchar **description;
+};
+typedef struct _DictResponse DictResponse;
+
+struct _DictTextScanner
+{
+	GString *text;
+	gsize offset;
+	gboolean line_start;
+};
+typedef struct _DictTextScanner DictTextScanner;
+
+/* counters and times reported by STATUS */
+struct _DictStatus
+{
+	glong defines;
+	glong matches;
+	glong comparisons;
+	gdouble real;
+	gdouble user;
+	gdouble system;
+};
+typedef struct _DictStatus DictStatus;
+
+G_GNUC_INTERNAL gchar* unbracket_string( gchar *line, gchar **retstr, gchar **endstr );
+G_GNUC_INTERNAL glong parse_response( gchar *line, DictResponse *resp, GError **error );
+G_GNUC_INTERNAL void split_pairs( gchar *text, glong number, GStrv *data, GStrv *desc );
+G_GNUC_INTERNAL gboolean next_pair( gchar **cursor, const gchar **data, const gchar **desc );
+G_GNUC_INTERNAL gboolean parse_status( const gchar *message, DictStatus *status );
+G_GNUC_INTERNAL void command_begin( GString *command, const gchar *keyword );
+G_GNUC_INTERNAL void command_append_string( GString *command, const gchar *string );
+G_GNUC_INTERNAL void command_end( GString *command );
+G_GNUC_INTERNAL void text_scanner_init( DictTextScanner *scanner );
+G_GNUC_INTERNAL void text_scanner_clear( DictTextScanner *scanner );
+G_GNUC_INTERNAL gboolean text_scanner_scan( DictTextScanner *scanner, const gchar *buf, gsize length );
+G_GNUC_INTERNAL gchar* text_scanner_finish( DictTextScanner *scanner, gsize *length );
+
+G_END_DECLS
+
+#endif
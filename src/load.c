@@ -0,0 +1,605 @@
+#include "config.h"
+
+#include "lib/glibdictclient.h"
+#include "lib/glibdictengine.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include <locale.h>
+#include <math.h>
+#include <string.h>
+
+#define LOAD_APP_SUMMARY "This program sends requests to a dict server at a fixed rate, whether earlier requests are answered or not, and reports latency percentiles.\n\nLatency is counted from the time a request was due, not from the time it was sent, so a server falling behind is not hidden by the generator waiting for it. With --stand-in the program serves as a trivial dict server instead, to measure the client side alone."
+
+#define DEFAULT_CONNECTIONS 16
+#define DEFAULT_RATE 100.0
+#define DEFAULT_DURATION 10
+#define DEFAULT_DRAIN 10
+#define DEFAULT_VOCABULARY 10000
+#define DEFAULT_ZIPF_EXPONENT 1.0
+#define DEFAULT_STAND_IN_THREADS 64
+
+enum _LoadDistribution
+{
+	LOAD_DISTRIBUTION_ZIPF,
+	LOAD_DISTRIBUTION_UNIFORM,
+	LOAD_DISTRIBUTION_SEQUENCE
+};
+typedef enum _LoadDistribution LoadDistribution;
+
+struct _Load
+{
+	DictEngine *engine;
+	const gchar *database;
+	const gchar *strategy;
+
+	GPtrArray *words;
+	LoadDistribution distribution;
+	/* cumulative probabilities of the words for the Zipf distribution */
+	gdouble *cdf;
+	guint next_word;
+
+	/* all sent requests, the engine drops unanswered ones without a callback */
+	GPtrArray *requests;
+	/* microseconds from the due time to the answer, unanswered requests are added at the end */
+	GArray *latencies;
+	/* microseconds from the due time to the send, the generator's own delay */
+	GArray *lateness;
+	guint errors;
+	guint unanswered;
+};
+typedef struct _Load Load;
+
+struct _LoadRequest
+{
+	Load *load;
+	gint64 due;
+	gboolean answered;
+};
+typedef struct _LoadRequest LoadRequest;
+
+/**
+\anchor load_read_words
+\brief Reads words from a file, one per line.
+
+\param[in] words An array to append the words to.
+\param[in] filename A path of the file.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+static gboolean
+load_read_words(
+	GPtrArray *words,
+	const gchar *filename,
+	GError **error )
+{
+	gchar *contents, **lines;
+	guint i;
+
+	if( !g_file_get_contents( filename, &contents, NULL, error ) )
+		return FALSE;
+
+	lines = g_strsplit( contents, "\n", -1 );
+	g_free( contents );
+	for( i = 0; lines[i] != NULL; ++i )
+	{
+		g_strstrip( lines[i] );
+		if( *lines[i] != '\0' )
+			g_ptr_array_add( words, lines[i] );
+		else
+			g_free( lines[i] );
+	}
+	/* strings are moved to the array */
+	g_free( lines );
+
+	if( words->len == 0 )
+	{
+		g_set_error( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s has no words", filename );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* the word of rank k is taken with probability proportional to 1 / k^s */
+static gdouble*
+zipf_cdf_new(
+	guint n,
+	gdouble exponent )
+{
+	gdouble *cdf, sum = 0.0;
+	guint k;
+
+	cdf = g_new( gdouble, n );
+	for( k = 0; k < n; ++k )
+	{
+		sum += 1.0 / pow( k + 1, exponent );
+		cdf[k] = sum;
+	}
+	for( k = 0; k < n; ++k )
+		cdf[k] /= sum;
+
+	return cdf;
+}
+
+static const gchar*
+load_next_word(
+	Load *load )
+{
+	gdouble u;
+	guint low, high, middle;
+
+	switch( load->distribution )
+	{
+		case LOAD_DISTRIBUTION_SEQUENCE:
+			return g_ptr_array_index( load->words, load->next_word++ % load->words->len );
+
+		case LOAD_DISTRIBUTION_UNIFORM:
+			return g_ptr_array_index( load->words, g_random_int_range( 0, load->words->len ) );
+
+		case LOAD_DISTRIBUTION_ZIPF:
+		default:
+			break;
+	}
+
+	/* the first rank whose cumulative probability reaches u */
+	u = g_random_double();
+	low = 0;
+	high = load->words->len - 1;
+	while( low < high )
+	{
+		middle = low + ( high - low ) / 2;
+		if( load->cdf[middle] < u )
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return g_ptr_array_index( load->words, low );
+}
+
+static void
+load_finish(
+	LoadRequest *request,
+	const GError *error )
+{
+	Load *load = request->load;
+	gint64 latency;
+
+	latency = g_get_monotonic_time() - request->due;
+	g_array_append_val( load->latencies, latency );
+	if( error != NULL )
+		load->errors++;
+	request->answered = TRUE;
+}
+
+static void
+on_define(
+	DictEngine *engine,
+	glong number,
+	GStrv words,
+	GStrv databases,
+	GStrv descriptions,
+	GStrv definitions,
+	const GError *error,
+	gpointer user_data )
+{
+	g_strfreev( words );
+	g_strfreev( databases );
+	g_strfreev( descriptions );
+	g_strfreev( definitions );
+
+	load_finish( user_data, error );
+}
+
+static void
+on_match(
+	DictEngine *engine,
+	glong number,
+	GStrv databases,
+	GStrv words,
+	const GError *error,
+	gpointer user_data )
+{
+	g_strfreev( databases );
+	g_strfreev( words );
+
+	load_finish( user_data, error );
+}
+
+static gint
+compare_latency(
+	gconstpointer a,
+	gconstpointer b )
+{
+	gint64 x = *(const gint64*)a, y = *(const gint64*)b;
+
+	return ( x > y ) - ( x < y );
+}
+
+static void
+print_percentiles(
+	const gchar *name,
+	GArray *values )
+{
+	const gdouble percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+	gint64 value;
+	guint i, index;
+
+	if( values->len == 0 )
+		return;
+
+	g_array_sort( values, compare_latency );
+
+	g_print( "%s (ms):\n", name );
+	for( i = 0; i < G_N_ELEMENTS( percentiles ); ++i )
+	{
+		index = (guint)ceil( percentiles[i] / 100.0 * values->len );
+		index = index > 0 ? index - 1 : 0;
+		value = g_array_index( values, gint64, index );
+		g_print( "  p%-6g %12.3f\n", percentiles[i], value / 1000.0 );
+	}
+	g_print( "  max     %12.3f\n", g_array_index( values, gint64, values->len - 1 ) / 1000.0 );
+}
+
+/**
+\anchor load_run
+\brief Sends requests at the rate for the duration and waits for the answers.
+
+Requests due while the engine is busy are sent together as soon as it returns, their latency still counts from their due times.
+
+\param[in] load A Load instance.
+\param[in] rate A number of requests per second.
+\param[in] poisson If \c TRUE, times between requests are random with the mean 1 / \c rate.
+\param[in] duration A number of seconds to send requests.
+\param[in] drain A number of seconds to wait for the answers after the last request.
+*/
+static void
+load_run(
+	Load *load,
+	gdouble rate,
+	gboolean poisson,
+	guint duration,
+	guint drain )
+{
+	LoadRequest *request;
+	const gchar *word;
+	gint64 start, now, due, end, lateness;
+	guint i;
+
+	start = g_get_monotonic_time();
+	end = start + (gint64)duration * G_USEC_PER_SEC;
+	due = start;
+	while( due < end )
+	{
+		for( now = g_get_monotonic_time(); due <= now && due < end; )
+		{
+			request = g_new( LoadRequest, 1 );
+			request->load = load;
+			request->due = due;
+			request->answered = FALSE;
+			g_ptr_array_add( load->requests, request );
+			lateness = now - due;
+			g_array_append_val( load->lateness, lateness );
+
+			word = load_next_word( load );
+			if( load->strategy != NULL )
+				dict_engine_match( load->engine, load->database, load->strategy, word, on_match, request );
+			else
+				dict_engine_define( load->engine, load->database, word, on_define, request );
+
+			if( poisson )
+				due += (gint64)( -log( 1.0 - g_random_double() ) / rate * G_USEC_PER_SEC );
+			else
+				due = start + (gint64)( load->requests->len / rate * G_USEC_PER_SEC );
+		}
+
+		/* wake up for the next due request, the engine counts in milliseconds */
+		dict_engine_iterate( load->engine, (gint)( ( MIN( due, end ) - now + 999 ) / 1000 ) );
+	}
+
+	end = g_get_monotonic_time() + (gint64)drain * G_USEC_PER_SEC;
+	while( dict_engine_get_pending( load->engine ) > 0 && ( now = g_get_monotonic_time() ) < end )
+		dict_engine_iterate( load->engine, (gint)( ( end - now + 999 ) / 1000 ) );
+
+	/* unanswered requests are as late as the test is long, leaving them out would flatter the server */
+	now = g_get_monotonic_time();
+	for( i = 0; i < load->requests->len; ++i )
+	{
+		request = g_ptr_array_index( load->requests, i );
+		if( !request->answered )
+		{
+			lateness = now - request->due;
+			g_array_append_val( load->latencies, lateness );
+			load->unanswered++;
+		}
+	}
+}
+
+/**
+\anchor stand_in_reply
+\brief Builds a reply of the stand-in server to a command line.
+
+\return \c FALSE if the connection should be closed after the reply.
+*/
+static gboolean
+stand_in_reply(
+	const gchar *line,
+	GString *reply )
+{
+	gchar **argv;
+	gint argc;
+	gboolean ok = TRUE;
+
+	g_string_truncate( reply, 0 );
+	if( !g_shell_parse_argv( line, &argc, &argv, NULL ) )
+	{
+		g_string_append( reply, "500 syntax error, command not recognized\r\n" );
+		return TRUE;
+	}
+
+	if( g_ascii_strcasecmp( argv[0], "DEFINE" ) == 0 && argc == 3 )
+		g_string_append_printf( reply,
+			"150 1 definitions retrieved\r\n"
+			"151 \"%s\" stand-in \"Stand-in database\"\r\n"
+			"%s\r\n"
+			"   A definition of the word, see {%s}.\r\n"
+			".\r\n"
+			"250 ok\r\n",
+			argv[2], argv[2], argv[2] );
+	else if( g_ascii_strcasecmp( argv[0], "MATCH" ) == 0 && argc == 4 )
+		g_string_append_printf( reply,
+			"152 1 matches found\r\n"
+			"stand-in \"%s\"\r\n"
+			".\r\n"
+			"250 ok\r\n",
+			argv[3] );
+	else if( g_ascii_strcasecmp( argv[0], "SHOW" ) == 0 && argc == 2 && ( g_ascii_strcasecmp( argv[1], "DB" ) == 0 || g_ascii_strcasecmp( argv[1], "DATABASES" ) == 0 ) )
+		g_string_append( reply, "110 1 databases present\r\nstand-in \"Stand-in database\"\r\n.\r\n250 ok\r\n" );
+	else if( g_ascii_strcasecmp( argv[0], "STATUS" ) == 0 )
+		g_string_append( reply, "210 status [d/m/c = 0/0/0; 0.000r 0.000u 0.000s]\r\n" );
+	else if( g_ascii_strcasecmp( argv[0], "CLIENT" ) == 0 || g_ascii_strcasecmp( argv[0], "OPTION" ) == 0 )
+		g_string_append( reply, "250 ok\r\n" );
+	else if( g_ascii_strcasecmp( argv[0], "QUIT" ) == 0 )
+	{
+		g_string_append( reply, "221 bye\r\n" );
+		ok = FALSE;
+	}
+	else
+		g_string_append( reply, "502 command not implemented\r\n" );
+
+	g_strfreev( argv );
+
+	return ok;
+}
+
+/**
+\anchor on_stand_in_run
+\brief Serves a connection of the stand-in server.
+
+Every word is found in the single database. Commands are answered one by one, so pipelined commands are served in order.
+*/
+static gboolean
+on_stand_in_run(
+	GThreadedSocketService *service,
+	GSocketConnection *connection,
+	GObject *source_object,
+	gpointer user_data )
+{
+	guint delay = GPOINTER_TO_UINT( user_data );
+	GDataInputStream *input;
+	GOutputStream *output;
+	GString *reply;
+	gchar *line;
+	gboolean ok;
+
+	input = g_data_input_stream_new( g_io_stream_get_input_stream( G_IO_STREAM( connection ) ) );
+	g_data_input_stream_set_newline_type( input, G_DATA_STREAM_NEWLINE_TYPE_ANY );
+	output = g_io_stream_get_output_stream( G_IO_STREAM( connection ) );
+	reply = g_string_new( "220 stand-in <auth.mime> <0@stand-in>\r\n" );
+
+	ok = g_output_stream_write_all( output, reply->str, reply->len, NULL, NULL, NULL );
+	while( ok && ( line = g_data_input_stream_read_line( input, NULL, NULL, NULL ) ) != NULL )
+	{
+		if( *g_strstrip( line ) != '\0' )
+		{
+			if( delay > 0 )
+				g_usleep( (gulong)delay * 1000 );
+			ok = stand_in_reply( line, reply );
+			ok = g_output_stream_write_all( output, reply->str, reply->len, NULL, NULL, NULL ) && ok;
+		}
+		g_free( line );
+	}
+
+	g_string_free( reply, TRUE );
+	g_object_unref( input );
+
+	return TRUE;
+}
+
+static gint
+stand_in_serve(
+	gint listen_port,
+	gint delay )
+{
+	GSocketService *service;
+	GMainLoop *loop;
+	GError *error = NULL;
+
+	service = g_threaded_socket_service_new( DEFAULT_STAND_IN_THREADS );
+	if( !g_socket_listener_add_inet_port( G_SOCKET_LISTENER( service ), listen_port, NULL, &error ) )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_object_unref( service );
+		return EXIT_FAILURE;
+	}
+	g_signal_connect( service, "run", G_CALLBACK( on_stand_in_run ), GUINT_TO_POINTER( (guint)delay ) );
+	g_socket_service_start( service );
+
+	loop = g_main_loop_new( NULL, FALSE );
+	g_main_loop_run( loop );
+
+	g_main_loop_unref( loop );
+	g_socket_service_stop( service );
+	g_object_unref( service );
+
+	return EXIT_SUCCESS;
+}
+
+int
+main(
+	int argc,
+	char *argv[] )
+{
+	gchar *host = NULL;
+	gint port = 2628;
+	gchar *database = NULL;
+	gchar *strategy = NULL;
+	gint connections = DEFAULT_CONNECTIONS;
+	gint pipeline_depth = 0;
+	gdouble rate = DEFAULT_RATE;
+	gboolean poisson = FALSE;
+	gint duration = DEFAULT_DURATION;
+	gint drain = DEFAULT_DRAIN;
+	gchar *words_file = NULL;
+	gint vocabulary = DEFAULT_VOCABULARY;
+	gchar *distribution = NULL;
+	gdouble zipf_exponent = DEFAULT_ZIPF_EXPONENT;
+	gboolean stand_in = FALSE;
+	gint delay = 0;
+	const GOptionEntry option_entries[] =
+	{
+		{ "host", 'h', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &host, "A host address of the dict server. Default is localhost.", "HOST" },
+		{ "port", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &port, "A port number of the dict server, or the port to serve on with --stand-in. Default is 2628.", "PORT" },
+		{ "database", 'd', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &database, "A database name. Default is *.", "DATABASE" },
+		{ "strategy", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &strategy, "If set, words will be matched by the strategy instead of defined.", "STRATEGY" },
+		{ "connections", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &connections, "A number of connections. Default is 16.", "NUMBER" },
+		{ "pipeline", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &pipeline_depth, "A number of pipelined commands per connection. Default is the engine's default.", "NUMBER" },
+		{ "rate", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &rate, "A number of requests per second. Default is 100.", "NUMBER" },
+		{ "poisson", 'P', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &poisson, "If set, times between requests will be random with the same mean rate.", NULL },
+		{ "duration", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &duration, "A number of seconds to send requests. Default is 10.", "SECONDS" },
+		{ "drain", 'D', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &drain, "A number of seconds to wait for answers after the last request. Default is 10.", "SECONDS" },
+		{ "words", 'w', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &words_file, "A file of words, one per line, in the order of their ranks. Default is generated words.", "FILE" },
+		{ "vocabulary", 'v', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &vocabulary, "A number of generated words. Default is 10000.", "NUMBER" },
+		{ "distribution", 'x', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &distribution, "A distribution of words: zipf, uniform or sequence (the words in order). Default is zipf.", "NAME" },
+		{ "zipf-exponent", 'z', G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &zipf_exponent, "An exponent of the Zipf distribution. Default is 1.", "NUMBER" },
+		{ "stand-in", 'S', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &stand_in, "If set, the program will serve as a stand-in dict server on the port instead of sending requests.", NULL },
+		{ "delay", 'y', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &delay, "A number of milliseconds the stand-in server waits before every reply. Default is 0.", "MS" },
+		{ NULL }
+	};
+
+	GOptionContext *option_context;
+	Load load;
+	gint64 start, elapsed;
+	guint i;
+	gint ret = EXIT_FAILURE;
+	GError *error = NULL;
+
+	setlocale( LC_ALL, "" );
+
+	option_context = g_option_context_new( NULL );
+	g_option_context_set_summary( option_context, LOAD_APP_SUMMARY );
+	g_option_context_set_help_enabled( option_context, TRUE );
+	g_option_context_add_main_entries( option_context, option_entries, NULL );
+
+	g_option_context_parse( option_context, &argc, &argv, &error );
+	g_option_context_free( option_context );
+	if( error == NULL && ( connections < 1 || pipeline_depth < 0 || rate <= 0.0 || duration < 1 || drain < 0 || vocabulary < 1 || zipf_exponent <= 0.0 || delay < 0 || port < 1 || port > G_MAXUINT16 ) )
+		g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Numbers of connections, words, the rate, the duration and the exponent must be positive, other numbers must not be negative" );
+	memset( &load, 0, sizeof( load ) );
+	if( error == NULL )
+	{
+		if( distribution == NULL || g_strcmp0( distribution, "zipf" ) == 0 )
+			load.distribution = LOAD_DISTRIBUTION_ZIPF;
+		else if( g_strcmp0( distribution, "uniform" ) == 0 )
+			load.distribution = LOAD_DISTRIBUTION_UNIFORM;
+		else if( g_strcmp0( distribution, "sequence" ) == 0 )
+			load.distribution = LOAD_DISTRIBUTION_SEQUENCE;
+		else
+			g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Distribution %s is not supported", distribution );
+	}
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		goto out;
+	}
+
+	if( stand_in )
+	{
+		ret = stand_in_serve( port, delay );
+		goto out;
+	}
+
+	/* if options are not set, set to deafults */
+	if( host == NULL )
+		host = g_strdup( "localhost" );
+	if( database == NULL )
+		database = g_strdup( "*" );
+
+	load.database = database;
+	load.strategy = strategy;
+	load.words = g_ptr_array_new_with_free_func( g_free );
+	if( words_file != NULL )
+		load_read_words( load.words, words_file, &error );
+	else
+		for( i = 0; i < (guint)vocabulary; ++i )
+			g_ptr_array_add( load.words, g_strdup_printf( "word%u", i ) );
+	if( error == NULL && load.distribution == LOAD_DISTRIBUTION_ZIPF )
+		load.cdf = zipf_cdf_new( load.words->len, zipf_exponent );
+	load.requests = g_ptr_array_new_with_free_func( g_free );
+	load.latencies = g_array_new( FALSE, FALSE, sizeof( gint64 ) );
+	load.lateness = g_array_new( FALSE, FALSE, sizeof( gint64 ) );
+
+	load.engine = dict_engine_new();
+	if( pipeline_depth > 0 )
+		dict_engine_set_pipeline_depth( load.engine, pipeline_depth );
+	if( error == NULL )
+		dict_engine_add_server( load.engine, host, port, connections, &error );
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		goto cleanup;
+	}
+
+	start = g_get_monotonic_time();
+	load_run( &load, rate, poisson, duration, drain );
+	elapsed = g_get_monotonic_time() - start;
+
+	g_print( "requests:   %u sent, %u answered, %u failed, %u unanswered\n",
+		load.requests->len, load.requests->len - load.unanswered - load.errors, load.errors, load.unanswered );
+	g_print( "throughput: %.1f requests/s offered, %.1f answered/s\n",
+		rate, ( load.requests->len - load.unanswered ) / ( (gdouble)elapsed / G_USEC_PER_SEC ) );
+	print_percentiles( "latency from due time", load.latencies );
+	print_percentiles( "sending delay of the generator", load.lateness );
+	ret = EXIT_SUCCESS;
+
+cleanup:
+	/* unanswered requests are dropped without callbacks */
+	g_clear_object( &load.engine );
+	g_ptr_array_unref( load.requests );
+	g_ptr_array_unref( load.words );
+	g_free( load.cdf );
+	g_array_unref( load.latencies );
+	g_array_unref( load.lateness );
+
+out:
+	g_free( host );
+	g_free( database );
+	g_free( strategy );
+	g_free( words_file );
+	g_free( distribution );
+
+	return ret;
+}
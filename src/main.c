@@ -7,8 +7,420 @@
 #include <glib/gi18n.h>
 
 #include <locale.h>
+#include <stdio.h>
 
-#define PROGRAM_APP_SUMMARY "This program uses glibdictclient library for testing purpose. Supported commands: define, match, show_databases, show_strategies, show_info, show_server, status, help."
+#define PROGRAM_APP_SUMMARY "This program uses glibdictclient library for testing purpose. Supported commands: define, match, show_databases, show_strategies, show_info, show_server, status, help, session.\n\nThe session command keeps the connection open and reads commands from stdin, one \"COMMAND [WORD]\" per line. Lines \"database NAME\" and \"strategy NAME\" change the options for the following commands, \"quit\" or the end of input closes the session. Output of every command ends with an empty record: an empty line in text format, {} in json format, a record of 0 fields in binary format.\n\nOutput formats: text prints fields one per line for define and tab-separated otherwise; json prints one JSON object per line; binary prints every record as a 32-bit big-endian number of fields followed by the fields, each as a 32-bit big-endian length and the bytes."
+
+enum _OutputFormat
+{
+	OUTPUT_FORMAT_TEXT,
+	OUTPUT_FORMAT_JSON,
+	OUTPUT_FORMAT_BINARY
+};
+typedef enum _OutputFormat OutputFormat;
+
+struct _Output
+{
+	OutputFormat format;
+	const gchar *separator;
+	GString *buffer;
+	guint records;
+};
+typedef struct _Output Output;
+
+static const gchar *define_fields[] = { "word", "database", "description", "definition" };
+static const gchar *match_fields[] = { "database", "word" };
+static const gchar *database_fields[] = { "database", "description" };
+static const gchar *strategy_fields[] = { "strategy", "description" };
+static const gchar *text_fields[] = { "text" };
+
+static void
+json_append_string(
+	GString *buffer,
+	const gchar *string,
+	gsize length )
+{
+	const gchar *s, *end;
+
+	g_string_append_c( buffer, '"' );
+	for( s = string, end = string + length; s < end; ++s )
+	{
+		switch( *s )
+		{
+			case '"':
+				g_string_append( buffer, "\\\"" );
+				break;
+			case '\\':
+				g_string_append( buffer, "\\\\" );
+				break;
+			case '\n':
+				g_string_append( buffer, "\\n" );
+				break;
+			case '\r':
+				g_string_append( buffer, "\\r" );
+				break;
+			case '\t':
+				g_string_append( buffer, "\\t" );
+				break;
+			default:
+				if( (guchar)*s < 0x20 )
+					g_string_append_printf( buffer, "\\u%04x", (guint)(guchar)*s );
+				else
+					g_string_append_c( buffer, *s );
+				break;
+		}
+	}
+	g_string_append_c( buffer, '"' );
+}
+
+static void
+binary_append_length(
+	GString *buffer,
+	guint32 length )
+{
+	length = GUINT32_TO_BE( length );
+	g_string_append_len( buffer, (const gchar*)&length, sizeof( length ) );
+}
+
+/* prints a record of n fields, a length of -1 means a NUL-terminated value */
+static void
+output_record(
+	Output *output,
+	guint n,
+	const gchar **names,
+	const gchar **values,
+	const gssize *lengths )
+{
+	gsize length;
+	guint i;
+
+	g_string_truncate( output->buffer, 0 );
+	if( output->format == OUTPUT_FORMAT_JSON )
+		g_string_append_c( output->buffer, '{' );
+	else if( output->format == OUTPUT_FORMAT_BINARY )
+		binary_append_length( output->buffer, n );
+
+	for( i = 0; i < n; ++i )
+	{
+		length = ( lengths == NULL || lengths[i] < 0 ) ? strlen( values[i] ) : (gsize)lengths[i];
+
+		switch( output->format )
+		{
+			case OUTPUT_FORMAT_TEXT:
+				if( i > 0 )
+					g_string_append( output->buffer, output->separator );
+				g_string_append_len( output->buffer, values[i], length );
+				break;
+
+			case OUTPUT_FORMAT_JSON:
+				if( i > 0 )
+					g_string_append_c( output->buffer, ',' );
+				json_append_string( output->buffer, names[i], strlen( names[i] ) );
+				g_string_append_c( output->buffer, ':' );
+				json_append_string( output->buffer, values[i], length );
+				break;
+
+			case OUTPUT_FORMAT_BINARY:
+				binary_append_length( output->buffer, length );
+				g_string_append_len( output->buffer, values[i], length );
+				break;
+		}
+	}
+
+	if( output->format == OUTPUT_FORMAT_JSON )
+		g_string_append_c( output->buffer, '}' );
+	if( output->format != OUTPUT_FORMAT_BINARY )
+		g_string_append_c( output->buffer, '\n' );
+
+	fwrite( output->buffer->str, 1, output->buffer->len, stdout );
+	output->records++;
+}
+
+/* prints pairs of arrays, one record for each pair */
+static void
+output_pairs(
+	Output *output,
+	const gchar **names,
+	glong number,
+	GStrv first,
+	GStrv second )
+{
+	const gchar *values[2];
+	glong i;
+
+	for( i = 0; i < number; ++i )
+	{
+		values[0] = first[i];
+		values[1] = second[i];
+		output_record( output, 2, names, values, NULL );
+	}
+}
+
+static void
+output_text(
+	Output *output,
+	const gchar *text )
+{
+	output_record( output, 1, text_fields, &text, NULL );
+}
+
+/* definitions are printed as they are received */
+static void
+on_definition(
+	DictClient *client,
+	const gchar *word,
+	const gchar *database,
+	const gchar *description,
+	const gchar *definition,
+	gsize length,
+	gpointer user_data )
+{
+	const gchar *values[4] = { word, database, description, definition };
+	const gssize lengths[4] = { -1, -1, -1, (gssize)length };
+
+	output_record( user_data, 4, define_fields, values, lengths );
+}
+
+static void
+on_match(
+	DictClient *client,
+	const gchar *database,
+	const gchar *word,
+	gpointer user_data )
+{
+	const gchar *values[2] = { database, word };
+
+	output_record( user_data, 2, match_fields, values, NULL );
+}
+
+/* runs a single command, the word may be NULL for commands without it */
+static gboolean
+run_command(
+	DictClient *dc,
+	Output *output,
+	const gchar *command,
+	const gchar *word,
+	const gchar *database,
+	const gchar *strategy,
+	GError **error )
+{
+	gchar *info = NULL;
+	GStrv data, descriptions;
+	glong num;
+	GError *loc_error = NULL;
+
+	if( ( g_strcmp0( command, "define" ) == 0 || g_strcmp0( command, "match" ) == 0 ) && word == NULL )
+	{
+		g_set_error(
+			error,
+			G_OPTION_ERROR,
+			G_OPTION_ERROR_BAD_VALUE,
+			"No WORD for command %s",
+			command );
+		return FALSE;
+	}
+
+	if( g_strcmp0( command, "define" ) == 0 )
+	{
+		output->separator = "\n";
+		num = dict_client_define_foreach( dc, database, word, on_definition, output, &loc_error );
+		output->separator = "\t";
+
+		/* the word is not found, print what the server suggests instead */
+		if( num == 0 && ( num = dict_client_get_suggestions( dc, &data, &descriptions ) ) > 0 )
+		{
+			output_pairs( output, match_fields, num, data, descriptions );
+			g_strfreev( data );
+			g_strfreev( descriptions );
+		}
+	}
+	else if( g_strcmp0( command, "match" ) == 0 )
+		dict_client_match_foreach( dc, database, strategy, word, on_match, output, &loc_error );
+	else if( g_strcmp0( command, "show_databases" ) == 0 )
+	{
+		num = dict_client_show_databases( dc, &data, &descriptions, &loc_error );
+		if( loc_error == NULL )
+		{
+			output_pairs( output, database_fields, num, data, descriptions );
+			g_strfreev( data );
+			g_strfreev( descriptions );
+		}
+	}
+	else if( g_strcmp0( command, "show_strategies" ) == 0 )
+	{
+		num = dict_client_show_strategies( dc, &data, &descriptions, &loc_error );
+		if( loc_error == NULL )
+		{
+			output_pairs( output, strategy_fields, num, data, descriptions );
+			g_strfreev( data );
+			g_strfreev( descriptions );
+		}
+	}
+	else if( g_strcmp0( command, "show_info" ) == 0 )
+		info = dict_client_show_info( dc, database, &loc_error );
+	else if( g_strcmp0( command, "show_server" ) == 0 )
+		info = dict_client_show_server( dc, &loc_error );
+	else if( g_strcmp0( command, "status" ) == 0 )
+		info = dict_client_status( dc, &loc_error );
+	else if( g_strcmp0( command, "help" ) == 0 )
+		info = dict_client_help( dc, &loc_error );
+	else
+	{
+		g_set_error(
+			error,
+			G_OPTION_ERROR,
+			G_OPTION_ERROR_BAD_VALUE,
+			"Command %s is not supported",
+			command );
+		return FALSE;
+	}
+
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	if( info != NULL )
+	{
+		output_text( output, info );
+		g_free( info );
+	}
+
+	return TRUE;
+}
+
+/* a socket path takes the place of the host, there are no Unix domain sockets elsewhere */
+static gboolean
+client_connect(
+	DictClient *dc,
+	const gchar *host,
+	guint16 port,
+	const gchar *socket_path,
+	const gchar *greeting,
+	gchar **response,
+	GError **error )
+{
+#ifdef G_OS_UNIX
+	GSocketAddress *address;
+	gboolean ret;
+
+	if( socket_path != NULL )
+	{
+		address = g_unix_socket_address_new( socket_path );
+		ret = dict_client_connect_address( dc, address, greeting, response, error );
+		g_object_unref( address );
+
+		return ret;
+	}
+#endif
+
+	return dict_client_connect( dc, host, port, greeting, response, error );
+}
+
+/*
+Reads commands from stdin line by line and runs them through one connection.
+A line holds a command and an optional word, which is the rest of the line.
+"database NAME" and "strategy NAME" change the defaults for the following commands, "quit" ends the session.
+Output of every command ends with an empty record and is flushed, so a co-process knows when to stop reading.
+*/
+static void
+run_session(
+	DictClient *dc,
+	Output *output,
+	const gchar *host,
+	guint16 port,
+	const gchar *socket_path,
+	const gchar *greeting,
+	const gchar *database,
+	const gchar *strategy,
+	GError **error )
+{
+	GIOChannel *channel;
+	GIOStatus status;
+	gchar *line, *command, *word, *loc_database, *loc_strategy;
+	gsize terminator;
+	guint records;
+	GError *loc_error = NULL;
+
+	loc_database = g_strdup( database );
+	loc_strategy = g_strdup( strategy );
+
+#ifdef G_OS_UNIX
+	channel = g_io_channel_unix_new( fileno( stdin ) );
+#else
+	channel = g_io_channel_win32_new_fd( fileno( stdin ) );
+#endif
+	while( ( status = g_io_channel_read_line( channel, &line, NULL, &terminator, &loc_error ) ) == G_IO_STATUS_NORMAL )
+	{
+		line[terminator] = '\0';
+		command = g_strstrip( line );
+		word = strpbrk( command, " \t" );
+		if( word != NULL )
+		{
+			*word = '\0';
+			word = g_strchug( word + 1 );
+			if( *word == '\0' )
+				word = NULL;
+		}
+
+		if( *command == '\0' )
+		{
+			g_free( line );
+			continue;
+		}
+		if( g_strcmp0( command, "quit" ) == 0 )
+		{
+			g_free( line );
+			break;
+		}
+
+		if( g_strcmp0( command, "database" ) == 0 && word != NULL )
+		{
+			g_free( loc_database );
+			loc_database = g_strdup( word );
+		}
+		else if( g_strcmp0( command, "strategy" ) == 0 && word != NULL )
+		{
+			g_free( loc_strategy );
+			loc_strategy = g_strdup( word );
+		}
+		else
+		{
+			/* servers close idle connections, a command that printed nothing is sent again through a new one */
+			records = output->records;
+			if( !dict_client_is_connected( dc ) || !run_command( dc, output, command, word, loc_database, loc_strategy, &loc_error ) )
+			{
+				if( loc_error == NULL || ( dict_client_error_is_connection( loc_error ) && output->records == records ) )
+				{
+					g_clear_error( &loc_error );
+					if( dict_client_is_connected( dc ) )
+						dict_client_disconnect( dc, NULL, NULL );
+					if( client_connect( dc, host, port, socket_path, greeting, NULL, &loc_error ) )
+						run_command( dc, output, command, word, loc_database, loc_strategy, &loc_error );
+				}
+			}
+			if( loc_error != NULL )
+			{
+				g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+					"MESSAGE", loc_error->message,
+					NULL );
+				g_clear_error( &loc_error );
+			}
+		}
+
+		output_record( output, 0, NULL, NULL, NULL );
+		fflush( stdout );
+		g_free( line );
+	}
+	g_io_channel_unref( channel );
+
+	if( status == G_IO_STATUS_ERROR )
+		g_propagate_error( error, loc_error );
+
+	g_free( loc_database );
+	g_free( loc_strategy );
+}
 
 int
 main(
@@ -21,22 +433,37 @@ main(
 	gchar *database = NULL;
 	gchar *greeting = NULL;
 	gboolean response_set = FALSE;
+	gchar *format = NULL;
+	gint slow_threshold = 0;
+	gint text_limit = 0;
+	gint fan_out = 0;
+	gchar *suggest = NULL;
+	gchar *socket_path = NULL;
+	gchar *capture = NULL;
 	const GOptionEntry option_entries[] =
 	{
 		{ "host", 'h', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &host, "A host address, may include port number. Default is localhost", "HOST" },
 		{ "port", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &port, "A port number of the host. Default is 2628.", "PORT" },
+#ifdef G_OS_UNIX
+		{ "socket", 'u', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &socket_path, "A Unix domain socket of the server, used instead of the host and the port.", "PATH" },
+#endif
 		{ "strategy", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &strategy, "A strategy to match word. Check show_strategies for examples. Default is prefix.", "STRATEGY" },
 		{ "database", 'd', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &database, "A database name. Check show_databases for database names. Default is *.", "DATABASE" },
 		{ "greeting", 'g', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &greeting, "An optional message to be sent to the server on connection.", "MESSAGE" },
 		{ "response-set", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &response_set, "If set, response messages from the server on connection and disconnection will be printed.", NULL },
+		{ "format", 'f', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &format, "An output format: text, json or binary. Default is text.", "FORMAT" },
+		{ "slow-threshold", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &slow_threshold, "If set, requests taking longer than MS milliseconds will be logged with their phase times.", "MS" },
+		{ "text-limit", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &text_limit, "If set, texts longer than BYTES will not be held in memory: definitions go through a temporary file, other texts are refused.", "BYTES" },
+		{ "fan-out", 'o', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &fan_out, "If set, a definition in all databases will be looked up in every database at once through NUMBER extra connections.", "NUMBER" },
+		{ "suggest", 'S', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &suggest, "If set, words matched by the STRATEGY will be printed for a word which is not defined, the match is sent together with the definition.", "STRATEGY" },
+		{ "capture", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &capture, "A file every byte sent and received will be appended to, it may be served back by glib-dict-replay.", "FILE" },
 		{ NULL }
 	};
 
 	GOptionContext *option_context;
-	gchar *help_message, *command, *info, *word, *response;
+	gchar *help_message, *command, *response;
 	DictClient *dc;
-	glong i, num;
-	GStrv databases, words, strategies, descriptions, definitions;
+	Output output;
 	gint ret = EXIT_SUCCESS;
 	GError *error = NULL;
 
@@ -78,12 +505,45 @@ main(
 	if( strategy == NULL )
 		strategy = g_strdup( "prefix" );
 
+	output.separator = "\t";
+	output.buffer = g_string_new( NULL );
+	output.records = 0;
+	if( format == NULL || g_strcmp0( format, "text" ) == 0 )
+		output.format = OUTPUT_FORMAT_TEXT;
+	else if( g_strcmp0( format, "json" ) == 0 )
+		output.format = OUTPUT_FORMAT_JSON;
+	else if( g_strcmp0( format, "binary" ) == 0 )
+		output.format = OUTPUT_FORMAT_BINARY;
+	else
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", "Output format %s is not supported", format,
+			NULL );
+		g_free( host );
+		g_free( database );
+		g_free( strategy );
+		g_free( format );
+		g_free( capture );
+		g_free( suggest );
+		g_free( socket_path );
+		g_string_free( output.buffer, TRUE );
+		return EXIT_FAILURE;
+	}
+
 	/* store command */
 	command = argv[1];
 
 	/* connect to the server */
 	dc = dict_client_new();
-	dict_client_connect( dc, host, port, greeting, &response, &error );
+	if( slow_threshold > 0 )
+		dict_client_set_slow_threshold( dc, slow_threshold );
+	if( text_limit > 0 )
+		dict_client_set_text_limit( dc, text_limit );
+	if( fan_out > 0 )
+		dict_client_set_fan_out( dc, fan_out );
+	dict_client_set_suggest_strategy( dc, suggest );
+	dict_client_set_capture_file( dc, capture );
+	client_connect( dc, host, port, socket_path, greeting, &response, &error );
 	if( error != NULL )
 	{
 		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
@@ -98,183 +558,29 @@ main(
 	g_free( response );
 
 	/* perform commands */
-	if( g_strcmp0( command, "define" ) == 0 )
-	{
-		if( argc < 3 )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", "No WORD for command %s", command,
-				NULL );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		word = argv[2];
-
-		num = dict_client_define( dc, database, word, &words, &databases, &descriptions, &definitions, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		for( i = 0; i < num; ++i )
-			g_print( "%s\n%s\n%s\n%s\n", words[i], databases[i], descriptions[i], definitions[i] );
-		g_strfreev( words );
-		g_strfreev( databases );
-		g_strfreev( descriptions );
-		g_strfreev( definitions );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "match" ) == 0 )
-	{
-		if( argc < 3 )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", "No WORD for command %s", command,
-				NULL );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		word = argv[2];
-
-		num = dict_client_match( dc, database, strategy, word, &databases, &words, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		for( i = 0; i < num; ++i )
-			g_print( "%s\t%s\n", databases[i], words[i] );
-		g_strfreev( databases );
-		g_strfreev( words );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "show_databases" ) == 0 )
-	{
-		num = dict_client_show_databases( dc, &databases, &descriptions, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		for( i = 0; i < num; ++i )
-			g_print( "%s\t%s\n", databases[i], descriptions[i] );
-		g_strfreev( databases );
-		g_strfreev( descriptions );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "show_strategies" ) == 0 )
-	{
-		num = dict_client_show_strategies( dc, &strategies, &descriptions, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		for( i = 0; i < num; ++i )
-			g_print( "%s\t%s\n", strategies[i], descriptions[i] );
-		g_strfreev( strategies );
-		g_strfreev( descriptions );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "show_info" ) == 0 )
-	{
-		info = dict_client_show_info( dc, database, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		g_print( "%s\n", info );
-		g_free( info );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "show_server" ) == 0 )
-	{
-		info = dict_client_show_server( dc, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		g_print( "%s\n", info );
-		g_free( info );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "status" ) == 0 )
-	{
-		info = dict_client_status( dc, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		g_print( "%s\n", info );
-		g_free( info );
-		goto out;
-	}
-
-	if( g_strcmp0( command, "help" ) == 0 )
+	if( g_strcmp0( command, "session" ) == 0 )
+		run_session( dc, &output, host, port, socket_path, greeting, database, strategy, &error );
+	else
+		run_command( dc, &output, command, argc < 3 ? NULL : argv[2], database, strategy, &error );
+	if( error != NULL )
 	{
-		info = dict_client_help( dc, &error );
-		if( error != NULL )
-		{
-			g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-				"MESSAGE", error->message,
-				NULL );
-			g_clear_error( &error );
-			ret = EXIT_FAILURE;
-			goto out;
-		}
-		g_print( "%s\n", info );
-		g_free( info );
-		goto out;
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		ret = EXIT_FAILURE;
 	}
 
-	/* print error, if the command is not supported */
-	g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
-		"MESSAGE", "Command %s is not supported", command,
-		NULL );
-	ret = EXIT_FAILURE;
-
 out:
 	/* free options */
 	g_free( host );
 	g_free( database );
 	g_free( strategy );
+	g_free( format );
+	g_free( capture );
+	g_free( suggest );
+	g_free( socket_path );
+	g_string_free( output.buffer, TRUE );
 
 	/* disconnet from the server */
 	dict_client_disconnect( dc, &response, &error );
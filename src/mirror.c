@@ -0,0 +1,824 @@
+#include "config.h"
+
+#include "lib/glibdictclient.h"
+#include "lib/glibdictengine.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <locale.h>
+#include <string.h>
+#include <zlib.h>
+
+#define MIRROR_APP_SUMMARY "This program exports a database of a dict server to local dictd files OUTPUT.index and OUTPUT.dict.dz. An interrupted export is resumed from OUTPUT.journal."
+
+#define DEFAULT_CONNECTIONS 4
+#define DEFAULT_PIPELINE_DEPTH 8
+#define PROGRESS_STEP 1000
+
+/* chunks are compressed separately, a compressed chunk must fit 16 bits */
+#define DICTZIP_CHUNK_LEN 58315
+#define DICTZIP_MAX_CHUNKS ( ( G_MAXUINT16 - 10 ) / 2 )
+#define DICTZIP_OUT_LEN ( G_MAXUINT16 + 1 )
+
+struct _MirrorEntry
+{
+	gchar *headword;
+	guint64 offset;
+	guint64 length;
+};
+typedef struct _MirrorEntry MirrorEntry;
+
+struct _Mirror
+{
+	DictEngine *engine;
+	gchar *database;
+
+	/* definitions are appended to the data file, the journal records what is written */
+	GIOStream *data;
+	guint64 data_end;
+	GOutputStream *journal;
+	GString *journal_lines;
+
+	GPtrArray *entries;
+	GHashTable *done;
+
+	GStrv headwords;
+	guint next;
+	guint in_flight;
+	guint max_in_flight;
+	guint n_done;
+	guint n_failed;
+
+	/* the first write error stops the export */
+	GError *error;
+};
+typedef struct _Mirror Mirror;
+
+struct _MirrorRequest
+{
+	Mirror *mirror;
+	gchar *word;
+};
+typedef struct _MirrorRequest MirrorRequest;
+
+static void mirror_feed( Mirror *mirror );
+
+static void
+mirror_entry_free(
+	MirrorEntry *entry )
+{
+	g_free( entry->headword );
+	g_free( entry );
+}
+
+static MirrorEntry*
+mirror_entry_new(
+	const gchar *headword,
+	guint64 offset,
+	guint64 length )
+{
+	MirrorEntry *entry;
+
+	entry = g_new( MirrorEntry, 1 );
+	entry->headword = g_strdup( headword );
+	entry->offset = offset;
+	entry->length = length;
+
+	return entry;
+}
+
+/* tabs and line breaks would break the index */
+static gchar*
+sanitize_word(
+	const gchar *word )
+{
+	gchar *s, *ret;
+
+	ret = g_strdup( word );
+	for( s = ret; *s != '\0'; ++s )
+		if( *s == '\t' || *s == '\n' || *s == '\r' )
+			*s = ' ';
+
+	return ret;
+}
+
+/* numbers in dictd index files are written in base64 without padding */
+static void
+append_b64(
+	GString *string,
+	guint64 value )
+{
+	static const gchar digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	gchar buf[12];
+	gint i = sizeof( buf );
+
+	do
+	{
+		buf[--i] = digits[value & 0x3f];
+		value >>= 6;
+	}
+	while( value != 0 );
+
+	g_string_append_len( string, buf + i, sizeof( buf ) - i );
+}
+
+/* dictd looks headwords up in "sort -df" order: only letters, digits and blanks count, case is ignored */
+static gboolean
+index_significant(
+	guchar c )
+{
+	return c >= 0x80 || g_ascii_isalnum( c ) || c == ' ';
+}
+
+static gint
+index_compare(
+	gconstpointer a,
+	gconstpointer b )
+{
+	const guchar *x = (const guchar*)( *(MirrorEntry**)a )->headword;
+	const guchar *y = (const guchar*)( *(MirrorEntry**)b )->headword;
+	const guchar *s = x, *t = y;
+
+	while( *s == ' ' )
+		++s;
+	while( *t == ' ' )
+		++t;
+
+	while( TRUE )
+	{
+		while( *s != '\0' && !index_significant( *s ) )
+			++s;
+		while( *t != '\0' && !index_significant( *t ) )
+			++t;
+
+		if( *s == '\0' || *t == '\0' || g_ascii_toupper( *s ) != g_ascii_toupper( *t ) )
+			break;
+		++s;
+		++t;
+	}
+
+	if( *s != '\0' || *t != '\0' )
+		return ( *s == '\0' ? 0 : g_ascii_toupper( *s ) ) - ( *t == '\0' ? 0 : g_ascii_toupper( *t ) );
+
+	return strcmp( (const gchar*)x, (const gchar*)y );
+}
+
+/*
+Reads the journal of an interrupted export.
+Entries count only if the word they belong to is marked done, so a partly written word is fetched again.
+*/
+static gboolean
+mirror_load_journal(
+	Mirror *mirror,
+	const gchar *path,
+	GError **error )
+{
+	gchar *contents, *line, *eol;
+	gchar **fields;
+	GPtrArray *pending;
+	MirrorEntry *entry;
+	gsize length;
+	guint i;
+	GError *loc_error = NULL;
+
+	if( !g_file_get_contents( path, &contents, &length, &loc_error ) )
+	{
+		if( g_error_matches( loc_error, G_FILE_ERROR, G_FILE_ERROR_NOENT ) )
+		{
+			g_error_free( loc_error );
+			return FALSE;
+		}
+
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	pending = g_ptr_array_new_with_free_func( (GDestroyNotify)mirror_entry_free );
+	for( line = contents; ( eol = memchr( line, '\n', contents + length - line ) ) != NULL; line = eol + 1 )
+	{
+		*eol = '\0';
+		fields = g_strsplit( line, "\t", 4 );
+
+		if( g_strcmp0( fields[0], "E" ) == 0 && g_strv_length( fields ) == 4 )
+		{
+			g_ptr_array_add( pending, mirror_entry_new( fields[1], g_ascii_strtoull( fields[2], NULL, 10 ), g_ascii_strtoull( fields[3], NULL, 10 ) ) );
+		}
+		else if( g_strcmp0( fields[0], "D" ) == 0 && g_strv_length( fields ) == 2 )
+		{
+			for( i = 0; i < pending->len; ++i )
+			{
+				entry = g_ptr_array_index( pending, i );
+				mirror->data_end = MAX( mirror->data_end, entry->offset + entry->length );
+			}
+			g_ptr_array_extend_and_steal( mirror->entries, pending );
+			pending = g_ptr_array_new_with_free_func( (GDestroyNotify)mirror_entry_free );
+
+			g_hash_table_add( mirror->done, g_strdup( fields[1] ) );
+		}
+
+		g_strfreev( fields );
+	}
+
+	g_ptr_array_unref( pending );
+	g_free( contents );
+
+	return TRUE;
+}
+
+/* opens the data file, data past the last complete word is dropped */
+static gboolean
+mirror_open(
+	Mirror *mirror,
+	const gchar *output,
+	GError **error )
+{
+	gchar *path;
+	GFile *file;
+	gboolean resume;
+	GError *loc_error = NULL;
+
+	path = g_strconcat( output, ".journal", NULL );
+	resume = mirror_load_journal( mirror, path, &loc_error );
+	if( loc_error == NULL )
+	{
+		file = g_file_new_for_path( path );
+		mirror->journal = G_OUTPUT_STREAM( g_file_append_to( file, G_FILE_CREATE_NONE, NULL, &loc_error ) );
+		g_object_unref( file );
+	}
+	g_free( path );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	path = g_strconcat( output, ".dict.part", NULL );
+	file = g_file_new_for_path( path );
+	g_free( path );
+
+	if( resume )
+	{
+		mirror->data = G_IO_STREAM( g_file_open_readwrite( file, NULL, &loc_error ) );
+		if( loc_error == NULL )
+			g_seekable_truncate( G_SEEKABLE( mirror->data ), mirror->data_end, NULL, &loc_error );
+		if( loc_error == NULL )
+			g_seekable_seek( G_SEEKABLE( mirror->data ), 0, G_SEEK_END, NULL, &loc_error );
+	}
+	else
+		mirror->data = G_IO_STREAM( g_file_replace_readwrite( file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &loc_error ) );
+	g_object_unref( file );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* appends a definition to the data file and records it in the journal lines */
+static gboolean
+mirror_write_entry(
+	Mirror *mirror,
+	const gchar *headword,
+	const gchar *text,
+	GError **error )
+{
+	GOutputStream *output;
+	gchar *word;
+	gsize length;
+
+	output = g_io_stream_get_output_stream( mirror->data );
+	length = strlen( text );
+	if( !g_output_stream_write_all( output, text, length, NULL, NULL, error ) ||
+		!g_output_stream_write_all( output, "\n", 1, NULL, NULL, error ) )
+		return FALSE;
+
+	word = sanitize_word( headword );
+	g_ptr_array_add( mirror->entries, mirror_entry_new( word, mirror->data_end, length + 1 ) );
+	g_string_append_printf( mirror->journal_lines, "E\t%s\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\n", word, mirror->data_end, (guint64)( length + 1 ) );
+	g_free( word );
+	mirror->data_end += length + 1;
+
+	return TRUE;
+}
+
+static void
+on_define(
+	DictEngine *engine,
+	glong number,
+	GStrv words,
+	GStrv databases,
+	GStrv descriptions,
+	GStrv definitions,
+	const GError *error,
+	gpointer user_data )
+{
+	MirrorRequest *request = user_data;
+	Mirror *mirror = request->mirror;
+	glong i;
+	GError *loc_error = NULL;
+
+	mirror->in_flight--;
+
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", "Can not define %s: %s", request->word, error->message,
+			NULL );
+
+		/* a 5xx refusal would be the same on the next run, the word is skipped; 4xx ones are temporary and the word is asked again */
+		if( error->domain != DICT_CLIENT_ERROR || error->code < DICT_CLIENT_ERROR_SYNTAX_ERROR_COMMAND_NOT_RECOGNIZED || error->code >= DICT_CLIENT_ERROR_CONNECTION_ALREADY_EXISTS )
+		{
+			mirror->n_failed++;
+			goto out;
+		}
+	}
+	if( mirror->error != NULL )
+		goto out;
+
+	/* the data is written before the journal refers to it */
+	for( i = 0; i < number && loc_error == NULL; ++i )
+		mirror_write_entry( mirror, words[i], definitions[i], &loc_error );
+	if( loc_error == NULL )
+		g_output_stream_flush( g_io_stream_get_output_stream( mirror->data ), NULL, &loc_error );
+
+	g_string_append_printf( mirror->journal_lines, "D\t%s\n", request->word );
+	if( loc_error == NULL )
+		g_output_stream_write_all( mirror->journal, mirror->journal_lines->str, mirror->journal_lines->len, NULL, NULL, &loc_error );
+	if( loc_error == NULL )
+		g_output_stream_flush( mirror->journal, NULL, &loc_error );
+	g_string_truncate( mirror->journal_lines, 0 );
+
+	if( loc_error != NULL )
+	{
+		g_propagate_error( &mirror->error, loc_error );
+		goto out;
+	}
+
+	if( ++mirror->n_done % PROGRESS_STEP == 0 )
+		g_printerr( "%u/%u\n", mirror->n_done, g_strv_length( mirror->headwords ) );
+
+out:
+	g_strfreev( words );
+	g_strfreev( databases );
+	g_strfreev( descriptions );
+	g_strfreev( definitions );
+	g_free( request->word );
+	g_free( request );
+
+	mirror_feed( mirror );
+}
+
+/* keeps enough requests queued to fill all pipelines, without queueing the whole database */
+static void
+mirror_feed(
+	Mirror *mirror )
+{
+	MirrorRequest *request;
+	gchar *word;
+
+	while( mirror->error == NULL && mirror->in_flight < mirror->max_in_flight && mirror->headwords[mirror->next] != NULL )
+	{
+		word = sanitize_word( mirror->headwords[mirror->next++] );
+		if( g_hash_table_contains( mirror->done, word ) )
+		{
+			mirror->n_done++;
+			g_free( word );
+			continue;
+		}
+
+		request = g_new( MirrorRequest, 1 );
+		request->mirror = mirror;
+		request->word = word;
+		dict_engine_define( mirror->engine, mirror->database, word, on_define, request );
+		mirror->in_flight++;
+	}
+}
+
+/* MATCH may return a headword once for every spelling, DEFINE returns all of them at once */
+static GStrv
+unique_headwords(
+	GStrv words )
+{
+	GHashTable *seen;
+	GPtrArray *unique;
+	gchar *folded;
+	guint i;
+
+	seen = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, NULL );
+	unique = g_ptr_array_new();
+	for( i = 0; words != NULL && words[i] != NULL; ++i )
+	{
+		folded = g_utf8_casefold( words[i], -1 );
+		if( g_hash_table_add( seen, folded ) )
+			g_ptr_array_add( unique, g_strdup( words[i] ) );
+	}
+	g_ptr_array_add( unique, NULL );
+	g_hash_table_unref( seen );
+
+	return (GStrv)g_ptr_array_free( unique, FALSE );
+}
+
+static gboolean
+write_index(
+	GPtrArray *entries,
+	const gchar *path,
+	GError **error )
+{
+	MirrorEntry *entry;
+	GString *index;
+	gboolean ret;
+	guint i;
+
+	g_ptr_array_sort( entries, index_compare );
+
+	index = g_string_new( NULL );
+	for( i = 0; i < entries->len; ++i )
+	{
+		entry = g_ptr_array_index( entries, i );
+		g_string_append( index, entry->headword );
+		g_string_append_c( index, '\t' );
+		append_b64( index, entry->offset );
+		g_string_append_c( index, '\t' );
+		append_b64( index, entry->length );
+		g_string_append_c( index, '\n' );
+	}
+
+	ret = g_file_set_contents( path, index->str, index->len, error );
+	g_string_free( index, TRUE );
+
+	return ret;
+}
+
+static void
+put_uint16(
+	GByteArray *array,
+	guint16 value )
+{
+	guint8 bytes[2] = { value & 0xff, value >> 8 };
+
+	g_byte_array_append( array, bytes, 2 );
+}
+
+static void
+put_uint32(
+	GByteArray *array,
+	guint32 value )
+{
+	put_uint16( array, value & 0xffff );
+	put_uint16( array, value >> 16 );
+}
+
+/*
+Writes the data in the dictzip format: a gzip file whose deflate stream is flushed every DICTZIP_CHUNK_LEN bytes.
+Sizes of the compressed chunks are kept in the "RA" extra field, so dictd decompresses only the chunks it needs.
+*/
+static gboolean
+write_dictzip(
+	const gchar *data,
+	gsize length,
+	const gchar *path,
+	GError **error )
+{
+	z_stream stream;
+	GByteArray *header, *body;
+	guint8 *out;
+	guint16 *sizes;
+	guint32 crc;
+	gsize i, n_chunks, chunk;
+	gboolean ret;
+
+	n_chunks = ( length + DICTZIP_CHUNK_LEN - 1 ) / DICTZIP_CHUNK_LEN;
+	if( n_chunks > DICTZIP_MAX_CHUNKS )
+	{
+		g_set_error(
+			error,
+			G_IO_ERROR,
+			G_IO_ERROR_NOT_SUPPORTED,
+			"Data of %" G_GSIZE_FORMAT " bytes is too large for dictzip",
+			length );
+		return FALSE;
+	}
+
+	memset( &stream, 0, sizeof( stream ) );
+	if( deflateInit2( &stream, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY ) != Z_OK )
+	{
+		g_set_error(
+			error,
+			G_IO_ERROR,
+			G_IO_ERROR_FAILED,
+			"Can not initialize compression" );
+		return FALSE;
+	}
+
+	out = g_malloc( DICTZIP_OUT_LEN );
+	sizes = g_new( guint16, MAX( n_chunks, 1 ) );
+	body = g_byte_array_new();
+	crc = crc32( 0, NULL, 0 );
+	ret = TRUE;
+
+	for( i = 0; i < n_chunks && ret; ++i )
+	{
+		chunk = MIN( DICTZIP_CHUNK_LEN, length - i * DICTZIP_CHUNK_LEN );
+		crc = crc32( crc, (const Bytef*)data + i * DICTZIP_CHUNK_LEN, chunk );
+
+		stream.next_in = (Bytef*)data + i * DICTZIP_CHUNK_LEN;
+		stream.avail_in = chunk;
+		stream.next_out = out;
+		stream.avail_out = DICTZIP_OUT_LEN;
+		if( deflate( &stream, Z_FULL_FLUSH ) != Z_OK || stream.avail_in != 0 || DICTZIP_OUT_LEN - stream.avail_out > G_MAXUINT16 )
+			ret = FALSE;
+
+		sizes[i] = DICTZIP_OUT_LEN - stream.avail_out;
+		g_byte_array_append( body, out, sizes[i] );
+	}
+
+	/* the end of the stream is not a part of any chunk */
+	stream.avail_in = 0;
+	stream.next_out = out;
+	stream.avail_out = DICTZIP_OUT_LEN;
+	if( ret && deflate( &stream, Z_FINISH ) != Z_STREAM_END )
+		ret = FALSE;
+	g_byte_array_append( body, out, DICTZIP_OUT_LEN - stream.avail_out );
+	deflateEnd( &stream );
+	g_free( out );
+
+	if( !ret )
+	{
+		g_set_error(
+			error,
+			G_IO_ERROR,
+			G_IO_ERROR_FAILED,
+			"Can not compress data" );
+		g_byte_array_unref( body );
+		g_free( sizes );
+		return FALSE;
+	}
+
+	/* gzip header with FEXTRA flag, maximum compression, Unix */
+	header = g_byte_array_new();
+	g_byte_array_append( header, (const guint8*)"\x1f\x8b\x08\x04", 4 );
+	put_uint32( header, (guint32)( g_get_real_time() / G_USEC_PER_SEC ) );
+	g_byte_array_append( header, (const guint8*)"\x02\x03", 2 );
+	put_uint16( header, 10 + 2 * n_chunks );
+	g_byte_array_append( header, (const guint8*)"RA", 2 );
+	put_uint16( header, 6 + 2 * n_chunks );
+	put_uint16( header, 1 );
+	put_uint16( header, DICTZIP_CHUNK_LEN );
+	put_uint16( header, n_chunks );
+	for( i = 0; i < n_chunks; ++i )
+		put_uint16( header, sizes[i] );
+	g_free( sizes );
+
+	g_byte_array_append( header, body->data, body->len );
+	g_byte_array_unref( body );
+	put_uint32( header, crc );
+	put_uint32( header, (guint32)length );
+
+	ret = g_file_set_contents( path, (const gchar*)header->data, header->len, error );
+	g_byte_array_unref( header );
+
+	return ret;
+}
+
+/* adds the database description, the source and the encoding as dictd special entries, then writes the index and the compressed data */
+static gboolean
+mirror_finish(
+	Mirror *mirror,
+	const gchar *output,
+	const gchar *url,
+	const gchar *description,
+	const gchar *info,
+	GError **error )
+{
+	GMappedFile *mapped;
+	gchar *path;
+	const gchar *data;
+	gsize length, i;
+	gboolean utf8 = FALSE;
+	GError *loc_error = NULL;
+
+	path = g_strconcat( output, ".dict.part", NULL );
+
+	mapped = g_mapped_file_new( path, FALSE, &loc_error );
+	if( mapped != NULL )
+	{
+		data = g_mapped_file_get_contents( mapped );
+		length = g_mapped_file_get_length( mapped );
+		for( i = 0; i < length && !utf8; ++i )
+			utf8 = (guchar)data[i] >= 0x80;
+		g_mapped_file_unref( mapped );
+	}
+
+	if( loc_error == NULL && utf8 )
+		mirror_write_entry( mirror, "00-database-utf8", "", &loc_error );
+	if( loc_error == NULL && description != NULL )
+		mirror_write_entry( mirror, "00-database-short", description, &loc_error );
+	if( loc_error == NULL && info != NULL )
+		mirror_write_entry( mirror, "00-database-info", info, &loc_error );
+	if( loc_error == NULL )
+		mirror_write_entry( mirror, "00-database-url", url, &loc_error );
+	if( loc_error == NULL )
+		g_io_stream_close( mirror->data, NULL, &loc_error );
+	if( loc_error != NULL )
+	{
+		g_free( path );
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	mapped = g_mapped_file_new( path, FALSE, &loc_error );
+	if( mapped != NULL )
+	{
+		g_free( path );
+		path = g_strconcat( output, ".dict.dz", NULL );
+		write_dictzip( g_mapped_file_get_contents( mapped ), g_mapped_file_get_length( mapped ), path, &loc_error );
+		g_mapped_file_unref( mapped );
+	}
+	g_free( path );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	path = g_strconcat( output, ".index", NULL );
+	write_index( mirror->entries, path, &loc_error );
+	g_free( path );
+	if( loc_error != NULL )
+	{
+		g_propagate_error( error, loc_error );
+		return FALSE;
+	}
+
+	/* the export is complete, there is nothing to resume */
+	path = g_strconcat( output, ".dict.part", NULL );
+	g_remove( path );
+	g_free( path );
+	path = g_strconcat( output, ".journal", NULL );
+	g_remove( path );
+	g_free( path );
+
+	return TRUE;
+}
+
+int
+main(
+	int argc,
+	char *argv[] )
+{
+	gchar *host = NULL;
+	gint port = 2628;
+	gchar *database = NULL;
+	gchar *strategy = NULL;
+	gchar *pattern = NULL;
+	gchar *output = NULL;
+	gint connections = DEFAULT_CONNECTIONS;
+	gint pipeline_depth = DEFAULT_PIPELINE_DEPTH;
+	const GOptionEntry option_entries[] =
+	{
+		{ "host", 'h', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &host, "A host address. Default is localhost.", "HOST" },
+		{ "port", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &port, "A port number of the host. Default is 2628.", "PORT" },
+		{ "database", 'd', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &database, "A database name to export, required.", "DATABASE" },
+		{ "strategy", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &strategy, "A strategy to match all headwords. Default is re.", "STRATEGY" },
+		{ "word", 'w', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &pattern, "A word to match all headwords with the strategy. Default is \".\".", "WORD" },
+		{ "output", 'o', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &output, "A base name of the output files. Default is the database name.", "OUTPUT" },
+		{ "connections", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &connections, "A number of parallel connections. Default is 4.", "NUMBER" },
+		{ "pipeline", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &pipeline_depth, "A number of pipelined commands per connection. Default is 8.", "NUMBER" },
+		{ NULL }
+	};
+
+	GOptionContext *option_context;
+	DictClient *dc;
+	Mirror mirror;
+	GStrv databases = NULL, descriptions = NULL, words = NULL;
+	gchar *description = NULL, *info = NULL, *url;
+	glong i, num;
+	gint ret = EXIT_FAILURE;
+	GError *error = NULL;
+
+	setlocale( LC_ALL, "" );
+
+	option_context = g_option_context_new( NULL );
+	g_option_context_set_summary( option_context, MIRROR_APP_SUMMARY );
+	g_option_context_set_help_enabled( option_context, TRUE );
+	g_option_context_add_main_entries( option_context, option_entries, NULL );
+
+	g_option_context_parse( option_context, &argc, &argv, &error );
+	g_option_context_free( option_context );
+	if( error == NULL && ( database == NULL || connections < 1 || pipeline_depth < 1 ) )
+		g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "A database, a positive number of connections and a positive pipeline depth are required" );
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		return EXIT_FAILURE;
+	}
+
+	/* if options are not set, set to deafults */
+	if( host == NULL )
+		host = g_strdup( "localhost" );
+	if( strategy == NULL )
+		strategy = g_strdup( "re" );
+	if( pattern == NULL )
+		pattern = g_strdup( "." );
+	if( output == NULL )
+		output = g_strdup( database );
+
+	memset( &mirror, 0, sizeof( mirror ) );
+	mirror.database = database;
+	mirror.entries = g_ptr_array_new_with_free_func( (GDestroyNotify)mirror_entry_free );
+	mirror.done = g_hash_table_new_full( g_str_hash, g_str_equal, g_free, NULL );
+	mirror.journal_lines = g_string_new( NULL );
+	mirror.max_in_flight = 2 * connections * pipeline_depth;
+
+	/* headwords and the description are listed through a single connection */
+	dc = dict_client_new();
+	if( dict_client_connect( dc, host, port, NULL, NULL, &error ) )
+	{
+		num = dict_client_show_databases( dc, &databases, &descriptions, &error );
+		for( i = 0; i < num; ++i )
+			if( g_strcmp0( databases[i], database ) == 0 )
+				description = g_strdup( descriptions[i] );
+		if( num > 0 )
+		{
+			g_strfreev( databases );
+			g_strfreev( descriptions );
+		}
+
+		if( error == NULL )
+			info = dict_client_show_info( dc, database, &error );
+		if( error == NULL )
+			num = dict_client_match( dc, database, strategy, pattern, NULL, &words, &error );
+		if( error == NULL )
+		{
+			mirror.headwords = unique_headwords( words );
+			if( num > 0 )
+				g_strfreev( words );
+		}
+		dict_client_disconnect( dc, NULL, NULL );
+	}
+	g_object_unref( G_OBJECT( dc ) );
+
+	if( error == NULL )
+		mirror_open( &mirror, output, &error );
+	if( error != NULL )
+		goto out;
+
+	mirror.engine = dict_engine_new();
+	dict_engine_set_pipeline_depth( mirror.engine, pipeline_depth );
+	if( !dict_engine_add_server( mirror.engine, host, port, connections, &error ) )
+		goto out;
+
+	mirror_feed( &mirror );
+	dict_engine_run( mirror.engine );
+
+	if( mirror.error != NULL )
+	{
+		g_propagate_error( &error, g_steal_pointer( &mirror.error ) );
+		goto out;
+	}
+	if( mirror.n_failed > 0 )
+	{
+		g_set_error( &error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, "%u words failed, run again to resume", mirror.n_failed );
+		goto out;
+	}
+
+	url = g_strdup_printf( "dict://%s:%d/d:%%s:%s", host, port, database );
+	if( mirror_finish( &mirror, output, url, description, info, &error ) )
+		ret = EXIT_SUCCESS;
+	g_free( url );
+
+out:
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+	}
+
+	g_clear_object( &mirror.engine );
+	g_clear_object( &mirror.data );
+	g_clear_object( &mirror.journal );
+	g_strfreev( mirror.headwords );
+	g_ptr_array_unref( mirror.entries );
+	g_hash_table_unref( mirror.done );
+	g_string_free( mirror.journal_lines, TRUE );
+
+	g_free( host );
+	g_free( database );
+	g_free( strategy );
+	g_free( pattern );
+	g_free( output );
+	g_free( description );
+	g_free( info );
+
+	return ret;
+}
@@ -0,0 +1,320 @@
+#include "config.h"
+
+#include "lib/glibdictcapture.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include <locale.h>
+#include <string.h>
+
+#define REPLAY_APP_SUMMARY "This program serves sessions of a capture FILE recorded by DictClient as a dict server.\n\nEvery accepted connection gets the next session of the file. The recorded responses are sent with their original timing scaled by the speed after the client has sent as many command lines as the recorded client did."
+
+#define DEFAULT_LISTEN_PORT 2628
+#define DEFAULT_THREADS 16
+#define DEFAULT_SPEED 1.0
+
+struct _ReplayRecord
+{
+	gchar type;
+	gint64 time;
+	const gchar *data;
+	gsize length;
+};
+typedef struct _ReplayRecord ReplayRecord;
+
+struct _ReplaySession
+{
+	gchar *address;
+	GArray *records;
+};
+typedef struct _ReplaySession ReplaySession;
+
+struct _Replay
+{
+	/* records point to the data of the mapped file */
+	GMappedFile *file;
+	GPtrArray *sessions;
+	gint next;
+
+	gdouble speed;
+	gboolean check;
+};
+typedef struct _Replay Replay;
+
+static void
+session_free(
+	ReplaySession *session )
+{
+	g_free( session->address );
+	g_array_unref( session->records );
+	g_free( session );
+}
+
+/**
+\anchor replay_load
+\brief Maps a capture file and splits it to sessions.
+
+\param[in] replay A Replay instance.
+\param[in] filename A path of the capture file.
+\param[out] error If not NULL and an error occured, holds a newly allocated GError instance.
+
+\return \c TRUE on success or \c FALSE on error.
+*/
+static gboolean
+replay_load(
+	Replay *replay,
+	const gchar *filename,
+	GError **error )
+{
+	const gchar *data, *end;
+	ReplaySession *session = NULL;
+	ReplayRecord record;
+	guint64 be_time;
+	guint32 be_length;
+
+	replay->file = g_mapped_file_new( filename, FALSE, error );
+	if( replay->file == NULL )
+		return FALSE;
+
+	data = g_mapped_file_get_contents( replay->file );
+	end = data + g_mapped_file_get_length( replay->file );
+	while( data < end )
+	{
+		if( end - data < CAPTURE_HEADER_LEN )
+			break;
+		memcpy( &be_time, data + 1, sizeof( be_time ) );
+		memcpy( &be_length, data + 1 + sizeof( be_time ), sizeof( be_length ) );
+		record.type = data[0];
+		record.time = (gint64)GUINT64_FROM_BE( be_time );
+		record.length = GUINT32_FROM_BE( be_length );
+		record.data = data + CAPTURE_HEADER_LEN;
+		if( (gsize)( end - record.data ) < record.length )
+			break;
+		data = record.data + record.length;
+
+		if( record.type == CAPTURE_RECORD_SESSION )
+		{
+			session = g_new( ReplaySession, 1 );
+			session->address = g_strndup( record.data, record.length );
+			session->records = g_array_new( FALSE, FALSE, sizeof( ReplayRecord ) );
+			g_ptr_array_add( replay->sessions, session );
+		}
+		else if( session != NULL && ( record.type == CAPTURE_RECORD_SENT || record.type == CAPTURE_RECORD_RECEIVED ) )
+			g_array_append_val( session->records, record );
+		else
+			break;
+	}
+
+	/* the recording client may have been killed in the middle of a record, the rest is still useful */
+	if( data < end && replay->sessions->len == 0 )
+	{
+		g_set_error( error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "%s is not a capture file", filename );
+		return FALSE;
+	}
+	if( replay->sessions->len == 0 )
+	{
+		g_set_error( error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "%s has no sessions", filename );
+		return FALSE;
+	}
+	if( data < end )
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", "%s is truncated or damaged at offset %" G_GSIZE_FORMAT ", the rest is ignored", filename, (gsize)( data - g_mapped_file_get_contents( replay->file ) ),
+			NULL );
+
+	return TRUE;
+}
+
+/**
+\anchor replay_wait
+\brief Sleeps until the time of a record comes.
+
+Times are counted from the anchor, the moment the client sent the last command, so that a slow client does not shift the server's delays.
+
+\param[in] replay A Replay instance.
+\param[in] anchor A monotonic time of the anchor.
+\param[in] anchor_time A recorded time of the anchor.
+\param[in] time A recorded time of the record.
+*/
+static void
+replay_wait(
+	Replay *replay,
+	gint64 anchor,
+	gint64 anchor_time,
+	gint64 time )
+{
+	gint64 delay;
+
+	if( replay->speed <= 0.0 )
+		return;
+
+	delay = anchor + (gint64)( ( time - anchor_time ) / replay->speed ) - g_get_monotonic_time();
+	if( delay > 0 )
+		g_usleep( delay );
+}
+
+/**
+\anchor on_run
+\brief Serves the next session of the capture file to the connection.
+
+The connection is handled by a thread of the service, the function returns when the session is over or the client has disconnected.
+*/
+static gboolean
+on_run(
+	GThreadedSocketService *service,
+	GSocketConnection *connection,
+	GObject *source_object,
+	gpointer user_data )
+{
+	Replay *replay = user_data;
+	ReplaySession *session;
+	ReplayRecord *record;
+	GDataInputStream *input;
+	GOutputStream *output;
+	GString *expected;
+	gchar *line, *newline;
+	gsize length;
+	gint64 anchor, anchor_time;
+	guint i;
+	gboolean ok = TRUE;
+
+	session = g_ptr_array_index( replay->sessions, (guint)g_atomic_int_add( &replay->next, 1 ) % replay->sessions->len );
+
+	input = g_data_input_stream_new( g_io_stream_get_input_stream( G_IO_STREAM( connection ) ) );
+	g_data_input_stream_set_newline_type( input, G_DATA_STREAM_NEWLINE_TYPE_ANY );
+	output = g_io_stream_get_output_stream( G_IO_STREAM( connection ) );
+
+	/* commands of the recorded client not yet matched by the lines of this one */
+	expected = g_string_new( NULL );
+
+	anchor = g_get_monotonic_time();
+	anchor_time = 0;
+	for( i = 0; ok && i < session->records->len; ++i )
+	{
+		record = &g_array_index( session->records, ReplayRecord, i );
+
+		if( record->type == CAPTURE_RECORD_RECEIVED )
+		{
+			replay_wait( replay, anchor, anchor_time, record->time );
+			ok = g_output_stream_write_all( output, record->data, record->length, NULL, NULL, NULL );
+			continue;
+		}
+
+		g_string_append_len( expected, record->data, record->length );
+		while( ok && ( newline = memchr( expected->str, '\n', expected->len ) ) != NULL )
+		{
+			line = g_data_input_stream_read_line( input, NULL, NULL, NULL );
+			if( line == NULL )
+			{
+				ok = FALSE;
+				break;
+			}
+
+			length = newline - expected->str;
+			if( length > 0 && expected->str[length - 1] == '\r' )
+				--length;
+			if( replay->check && ( strlen( line ) != length || strncmp( line, expected->str, length ) != 0 ) )
+				g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+					"MESSAGE", "Session of %s: expected \"%.*s\", got \"%s\"", session->address, (gint)length, expected->str, line,
+					NULL );
+
+			g_free( line );
+			g_string_erase( expected, 0, newline - expected->str + 1 );
+		}
+
+		anchor = g_get_monotonic_time();
+		anchor_time = record->time;
+	}
+
+	g_string_free( expected, TRUE );
+	g_object_unref( input );
+
+	return TRUE;
+}
+
+int
+main(
+	int argc,
+	char *argv[] )
+{
+	gint listen_port = DEFAULT_LISTEN_PORT;
+	gint threads = DEFAULT_THREADS;
+	gdouble speed = DEFAULT_SPEED;
+	gboolean check = FALSE;
+	const GOptionEntry option_entries[] =
+	{
+		{ "listen", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &listen_port, "A port number to serve on. Default is 2628.", "PORT" },
+		{ "threads", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &threads, "A number of connections served at once. Default is 16.", "NUMBER" },
+		{ "speed", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &speed, "A factor the recorded timing is sped up by, 0 sends responses at once. Default is 1.", "FACTOR" },
+		{ "check", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &check, "If set, commands differing from the recorded ones will be logged.", NULL },
+		{ NULL }
+	};
+
+	GOptionContext *option_context;
+	GSocketService *service;
+	GMainLoop *loop;
+	Replay replay;
+	GError *error = NULL;
+
+	setlocale( LC_ALL, "" );
+
+	option_context = g_option_context_new( "FILE" );
+	g_option_context_set_summary( option_context, REPLAY_APP_SUMMARY );
+	g_option_context_set_help_enabled( option_context, TRUE );
+	g_option_context_add_main_entries( option_context, option_entries, NULL );
+
+	g_option_context_parse( option_context, &argc, &argv, &error );
+	g_option_context_free( option_context );
+	if( error == NULL && ( argc != 2 || threads < 1 || speed < 0.0 || listen_port < 1 || listen_port > G_MAXUINT16 ) )
+		g_set_error( &error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "A capture file, a positive number of threads and a non-negative speed are required" );
+	if( error != NULL )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		return EXIT_FAILURE;
+	}
+
+	replay.sessions = g_ptr_array_new_with_free_func( (GDestroyNotify)session_free );
+	replay.next = 0;
+	replay.speed = speed;
+	replay.check = check;
+	if( !replay_load( &replay, argv[1], &error ) )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_ptr_array_unref( replay.sessions );
+		g_clear_pointer( &replay.file, g_mapped_file_unref );
+		return EXIT_FAILURE;
+	}
+
+	service = g_threaded_socket_service_new( threads );
+	if( !g_socket_listener_add_inet_port( G_SOCKET_LISTENER( service ), listen_port, NULL, &error ) )
+	{
+		g_log_structured( G_LOG_DOMAIN, G_LOG_LEVEL_WARNING,
+			"MESSAGE", error->message,
+			NULL );
+		g_clear_error( &error );
+		g_object_unref( service );
+		g_ptr_array_unref( replay.sessions );
+		g_mapped_file_unref( replay.file );
+		return EXIT_FAILURE;
+	}
+	g_signal_connect( service, "run", G_CALLBACK( on_run ), &replay );
+	g_socket_service_start( service );
+
+	loop = g_main_loop_new( NULL, FALSE );
+	g_main_loop_run( loop );
+
+	g_main_loop_unref( loop );
+	g_socket_service_stop( service );
+	g_object_unref( service );
+	g_ptr_array_unref( replay.sessions );
+	g_mapped_file_unref( replay.file );
+
+	return EXIT_SUCCESS;
+}